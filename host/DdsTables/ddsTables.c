@@ -0,0 +1,68 @@
+//**********************************************************************************
+// Generates the waveform tables of src/DDS/ddsTables.h
+//
+// The PIC has no floating point to spare, so the tables are worked out here once
+// and compiled into flash. Every table comes in a 256 and a 64 entry version, the
+// DDS picks one with DDS_TABLE_BITS. The values are duty cycles for CCPR1L, 0 to
+// 255 around a middle of 127.5.
+//
+//      dds_sine    one period of a sine
+//      dds_organ   a sine with half of the second and a quarter of the third
+//                  harmonic, an example of an arbitrary waveform
+//
+// Build and run:
+//      gcc -O2 -o ddsTables ddsTables.c -lm
+//      ./ddsTables > ../../src/DDS/ddsTables.h
+//**********************************************************************************
+
+#include <math.h>
+#include <stdio.h>
+
+typedef double (*wave_t)(double angle);
+
+static double sine(double angle) {
+    return sin(angle);
+}
+
+static double organ(double angle) {
+    return sin(angle) + 0.5 * sin(2 * angle) + 0.25 * sin(3 * angle);
+}
+
+// Scales the wave so its peaks reach 0 and 255
+static void print_table(const char *name, wave_t wave, int size) {
+    double low = 0;
+    double high = 0;
+
+    for (int i = 0; i < 4096; i++) {
+        double value = wave(2 * M_PI * i / 4096);
+        low = value < low ? value : low;
+        high = value > high ? value : high;
+    }
+
+    printf("static const uint8_t %s[%d] = {", name, size);
+    for (int i = 0; i < size; i++) {
+        double value = (wave(2 * M_PI * i / size) - low) / (high - low) * 255;
+        printf("%s%3d%s", i % 16 == 0 ? "\n    " : "", (int) lround(value), i + 1 < size ? "," : "");
+    }
+    printf("\n};\n");
+}
+
+int main(void) {
+    printf("//**********************************************************************************\n");
+    printf("// Waveform tables for the DDS, generated by host/DdsTables/ddsTables.c\n");
+    printf("//\n");
+    printf("// Do not edit, run the generator again instead.\n");
+    printf("//**********************************************************************************\n\n");
+    printf("#ifndef DDS_TABLES_H\n#define DDS_TABLES_H\n\n#include <stdint.h>\n\n");
+
+    printf("#if DDS_TABLE_BITS == 8\n\n");
+    print_table("dds_sine", sine, 256);
+    printf("\n");
+    print_table("dds_organ", organ, 256);
+    printf("\n#else\n\n");
+    print_table("dds_sine", sine, 64);
+    printf("\n");
+    print_table("dds_organ", organ, 64);
+    printf("\n#endif\n\n#endif\n");
+    return 0;
+}
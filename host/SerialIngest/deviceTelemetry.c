@@ -0,0 +1,16 @@
+#include "deviceTelemetry.h"
+
+#include <string.h>
+
+#define TELEMETRY_MAX_VALUES 15
+#include "../../src/Telemetry/telemetry.h"
+
+size_t device_telemetry_frame(uint8_t *sequence, uint8_t type, uint16_t tick,
+                              const uint16_t *values, uint8_t count, uint8_t *out) {
+    telemetry_sequence = *sequence;
+    uint8_t length = telemetry_build(type, tick, values, count);
+    *sequence = telemetry_sequence;
+
+    memcpy(out, telemetry_buffer, length);
+    return length;
+}
@@ -0,0 +1,25 @@
+//**********************************************************************************
+// The frame encoder of the samples on the PC
+//
+// deviceTelemetry.c builds src/Telemetry/telemetry.h as it is, so the simulated
+// devices of the load benchmark send exactly the bytes a board sends. It has its
+// own translation unit because the device header and ../TelemetryDecoder/telemetry.h
+// both define telemetry_crc8().
+//**********************************************************************************
+
+#ifndef DEVICE_TELEMETRY_H
+#define DEVICE_TELEMETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Longest encoded frame, 15 values of 16 bits
+#define DEVICE_TELEMETRY_MAX_FRAME (1 + 4 + 2 * 15 + 1 + 1)
+
+// Encodes one frame into out with the sequence number *sequence and moves it on.
+// Returns the length including the zero delimiter. Not thread safe, the encoder
+// works in the static buffer of the device header.
+size_t device_telemetry_frame(uint8_t *sequence, uint8_t type, uint16_t tick,
+                              const uint16_t *values, uint8_t count, uint8_t *out);
+
+#endif
@@ -0,0 +1,178 @@
+#define _GNU_SOURCE // mremap()
+
+#include "sampleStore.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SAMPLE_STORE_FIRST_CHUNKS 16
+
+static size_t file_size(uint64_t chunks) {
+    return SAMPLE_STORE_HEADER_SIZE + (size_t) chunks * sizeof(sample_store_chunk_t);
+}
+
+static void set_pointers(sample_store_t *store) {
+    store->header = (sample_store_header_t *) store->map;
+    store->chunks = (sample_store_chunk_t *) (store->map + SAMPLE_STORE_HEADER_SIZE);
+}
+
+// Closes what was opened so far and keeps the errno of the failure
+static int fail(sample_store_t *store) {
+    int error = errno;
+
+    sample_store_close(store);
+    errno = error;
+    return -1;
+}
+
+int sample_store_open(sample_store_t *store, const char *path, int writable) {
+    struct stat status;
+
+    memset(store, 0, sizeof *store);
+    store->writable = writable;
+    store->fd = open(path, writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (store->fd < 0 || fstat(store->fd, &status) != 0) {
+        return fail(store);
+    }
+
+    int empty = status.st_size == 0;
+    if (empty) {
+        if (!writable) {
+            errno = EINVAL;
+            return fail(store);
+        }
+        store->map_size = file_size(SAMPLE_STORE_FIRST_CHUNKS);
+        if (ftruncate(store->fd, (off_t) store->map_size) != 0) {
+            return fail(store);
+        }
+    } else {
+        store->map_size = (size_t) status.st_size;
+    }
+
+    store->map = mmap(NULL, store->map_size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                      MAP_SHARED, store->fd, 0);
+    if (store->map == MAP_FAILED) {
+        store->map = NULL;
+        return fail(store);
+    }
+    set_pointers(store);
+
+    if (empty) {
+        store->header->magic = SAMPLE_STORE_MAGIC;
+        store->header->version = SAMPLE_STORE_VERSION;
+        store->header->chunk_rows = SAMPLE_STORE_CHUNK_ROWS;
+        store->header->rows = 0;
+        store->header->chunks = SAMPLE_STORE_FIRST_CHUNKS;
+    } else if (store->map_size < SAMPLE_STORE_HEADER_SIZE
+               || store->header->magic != SAMPLE_STORE_MAGIC
+               || store->header->version != SAMPLE_STORE_VERSION
+               || store->header->chunk_rows != SAMPLE_STORE_CHUNK_ROWS
+               || file_size(store->header->chunks) > store->map_size
+               || store->header->rows > store->header->chunks * SAMPLE_STORE_CHUNK_ROWS) {
+        errno = EINVAL; // Not a store, or one of another layout
+        return fail(store);
+    }
+    return 0;
+}
+
+void sample_store_close(sample_store_t *store) {
+    if (store->map != NULL) {
+        if (store->writable) {
+            msync(store->map, store->map_size, MS_SYNC);
+        }
+        munmap(store->map, store->map_size);
+    }
+    if (store->fd >= 0) {
+        close(store->fd);
+    }
+    store->map = NULL;
+    store->fd = -1;
+}
+
+// Doubles the number of chunks. The map may move, nobody else holds a pointer
+// into it.
+static int grow(sample_store_t *store) {
+    uint64_t chunks = store->header->chunks * 2;
+    size_t size = file_size(chunks);
+
+    if (ftruncate(store->fd, (off_t) size) != 0) {
+        return -1;
+    }
+    void *map = mremap(store->map, store->map_size, size, MREMAP_MAYMOVE);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    store->map = map;
+    store->map_size = size;
+    set_pointers(store);
+    store->header->chunks = chunks;
+    return 0;
+}
+
+int sample_store_append(sample_store_t *store, const sample_row_t *row) {
+    uint64_t rows = store->header->rows;
+    uint64_t index = rows / SAMPLE_STORE_CHUNK_ROWS;
+    uint32_t position = (uint32_t) (rows % SAMPLE_STORE_CHUNK_ROWS);
+
+    if (index == store->header->chunks && grow(store) != 0) {
+        return -1;
+    }
+
+    sample_store_chunk_t *chunk = &store->chunks[index];
+    if (position == 0 || row->time_ns < chunk->first_ns) {
+        chunk->first_ns = row->time_ns;
+    }
+    if (position == 0 || row->time_ns > chunk->last_ns) {
+        chunk->last_ns = row->time_ns;
+    }
+    chunk->time_ns[position] = row->time_ns;
+    chunk->device[position] = row->device;
+    chunk->tick[position] = row->tick;
+    chunk->value[position] = row->value;
+    chunk->channel[position] = row->channel;
+    chunk->rows = position + 1;
+
+    // Last, a reader in another process never sees a half written row
+    __atomic_store_n(&store->header->rows, rows + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+uint64_t sample_store_query(const sample_store_t *store, int64_t from_ns, int64_t to_ns,
+                            sample_store_visit_t visit, void *context) {
+    uint64_t rows = __atomic_load_n(&store->header->rows, __ATOMIC_ACQUIRE);
+    uint64_t mapped = (store->map_size - SAMPLE_STORE_HEADER_SIZE) / sizeof(sample_store_chunk_t);
+
+    if (rows > mapped * SAMPLE_STORE_CHUNK_ROWS) {
+        rows = mapped * SAMPLE_STORE_CHUNK_ROWS; // The writer grew the file after it was opened here
+    }
+    uint64_t chunks = (rows + SAMPLE_STORE_CHUNK_ROWS - 1) / SAMPLE_STORE_CHUNK_ROWS;
+    uint64_t found = 0;
+
+    for (uint64_t index = 0; index < chunks; index++) {
+        const sample_store_chunk_t *chunk = &store->chunks[index];
+        uint32_t count = index == chunks - 1 ? (uint32_t) (rows - index * SAMPLE_STORE_CHUNK_ROWS)
+                                             : SAMPLE_STORE_CHUNK_ROWS;
+
+        if (chunk->last_ns < from_ns || chunk->first_ns >= to_ns) {
+            continue; // The index says none of its rows is in the range
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            if (chunk->time_ns[i] < from_ns || chunk->time_ns[i] >= to_ns) {
+                continue;
+            }
+            found++;
+            if (visit != NULL) {
+                sample_row_t row = {
+                    chunk->time_ns[i], chunk->device[i], chunk->channel[i], chunk->tick[i], chunk->value[i]
+                };
+                visit(&row, context);
+            }
+        }
+    }
+
+    return found;
+}
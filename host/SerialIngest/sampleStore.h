@@ -0,0 +1,96 @@
+//**********************************************************************************
+// Memory mapped sample store of host/SerialIngest
+//
+// Every value of a telemetry frame becomes one row: when it was received, which
+// device and which value of the frame it was, the tick of the frame and the
+// value. The file is a header page followed by chunks of SAMPLE_STORE_CHUNK_ROWS
+// rows. Inside a chunk every field has its own array, a column, so a query that
+// looks at the times reads only the times:
+//
+//      header      magic, version, rows and chunks in use
+//      chunk 0     rows, first and last time, then time[], device[], tick[],
+//      chunk 1     value[] and channel[] of SAMPLE_STORE_CHUNK_ROWS each
+//      ...
+//
+// The first and last time of the chunks are the index. The rows arrive in about
+// the order they were received, but the devices are drained one after the other,
+// so the times in a chunk are not strictly sorted. A range query skips every
+// chunk whose times lie outside the range and only compares the rows of the few
+// that overlap it.
+//
+// The file grows by doubling, it is remapped each time. There is one writer; a
+// reader that opens the file while it is written sees the rows of the last
+// header update.
+//**********************************************************************************
+
+#ifndef SAMPLE_STORE_H
+#define SAMPLE_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SAMPLE_STORE_MAGIC          0x45524F5453434950ULL // "PICSTORE"
+#define SAMPLE_STORE_VERSION        1
+#define SAMPLE_STORE_HEADER_SIZE    4096
+#define SAMPLE_STORE_CHUNK_ROWS     4096
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t chunk_rows;
+    uint64_t rows; // In all chunks, only the last one is partly filled
+    uint64_t chunks; // That the file has room for
+} sample_store_header_t;
+
+typedef struct {
+    uint32_t rows;
+    uint32_t reserved;
+    int64_t first_ns; // Smallest and biggest time in the chunk
+    int64_t last_ns;
+    int64_t time_ns[SAMPLE_STORE_CHUNK_ROWS]; // CLOCK_REALTIME when received
+    uint16_t device[SAMPLE_STORE_CHUNK_ROWS];
+    uint16_t tick[SAMPLE_STORE_CHUNK_ROWS];
+    uint16_t value[SAMPLE_STORE_CHUNK_ROWS];
+    uint8_t channel[SAMPLE_STORE_CHUNK_ROWS]; // Position of the value in its frame
+} sample_store_chunk_t;
+
+typedef struct {
+    int64_t time_ns;
+    uint16_t device;
+    uint8_t channel;
+    uint16_t tick;
+    uint16_t value;
+} sample_row_t;
+
+typedef struct {
+    int fd;
+    int writable;
+    uint8_t *map;
+    size_t map_size;
+    sample_store_header_t *header;
+    sample_store_chunk_t *chunks;
+} sample_store_t;
+
+// Opens the file, and with writable creates it when it does not exist. New rows
+// go after the ones already in it. Returns 0 on success, -1 with errno set.
+int sample_store_open(sample_store_t *store, const char *path, int writable);
+void sample_store_close(sample_store_t *store);
+
+// Returns 0 on success, -1 when the file could not grow
+int sample_store_append(sample_store_t *store, const sample_row_t *row);
+
+// Calls visit for every row with from_ns <= time < to_ns, in file order, and
+// returns how many there were. visit may be NULL to only count them.
+typedef void (*sample_store_visit_t)(const sample_row_t *row, void *context);
+uint64_t sample_store_query(const sample_store_t *store, int64_t from_ns, int64_t to_ns,
+                            sample_store_visit_t visit, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
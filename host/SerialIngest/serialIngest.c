@@ -0,0 +1,746 @@
+//**********************************************************************************
+// Reads the telemetry of many boards at once and keeps it in a sample file
+//
+// ../TelemetryDecoder follows one board in a terminal. This follows dozens: all
+// the serial ports or ptys on the command line are read through one epoll loop,
+// the bytes are decoded with ../TelemetryDecoder/telemetry.c and every frame goes
+// into a ring of its device, stamped with the time its bytes were read. A second
+// thread takes the frames out of the rings and appends one row per value to a
+// memory mapped sample file, see sampleStore.h.
+//
+// The rings work like the ones of src/UART/uart.h: free running indexes, the
+// head written only by the reading thread and the tail only by the writing one,
+// so neither side takes a lock. A full ring drops the frame and counts it, the
+// reading thread never waits for the disk. Frames of the samples types go into
+// the file, the log and profiler frames and the text answers are only counted.
+//
+// Build:
+//      gcc -O2 -pthread -o serialIngest serialIngest.c sampleStore.c deviceTelemetry.c ../TelemetryDecoder/telemetry.c
+//
+// Run:
+//      ./serialIngest -o samples.dat /dev/ttyUSB0 /dev/ttyUSB1 ...  (9600 baud)
+//      ./serialIngest -b 115200 -p 4 -o samples.dat    4 ptys, see below
+//      ./serialIngest -q 1700000000,1700000060.5 samples.dat
+//      ./serialIngest -B 64 -s 10                      load benchmark
+//
+// The devices are numbered in the order of the command line, the ptys of -p
+// after the ports. -p prints the name of every pty it makes; a sample running in
+// host/Simulator sends into one with PIC_SIM_UART_OUT=/dev/pts/<n>. Ctrl+C stops
+// and prints the frames, bad, lost and dropped frames of every device.
+//
+// -q prints the rows received from the first time up to the second one, both
+// in seconds since 1970:
+//      <time in ns> <device> <channel> <tick> <value>
+//
+// -B <n> runs n simulated devices on ptys in this process for -s seconds. Each
+// one sends the 4 value frames of ../../src/AnalogRead/analogRead.c back to back
+// at the full rate of the line, 230400 baud unless -b says otherwise. At the end
+// it prints the sustained ingest rate, the latency from writing a frame to its
+// rows being in the file, and the time a range query of one second takes.
+//**********************************************************************************
+
+#define _GNU_SOURCE // ptsname_r()
+
+#include "../TelemetryDecoder/telemetry.h"
+#include "deviceTelemetry.h"
+#include "sampleStore.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RING_SIZE       1024 // Frames per device, a power of two
+#define RING_MASK       (RING_SIZE - 1)
+#define READ_SIZE       4096
+#define MAX_DEVICES     1024
+
+typedef struct {
+    int64_t time_ns; // CLOCK_REALTIME when the bytes were read
+    uint16_t tick;
+    uint8_t count;
+    uint16_t values[TELEMETRY_MAX_VALUES];
+} ring_frame_t;
+
+typedef struct {
+    char name[64];
+    int fd;
+    int slave_fd; // The other end of a pty, held open so the pty never hangs up
+
+    // Reading thread only
+    telemetry_decoder_t decoder;
+    unsigned long dropped; // Frames the full ring had no room for
+    unsigned long other_frames; // Log and profiler frames, not stored
+    unsigned long long bytes;
+
+    ring_frame_t ring[RING_SIZE];
+    _Alignas(64) atomic_uint head; // Written by the reading thread only
+    _Alignas(64) atomic_uint tail; // Written by the writing thread only
+} device_t;
+
+static device_t *devices;
+static unsigned device_count;
+static sample_store_t store;
+static int wake_fd; // eventfd, the reading thread wakes the writing one with it
+static atomic_int stopping;
+static atomic_int reading_done;
+static unsigned long long stored_rows; // Writing thread only
+static int store_failed;
+
+static int64_t clock_ns(clockid_t clock) {
+    struct timespec now;
+
+    clock_gettime(clock, &now);
+    return (int64_t) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static speed_t baud_constant(long baud) {
+    switch (baud) {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        default: return 0;
+    }
+}
+
+// Raw 8N1 so no byte of the binary stream gets translated or eaten. A pty has no
+// baud rate, it only needs the raw mode.
+static int configure_tty(int fd, long baud) {
+    struct termios tty;
+    speed_t speed = baud_constant(baud);
+
+    if (tcgetattr(fd, &tty) != 0) {
+        perror("tcgetattr");
+        return -1;
+    }
+
+    cfmakeraw(&tty);
+    if (baud != 0) {
+        if (speed == 0) {
+            fprintf(stderr, "unsupported baud rate %ld\n", baud);
+            return -1;
+        }
+        cfsetispeed(&tty, speed);
+        cfsetospeed(&tty, speed);
+    }
+    tty.c_cflag |= CLOCAL | CREAD;
+
+    if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+        perror("tcsetattr");
+        return -1;
+    }
+    return 0;
+}
+
+static device_t *add_device(const char *name, int fd, int slave_fd) {
+    if (device_count == MAX_DEVICES) {
+        fprintf(stderr, "more than %d devices\n", MAX_DEVICES);
+        return NULL;
+    }
+
+    device_t *device = &devices[device_count++];
+    snprintf(device->name, sizeof device->name, "%s", name);
+    device->fd = fd;
+    device->slave_fd = slave_fd;
+    telemetry_decoder_init(&device->decoder);
+    atomic_init(&device->head, 0);
+    atomic_init(&device->tail, 0);
+    return device;
+}
+
+static int open_port(const char *path, long baud) {
+    int fd = open(path, O_RDONLY | O_NOCTTY | O_NONBLOCK);
+
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    if (isatty(fd) && configure_tty(fd, baud) != 0) {
+        close(fd);
+        return -1;
+    }
+    return add_device(path, fd, -1) != NULL ? 0 : -1;
+}
+
+// The device reads the master end, whatever is written to the slave end comes
+// out of it
+static device_t *open_pty(void) {
+    char name[64];
+    int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0 || ptsname_r(master, name, sizeof name) != 0) {
+        perror("pty");
+        return NULL;
+    }
+    int slave = open(name, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (slave < 0 || configure_tty(slave, 0) != 0) {
+        perror(name);
+        return NULL;
+    }
+    return add_device(name, master, slave);
+}
+
+// Reading thread side
+static int ring_push(device_t *device, const telemetry_frame_t *frame, int64_t time_ns) {
+    unsigned head = atomic_load_explicit(&device->head, memory_order_relaxed);
+
+    if (head - atomic_load_explicit(&device->tail, memory_order_acquire) == RING_SIZE) {
+        device->dropped++;
+        return 0;
+    }
+
+    ring_frame_t *slot = &device->ring[head & RING_MASK];
+    slot->time_ns = time_ns;
+    slot->tick = frame->tick;
+    slot->count = frame->count;
+    memcpy(slot->values, frame->values, frame->count * sizeof frame->values[0]);
+    atomic_store_explicit(&device->head, head + 1, memory_order_release); // Publish the frame only after it is stored
+    return 1;
+}
+
+// Reads every device with data until stopping is set
+static void read_devices(int epoll_fd) {
+    struct epoll_event events[64];
+    uint8_t buffer[READ_SIZE];
+    telemetry_frame_t frame;
+    char text[128];
+
+    while (!atomic_load(&stopping)) {
+        int ready = epoll_wait(epoll_fd, events, 64, 100);
+        int pushed = 0;
+
+        if (ready < 0) {
+            if (errno != EINTR) {
+                perror("epoll_wait");
+                break;
+            }
+            continue;
+        }
+
+        for (int i = 0; i < ready; i++) {
+            device_t *device = events[i].data.ptr;
+            ssize_t count = read(device->fd, buffer, sizeof buffer);
+
+            if (count <= 0) {
+                if (count == 0 || (errno != EAGAIN && errno != EINTR)) {
+                    fprintf(stderr, "%s: %s\n", device->name, count == 0 ? "end of file" : strerror(errno));
+                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, device->fd, NULL);
+                }
+                continue;
+            }
+
+            int64_t now = clock_ns(CLOCK_REALTIME);
+            device->bytes += (unsigned long long) count;
+            for (ssize_t j = 0; j < count; j++) {
+                if (telemetry_decoder_push(&device->decoder, buffer[j], &frame, text, sizeof text) != TELEMETRY_FRAME) {
+                    continue;
+                }
+                if (frame.type == TELEMETRY_TYPE_SAMPLES || frame.type == TELEMETRY_TYPE_VALUES
+                    || frame.type == TELEMETRY_TYPE_SAMPLES12) {
+                    pushed |= ring_push(device, &frame, now);
+                } else {
+                    device->other_frames++;
+                }
+            }
+        }
+
+        if (pushed) {
+            uint64_t one = 1;
+            (void) !write(wake_fd, &one, sizeof one);
+        }
+    }
+}
+
+// Called by the writing thread for every frame it stored, set by the benchmark
+static void (*stored_hook)(unsigned device, const ring_frame_t *frame);
+
+// Moves what is in the rings to the file, returns the number of frames
+static unsigned drain_rings(void) {
+    unsigned frames = 0;
+
+    for (unsigned d = 0; d < device_count; d++) {
+        device_t *device = &devices[d];
+        unsigned tail = atomic_load_explicit(&device->tail, memory_order_relaxed);
+        unsigned head = atomic_load_explicit(&device->head, memory_order_acquire);
+
+        for (; tail != head; tail++) {
+            const ring_frame_t *slot = &device->ring[tail & RING_MASK];
+
+            for (uint8_t i = 0; i < slot->count && !store_failed; i++) {
+                sample_row_t row = { slot->time_ns, (uint16_t) d, i, slot->tick, slot->values[i] };
+
+                if (sample_store_append(&store, &row) != 0) {
+                    perror("sample file");
+                    store_failed = 1;
+                    atomic_store(&stopping, 1);
+                } else {
+                    stored_rows++;
+                }
+            }
+            if (stored_hook != NULL) {
+                stored_hook(d, slot);
+            }
+            frames++;
+        }
+        atomic_store_explicit(&device->tail, tail, memory_order_release); // The slots are free again
+    }
+
+    return frames;
+}
+
+static void *write_rows(void *unused) {
+    (void) unused;
+
+    for (;;) {
+        if (drain_rings() != 0) {
+            continue;
+        }
+        if (atomic_load(&reading_done)) {
+            drain_rings(); // What came in after the last look
+            break;
+        }
+        uint64_t wakes;
+        (void) !read(wake_fd, &wakes, sizeof wakes); // Blocks until the reader pushes
+    }
+    return NULL;
+}
+
+static void stop(int signal) {
+    (void) signal;
+    atomic_store(&stopping, 1);
+}
+
+// Reads the devices into the file until stopping is set. The writing thread runs
+// while this thread reads.
+static int ingest(void) {
+    int epoll_fd = epoll_create1(0);
+    pthread_t writer;
+
+    wake_fd = eventfd(0, 0);
+    if (epoll_fd < 0 || wake_fd < 0) {
+        perror("epoll");
+        return -1;
+    }
+    for (unsigned d = 0; d < device_count; d++) {
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = &devices[d] };
+
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, devices[d].fd, &event) != 0) {
+            perror(devices[d].name); // Regular files can not be polled
+            return -1;
+        }
+    }
+
+    pthread_create(&writer, NULL, write_rows, NULL);
+    read_devices(epoll_fd);
+
+    atomic_store(&reading_done, 1);
+    uint64_t one = 1;
+    (void) !write(wake_fd, &one, sizeof one);
+    pthread_join(writer, NULL);
+
+    close(epoll_fd);
+    close(wake_fd);
+    return store_failed ? -1 : 0;
+}
+
+static void print_devices(void) {
+    for (unsigned d = 0; d < device_count; d++) {
+        const device_t *device = &devices[d];
+
+        fprintf(stderr, "device %u %s: %lu frames, %lu bad, %lu lost, %lu dropped, %lu other, %lu text lines\n",
+                d, device->name, device->decoder.frames, device->decoder.bad_frames, device->decoder.lost_frames,
+                device->dropped, device->other_frames, device->decoder.text_lines);
+    }
+    fprintf(stderr, "%llu rows stored\n", stored_rows);
+}
+
+// Seconds since 1970 with up to 9 decimals, without the rounding of a double
+static int parse_time(const char *text, int64_t *time_ns, char **end) {
+    int64_t fraction = 0;
+    int digits = 0;
+
+    errno = 0;
+    long long seconds = strtoll(text, end, 10);
+    if (errno != 0 || *end == text) {
+        return -1;
+    }
+    if (**end == '.') {
+        for ((*end)++; **end >= '0' && **end <= '9'; (*end)++) {
+            if (digits < 9) {
+                fraction = fraction * 10 + (**end - '0');
+                digits++;
+            }
+        }
+    }
+    for (; digits < 9; digits++) {
+        fraction *= 10;
+    }
+    *time_ns = seconds * 1000000000LL + fraction;
+    return 0;
+}
+
+static void print_row(const sample_row_t *row, void *unused) {
+    (void) unused;
+    printf("%lld %u %u %u %u\n", (long long) row->time_ns, row->device, row->channel, row->tick, row->value);
+}
+
+static int query(const char *range, const char *path) {
+    int64_t from_ns;
+    int64_t to_ns;
+    char *end;
+
+    if (parse_time(range, &from_ns, &end) != 0 || *end != ',' || parse_time(end + 1, &to_ns, &end) != 0 || *end != '\0') {
+        fprintf(stderr, "bad time range %s, want <from>,<to> in seconds\n", range);
+        return 2;
+    }
+    if (sample_store_open(&store, path, 0) != 0) {
+        perror(path);
+        return 1;
+    }
+
+    uint64_t rows = sample_store_query(&store, from_ns, to_ns, print_row, NULL);
+    fprintf(stderr, "%llu rows\n", (unsigned long long) rows);
+    sample_store_close(&store);
+    return 0;
+}
+
+// Load benchmark: simulated devices write into the slave ends of ptys at the
+// rate of the line, paced in steps of 1 ms like the bytes of a real UART
+
+#define BENCH_VALUES        4 // Like analogRead.c, one value per channel
+#define BENCH_FRAME_SIZE    (1 + TELEMETRY_HEADER_SIZE + 2 * BENCH_VALUES + 1 + 1) // COBS code, CRC, delimiter
+#define BENCH_STEP_NS       1000000
+#define BENCH_PENDING       4096
+#define BENCH_SENT_SLOTS    1024 // Frames in flight per device, a power of two
+#define BENCH_BACKLOG_MS    100 // Of line time, beyond that the bytes are lost
+#define BENCH_HISTOGRAM_US  100000 // 1 us buckets, slower frames go in the last one
+
+typedef struct {
+    uint8_t sequence;
+    uint16_t tick;
+    double budget; // Bytes the line could have sent by now
+    uint8_t pending[BENCH_PENDING]; // Frames written only in part
+    size_t pending_length;
+    size_t pending_written;
+    uint16_t pending_ticks[BENCH_PENDING / 8];
+    size_t pending_ends[BENCH_PENDING / 8];
+    unsigned pending_frames;
+    unsigned pending_stamped;
+    unsigned long long overrun_bytes; // The ingest did not keep up with the line
+    unsigned long long sent_frames;
+    _Atomic int64_t sent_ns[BENCH_SENT_SLOTS]; // CLOCK_MONOTONIC, by tick
+} bench_device_t;
+
+static bench_device_t *bench_devices;
+static long bench_baud;
+static double bench_seconds;
+static uint64_t bench_histogram[BENCH_HISTOGRAM_US + 1]; // Writing thread only
+static uint64_t bench_latencies;
+static int64_t bench_max_us;
+static double bench_elapsed; // Seconds the devices really sent for
+
+static void bench_stored(unsigned device, const ring_frame_t *frame) {
+    int64_t sent = atomic_load_explicit(&bench_devices[device].sent_ns[frame->tick & (BENCH_SENT_SLOTS - 1)],
+                                        memory_order_relaxed);
+    int64_t latency_us = (clock_ns(CLOCK_MONOTONIC) - sent) / 1000;
+
+    if (sent == 0 || latency_us < 0) {
+        return;
+    }
+    bench_histogram[latency_us < BENCH_HISTOGRAM_US ? latency_us : BENCH_HISTOGRAM_US]++;
+    if (latency_us > bench_max_us) {
+        bench_max_us = latency_us;
+    }
+    bench_latencies++;
+}
+
+static long long bench_percentile(double fraction) {
+    uint64_t wanted = (uint64_t) (fraction * (double) bench_latencies);
+    uint64_t seen = 0;
+
+    for (long long us = 0; us <= BENCH_HISTOGRAM_US; us++) {
+        seen += bench_histogram[us];
+        if (seen > wanted) {
+            return us;
+        }
+    }
+    return BENCH_HISTOGRAM_US;
+}
+
+// Writes what is pending. The frames are stamped before the write, the reader
+// may have them before write() returns. A frame that does not get out completely
+// is stamped again on the next try.
+static void bench_flush(device_t *device, bench_device_t *bench) {
+    int64_t now = clock_ns(CLOCK_MONOTONIC);
+
+    for (unsigned f = bench->pending_stamped; f < bench->pending_frames; f++) {
+        uint16_t tick = bench->pending_ticks[f];
+        atomic_store_explicit(&bench->sent_ns[tick & (BENCH_SENT_SLOTS - 1)], now, memory_order_relaxed);
+    }
+
+    while (bench->pending_written < bench->pending_length) {
+        ssize_t written = write(device->slave_fd, bench->pending + bench->pending_written,
+                                bench->pending_length - bench->pending_written);
+        if (written <= 0) {
+            break; // The pty is full, the reader is behind
+        }
+        bench->pending_written += (size_t) written;
+    }
+
+    while (bench->pending_stamped < bench->pending_frames
+           && bench->pending_ends[bench->pending_stamped] <= bench->pending_written) {
+        bench->pending_stamped++;
+        bench->sent_frames++;
+    }
+    if (bench->pending_written == bench->pending_length) {
+        bench->pending_length = 0;
+        bench->pending_written = 0;
+        bench->pending_frames = 0;
+        bench->pending_stamped = 0;
+    }
+}
+
+static void *bench_generate(void *unused) {
+    (void) unused;
+    double bytes_per_step = bench_baud / 10.0 * BENCH_STEP_NS / 1e9; // 8N1, 10 bits a byte
+    double max_budget = bench_baud / 10.0 * BENCH_BACKLOG_MS / 1000.0;
+    struct timespec next;
+    int64_t steps = (int64_t) (bench_seconds * 1e9 / BENCH_STEP_NS);
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    int64_t start = clock_ns(CLOCK_MONOTONIC);
+    for (int64_t step = 0; step < steps && !atomic_load(&stopping); step++) {
+        for (unsigned d = 0; d < device_count; d++) {
+            device_t *device = &devices[d];
+            bench_device_t *bench = &bench_devices[d];
+            uint8_t frame[DEVICE_TELEMETRY_MAX_FRAME];
+
+            bench->budget += bytes_per_step;
+            if (bench->budget > max_budget) {
+                bench->overrun_bytes += (unsigned long long) (bench->budget - max_budget);
+                bench->budget = max_budget;
+            }
+
+            // New frames only once the old ones are out, a UART has no queue
+            int idle = bench->pending_length == 0;
+            while (idle && bench->budget >= BENCH_FRAME_SIZE && bench->pending_frames < BENCH_PENDING / 8) {
+                uint16_t values[BENCH_VALUES];
+                uint16_t tick = bench->tick++;
+
+                for (unsigned i = 0; i < BENCH_VALUES; i++) {
+                    values[i] = (uint16_t) ((tick * (i + 3) + d * 101) & 0x0FFF);
+                }
+                size_t length = device_telemetry_frame(&bench->sequence, TELEMETRY_TYPE_VALUES, tick,
+                                                       values, BENCH_VALUES, frame);
+                bench->budget -= (double) length;
+                memcpy(bench->pending + bench->pending_length, frame, length);
+                bench->pending_length += length;
+                bench->pending_ticks[bench->pending_frames] = tick;
+                bench->pending_ends[bench->pending_frames++] = bench->pending_length;
+            }
+            bench_flush(device, bench);
+        }
+
+        next.tv_nsec += BENCH_STEP_NS;
+        if (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+
+    bench_elapsed = (double) (clock_ns(CLOCK_MONOTONIC) - start) / 1e9;
+
+    // Let the frames on the way arrive, then stop the reader
+    struct timespec settle = { 0, 200000000 };
+    nanosleep(&settle, NULL);
+    atomic_store(&stopping, 1);
+    return NULL;
+}
+
+static int bench(unsigned count, const char *path) {
+    char temporary[] = "/tmp/serialIngest-XXXXXX";
+    pthread_t generator;
+
+    if (path == NULL) {
+        int fd = mkstemp(temporary);
+        if (fd < 0) {
+            perror("mkstemp");
+            return 1;
+        }
+        close(fd);
+        unlink(temporary); // sample_store_open() creates it again, empty
+        path = temporary;
+    }
+    if (sample_store_open(&store, path, 1) != 0) {
+        perror(path);
+        return 1;
+    }
+
+    bench_devices = calloc(count, sizeof *bench_devices);
+    if (bench_devices == NULL) {
+        perror("calloc");
+        return 1;
+    }
+    for (unsigned d = 0; d < count; d++) {
+        if (open_pty() == NULL) {
+            return 1;
+        }
+    }
+    stored_hook = bench_stored;
+
+    int64_t first_ns = clock_ns(CLOCK_REALTIME);
+    pthread_create(&generator, NULL, bench_generate, NULL);
+    int result = ingest();
+    pthread_join(generator, NULL);
+    double elapsed = bench_elapsed;
+
+    unsigned long long sent = 0;
+    unsigned long long overrun = 0;
+    unsigned long long bytes = 0;
+    unsigned long lost = 0;
+    unsigned long bad = 0;
+    unsigned long dropped = 0;
+    for (unsigned d = 0; d < count; d++) {
+        sent += bench_devices[d].sent_frames;
+        overrun += bench_devices[d].overrun_bytes;
+        bytes += devices[d].bytes;
+        lost += devices[d].decoder.lost_frames;
+        bad += devices[d].decoder.bad_frames;
+        dropped += devices[d].dropped;
+    }
+
+    printf("devices              %u at %ld baud\n", count, bench_baud);
+    printf("seconds              %.2f\n", elapsed);
+    printf("frames sent          %llu\n", sent);
+    printf("bytes read           %llu (%.2f MB/s)\n", bytes, bytes / elapsed / 1e6);
+    printf("rows stored          %llu (%.0f rows/s)\n", stored_rows, stored_rows / elapsed);
+    printf("line rate            %.0f rows/s\n",
+           count * (bench_baud / 10.0) / BENCH_FRAME_SIZE * BENCH_VALUES);
+    printf("bad/lost/dropped     %lu/%lu/%lu frames\n", bad, lost, dropped);
+    printf("overrun              %llu bytes the ingest did not take in time\n", overrun);
+    if (bench_latencies != 0) {
+        printf("latency us           p50 %lld  p99 %lld  p99.9 %lld  max %lld\n",
+               bench_percentile(0.5), bench_percentile(0.99), bench_percentile(0.999), (long long) bench_max_us);
+    }
+
+    // One second from the middle of the run, through the index
+    int64_t middle = first_ns + (int64_t) (elapsed * 5e8);
+    int64_t query_start = clock_ns(CLOCK_MONOTONIC);
+    uint64_t found = sample_store_query(&store, middle, middle + 1000000000LL, NULL, NULL);
+    int64_t query_ns = clock_ns(CLOCK_MONOTONIC) - query_start;
+    printf("range query 1 s      %llu rows in %.3f ms\n", (unsigned long long) found, query_ns / 1e6);
+
+    sample_store_close(&store);
+    if (path == temporary) {
+        unlink(temporary);
+    }
+    return result == 0 ? 0 : 1;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-b baud] [-p ptys] -o <sample file> [serial port ...]\n"
+                    "       %s -q <from>,<to> <sample file>\n"
+                    "       %s -B <devices> [-b baud] [-s seconds] [-o sample file]\n", name, name, name);
+}
+
+int main(int argc, char **argv) {
+    long baud = 0;
+    unsigned ptys = 0;
+    unsigned bench_count = 0;
+    const char *output = NULL;
+    const char *range = NULL;
+    int option;
+
+    bench_seconds = 10;
+    while ((option = getopt(argc, argv, "b:p:o:q:B:s:h")) != -1) {
+        switch (option) {
+            case 'b':
+                baud = strtol(optarg, NULL, 10);
+                break;
+            case 'p':
+                ptys = (unsigned) strtoul(optarg, NULL, 10);
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'q':
+                range = optarg;
+                break;
+            case 'B':
+                bench_count = (unsigned) strtoul(optarg, NULL, 10);
+                break;
+            case 's':
+                bench_seconds = strtod(optarg, NULL);
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    if (range != NULL) {
+        if (optind != argc - 1) {
+            usage(argv[0]);
+            return 2;
+        }
+        return query(range, argv[optind]);
+    }
+
+    devices = aligned_alloc(64, MAX_DEVICES * sizeof *devices);
+    if (devices == NULL) {
+        perror("aligned_alloc");
+        return 1;
+    }
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (bench_count != 0) {
+        if (optind != argc || bench_count > MAX_DEVICES || bench_seconds <= 0) {
+            usage(argv[0]);
+            return 2;
+        }
+        bench_baud = baud != 0 ? baud : 230400;
+        return bench(bench_count, output);
+    }
+
+    if (output == NULL || (optind == argc && ptys == 0)) {
+        usage(argv[0]);
+        return 2;
+    }
+    for (int i = optind; i < argc; i++) {
+        if (open_port(argv[i], baud != 0 ? baud : 9600) != 0) {
+            return 1;
+        }
+    }
+    for (unsigned i = 0; i < ptys; i++) {
+        device_t *device = open_pty();
+        if (device == NULL) {
+            return 1;
+        }
+        printf("%s\n", device->name);
+    }
+    fflush(stdout);
+    if (sample_store_open(&store, output, 1) != 0) {
+        perror(output);
+        return 1;
+    }
+
+    int result = ingest();
+    print_devices();
+    sample_store_close(&store);
+    return result == 0 ? 0 : 1;
+}
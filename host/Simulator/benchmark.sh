@@ -0,0 +1,58 @@
+#!/bin/sh
+#**********************************************************************************
+# Runs every sample on the host simulator and prints the numbers side by side
+#
+# Usage: host/Simulator/benchmark.sh [virtual milliseconds, default 10000]
+#
+# Each sample is built with gcc against the stand-in xc.h and driven by the
+# stimulus file of the same name in host/Simulator/stimulus, if there is one.
+# The runs are deterministic, so two runs of the same tree print the same table
+# and a change in a sample shows up as a change in its column. The simulator
+# charges only register accesses, the arithmetic in between costs nothing, so the
+# numbers ending in _at_least are lower bounds and those in _at_most upper ones.
+#**********************************************************************************
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/../.." && pwd)
+SIM="$ROOT/host/Simulator"
+TIME_MS=${1:-10000}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+SAMPLES="AnalogRead/analogRead ButtonInput/buttonInput Capture/capture DDS/dds Interrupt/interrupt LowPower/lowPower PID/pid PWM/pwm Scheduler/scheduler UART/uart"
+METRICS="fosc_hz busy_wait_percent_at_most delay_percent polling_percent_at_most idle_loop_percent_at_most
+isr_percent_at_least sleep_percent_at_most awake_us_per_wake_at_least adc_awake_us_per_sample_at_least
+adc_on_percent uart_on_percent interrupts ccp1_capture_rate_hz isr_latency_avg_us_at_least
+isr_latency_max_us_at_least isr_longest_cycles_at_least uart_baud uart_baud_error_percent
+uart_tx_bytes_per_s uart_rx_overruns adc_samples_per_s adc_triggered_percent adc_tad_us adc_conversion_us
+pwm_frequency_hz pwm_duty_percent pwm_write_jitter_us"
+
+# Warnings stop the run. The samples use XC8's #pragma config and void main().
+CFLAGS="-O1 -Wall -Wextra -Werror -Wno-unknown-pragmas -Wno-main"
+
+for sample in $SAMPLES; do
+    name=$(basename "$sample")
+    gcc $CFLAGS -I "$SIM" "$ROOT/src/$sample.c" "$SIM/simulator.c" -o "$WORK/$name"
+
+    stimulus="$SIM/stimulus/$name.txt"
+    [ -f "$stimulus" ] || stimulus=
+
+    PIC_SIM_TIME_MS=$TIME_MS PIC_SIM_STIMULUS=$stimulus PIC_SIM_REPORT="$WORK/$name.report" \
+        PIC_SIM_UART_OUT=/dev/null "$WORK/$name"
+done
+
+printf "%-34s" "$TIME_MS ms"
+for sample in $SAMPLES; do
+    printf "%14s" "$(basename "$sample")"
+done
+printf "\n"
+
+for metric in $METRICS; do
+    printf "%-34s" "$metric"
+    for sample in $SAMPLES; do
+        value=$(awk -v key="$metric" '$1 == key { print $2 }' "$WORK/$(basename "$sample").report")
+        printf "%14s" "${value:--}"
+    done
+    printf "\n"
+done
@@ -0,0 +1,1567 @@
+//**********************************************************************************
+// Host model of the PIC12F1822 peripherals used by the samples
+//
+// The firmware runs natively. Every SFR access costs one instruction cycle of
+// virtual time; before the access returns the peripherals are brought up to date
+// and, when GIE allows it, the interrupt routine is called. Side effects that
+// depend on a write (TXREG, PORTA) are handled on the next access, which is when
+// the write done through the returned pointer has landed.
+//
+// Code that does not touch an SFR costs no virtual time, so the cycle counts are a
+// lower bound for the arithmetic in between. The report keys that depend on it
+// say so: the ones ending in _at_least are lower bounds, _at_most upper bounds. Everything that waits on hardware
+// (delays, polling loops, peripherals, interrupt latency) is timed from the
+// register settings: Fosc from OSCCON, the bit rate from SPBRG/BRG16/BRGH, the
+// ADC conversion from ADCS, the Timer2/PWM period from PR2 and the prescaler,
+// Timer0 from OPTION_REG and Timer1 from T1CON, including the CCP1 compare,
+// capture and special event trigger and the Timer1 gate. The timers stop in SLEEP, interrupt-on-change, the
+// watchdog and Timer1 on its own crystal do not. The data EEPROM takes 4 ms per
+// write and can be kept in a file from one run to the next.
+// A stimulus can close a loop from the PWM or the DAC back to an ADC channel
+// through a first order plant, or drive a pin with a square wave.
+// A report of what happened is printed on stderr when the program exits.
+//**********************************************************************************
+
+#include "xc.h"
+#include "simulator.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PIC_SIM_MAX_EVENTS 1024
+
+enum {
+    EVENT_PIN,
+    EVENT_ADC,
+    EVENT_RX,
+    EVENT_PLANT, // channel and time constant in ms
+    EVENT_PLANT_SCALE, // ADC reading at full drive
+    EVENT_CLOCK // pin, period and high time in ns
+};
+
+typedef struct {
+    uint64_t time;
+    uint8_t type;
+    uint8_t channel;
+    uint64_t value;
+    uint64_t value2;
+} pic_event_t;
+
+// The register file. Aligned so the 16 bit views of the low/high pairs work.
+static volatile uint8_t sfr[PIC_SFR_COUNT] __attribute__((aligned(2)));
+
+static uint64_t now_ns;
+static uint64_t cycles;
+static uint64_t time_limit = PIC_SIM_MS(1000);
+static int last_access = -1;
+static uint8_t last_porta;
+static int in_isr;
+
+static pic_event_t events[PIC_SIM_MAX_EVENTS];
+static size_t event_count;
+static size_t event_next;
+
+static uint8_t pins;
+static uint8_t traced_outputs;
+static int trace_pins;
+static uint16_t adc_values[32];
+static pic_sim_adc_source_t adc_source;
+static pic_sim_adc_sink_t adc_sink;
+
+static uint32_t line_baud = 9600; // Rate of the PC at the other end of the line
+static FILE *uart_out;
+static pic_sim_uart_sink_t uart_sink;
+
+// EUSART transmitter: TXREG -> TSR -> TX pin
+static int txreg_full;
+static uint8_t txreg_data;
+static int tsr_busy;
+static uint8_t tsr_data;
+static uint64_t tsr_done;
+
+// EUSART receiver: two byte FIFO behind RCREG
+static uint8_t rx_fifo[2];
+static int rx_count;
+static uint64_t rx_line_free;
+
+// ADC
+static int adc_busy;
+static uint64_t adc_done;
+
+// Timer0 counts from tmr0_origin_count at tmr0_origin on, like Timer1 below
+static int tmr0_running;
+static uint64_t tmr0_origin;
+static uint32_t tmr0_origin_count;
+static uint8_t tmr0_published;
+
+// Timer1 counts from tmr1_origin_count at tmr1_origin on
+static int tmr1_running;
+static uint64_t tmr1_origin;
+static uint32_t tmr1_origin_count;
+static uint16_t tmr1_published; // Last value put in TMR1H:TMR1L, a difference is a write
+
+// Timer1 gate from the T1G pin, after the polarity and the toggle flip-flop
+static int t1g_input;
+static int t1g_toggle;
+static int t1g_signal;
+static int t1g_value; // T1GVAL, Timer1 counts while it is set and TMR1GE is
+
+// CCP1 capture prescaler, counts rising edges for the 1:4 and 1:16 modes
+static uint8_t ccp1_capture_mode;
+static uint8_t ccp1_edges;
+
+// Square waves a stimulus drives on the pins, external so they go on in SLEEP
+static struct {
+    uint64_t period;
+    uint64_t high;
+    uint64_t rise; // Start of the current period
+    uint64_t next; // Next edge
+    int on;
+} clocks[6];
+
+// The watchdog runs from LFINTOSC while SWDTEN is set, as with WDTE = SWDTEN
+static int wdt_running;
+static uint64_t wdt_origin; // Last CLRWDT, SLEEP or change of WDTCON
+static uint8_t wdt_published;
+static int wdt_woke;
+
+// Data EEPROM, erased to 0xFF unless PIC_SIM_EEPROM names a file to start from
+#define EEPROM_SIZE 256
+#define EEPROM_WRITE_NS PIC_SIM_MS(4)
+
+static uint8_t eeprom[EEPROM_SIZE];
+static uint32_t eeprom_wear[EEPROM_SIZE]; // Writes of every byte in this run
+static const char *eeprom_path;
+static int eeprom_unlock; // 1 after 0x55 went to EECON2, 2 after 0xAA followed
+static int eeprom_busy;
+static uint64_t eeprom_done;
+static uint8_t eeprom_address;
+static uint8_t eeprom_data;
+
+// Timer2, which also sets the PWM period
+static int tmr2_running;
+static uint64_t tmr2_period_start;
+static uint64_t tmr2_period_end;
+static uint8_t tmr2_postscale_count;
+static FILE *pwm_out; // Duty cycle of every PWM period
+static pic_sim_pwm_sink_t pwm_sink;
+static uint64_t pwm_write_offset = UINT64_MAX; // Of the last CCPR1L access in this period
+
+// First order plant between the PWM or DAC output and an ADC channel, like an
+// RC filter, a heater or a motor: it follows its input with a time constant
+static int plant_channel = -1;
+static uint64_t plant_tau_ns;
+static uint16_t plant_full_scale = 1023;
+static double plant_output;
+static uint64_t plant_time;
+
+// Numbers for the report
+static struct {
+    uint64_t delay_cycles;
+    uint64_t polling_cycles;
+    uint64_t idle_cycles; // NOP() in an empty main loop
+    uint64_t isr_cycles;
+    uint64_t isr_longest;
+    uint64_t interrupts;
+    uint64_t latency_total;
+    uint64_t latency_min;
+    uint64_t latency_max;
+    uint64_t tx_bytes;
+    uint64_t tx_bad_bytes; // Sent at a rate the PC cannot read
+    uint64_t rx_bytes;
+    uint64_t rx_overruns;
+    uint64_t adc_conversions;
+    uint64_t adc_triggers; // Conversions started by the CCP1 special event
+    uint64_t ccp1_matches;
+    uint64_t ccp1_captures;
+    uint64_t tmr1_gate_events; // Falling edges of T1GVAL while the gate is enabled
+    uint64_t tmr2_periods;
+    uint64_t tmr0_overflows;
+    uint64_t pwm_writes; // Accesses to CCPR1L while the PWM runs
+    uint64_t pwm_write_min; // Time of those after the start of the period
+    uint64_t pwm_write_max;
+    uint64_t sleep_ns;
+    uint64_t sleeps;
+    uint64_t wdt_wakes;
+    uint64_t adc_on_ns; // ADON set, the ADC draws current
+    uint64_t eeprom_writes;
+    uint64_t eeprom_write_errors; // WR set without the unlock sequence
+    uint64_t uart_on_ns; // SPEN set, the EUSART draws current
+} stats = { .latency_min = UINT64_MAX, .pwm_write_min = UINT64_MAX };
+
+static int sleeping; // The oscillator is off, the timers stand still
+static uint64_t last_step; // For the time the ADC and the EUSART were on
+static uint64_t pending_since;
+static uint64_t quiet_until; // Nothing can happen before this time unless the firmware acts
+static int poll_sfr = -1;
+static uint8_t poll_value;
+static const char *report_path;
+
+extern char __start_pic_isr[] __attribute__((weak));
+extern char __stop_pic_isr[] __attribute__((weak));
+
+static void bring_up_to_date(void);
+static uint64_t next_deadline(uint64_t target);
+
+// Instruction clock from the OSCCON settings
+static uint32_t fosc(void) {
+    static const uint32_t ircf[16] = {
+        31000, 31000, 31250, 31250, 62500, 125000, 250000, 500000,
+        125000, 250000, 500000, 1000000, 2000000, 4000000, 8000000, 16000000
+    };
+    uint8_t osccon = sfr[PIC_SFR_OSCCON];
+    uint8_t index = (osccon >> 3) & 0x0F;
+
+    if ((osccon & 0x80) && index == 0x0E) {
+        return 32000000; // 8 MHz HFINTOSC through the 4x PLL
+    }
+    return ircf[index];
+}
+
+static uint64_t tcy_ns(void) {
+    return 4000000000ULL / fosc();
+}
+
+static uint32_t spbrg(void) {
+    uint32_t value = sfr[PIC_SFR_SPBRGL];
+
+    if (sfr[PIC_SFR_BAUDCON] & 0x08) {
+        value |= (uint32_t) sfr[PIC_SFR_SPBRGH] << 8; // BRG16
+    }
+    return value;
+}
+
+// Bit rate the EUSART generates, asynchronous mode
+static double device_baud(void) {
+    int brg16 = (sfr[PIC_SFR_BAUDCON] & 0x08) != 0;
+    int brgh = (sfr[PIC_SFR_TXSTA] & 0x04) != 0;
+    uint32_t divider = brg16 ? (brgh ? 4 : 16) : (brgh ? 16 : 64);
+
+    return (double) fosc() / (divider * (spbrg() + 1));
+}
+
+static uint64_t device_frame_ns(void) {
+    return (uint64_t) (10e9 / device_baud()); // Start bit, 8 data bits, stop bit
+}
+
+static uint64_t line_frame_ns(void) {
+    return 10ULL * 1000000000ULL / line_baud;
+}
+
+// Relative difference between what the EUSART sends and what the PC expects.
+// More than about 5 % over a 10 bit frame and the stop bit is sampled wrong.
+static double baud_error(void) {
+    return (device_baud() - line_baud) / line_baud;
+}
+
+// ADCS selects Fosc/2, /8, /32, FRC, /4, /16, /64, FRC. FRC is about 1.6 us.
+static uint64_t adc_tad_ns(void) {
+    static const uint32_t divider[8] = { 2, 8, 32, 0, 4, 16, 64, 0 };
+    uint8_t adcs = (sfr[PIC_SFR_ADCON1] >> 4) & 0x07;
+
+    if (divider[adcs] == 0) {
+        return 1600;
+    }
+    return (uint64_t) divider[adcs] * 1000000000ULL / fosc();
+}
+
+static uint64_t adc_conversion_ns(void) {
+    return adc_tad_ns() * 23 / 2; // 11.5 TAD for a 10 bit result
+}
+
+// Fosc/4 or the T0CKI pin, which is not modelled, through the prescaler unless PSA
+static uint64_t tmr0_tick_ns(void) {
+    uint8_t option = sfr[PIC_SFR_OPTION_REG];
+
+    if (option & 0x08) {
+        return tcy_ns();
+    }
+    return tcy_ns() << ((option & 0x07) + 1);
+}
+
+static uint64_t tmr0_overflow_ns(void) {
+    return tmr0_origin + (256 - tmr0_origin_count) * tmr0_tick_ns();
+}
+
+static uint16_t sfr16(int low) {
+    return (uint16_t) (sfr[low] | (sfr[low + 1] << 8));
+}
+
+// TMR1CS selects Fosc/4, Fosc or the T1CKI pin, which with T1OSCEN is the 32.768
+// kHz crystal oscillator on RA4/RA5. The pin itself is not modelled and counts like
+// Fosc/4.
+static uint64_t tmr1_tick_ns(void) {
+    uint8_t t1con = sfr[PIC_SFR_T1CON];
+    uint64_t tick = tcy_ns();
+
+    if ((t1con >> 6) == 0x01) {
+        tick = tcy_ns() / 4;
+    } else if ((t1con >> 6) == 0x02 && (t1con & 0x08)) {
+        tick = 30518; // 1 / 32768 Hz
+    }
+    return tick << ((t1con >> 4) & 0x03);
+}
+
+// Asynchronous on the crystal (nT1SYNC), the only way Timer1 counts in SLEEP
+static int tmr1_async(void) {
+    return (sfr[PIC_SFR_T1CON] & 0xCC) == 0x8C;
+}
+
+static uint8_t ccp1_mode(void) {
+    return sfr[PIC_SFR_CCP1CON] & 0x0F;
+}
+
+// Timer1 counts while TMR1ON is set and, with TMR1GE, while the gate is open
+static int tmr1_enabled(void) {
+    return (sfr[PIC_SFR_T1CON] & 0x01) && (!(sfr[PIC_SFR_T1GCON] & 0x80) || t1g_value);
+}
+
+// TMR1 at the current time, also in between two steps
+static uint16_t tmr1_count(void) {
+    if (!tmr1_running || sfr16(PIC_SFR_TMR1L) != tmr1_published || (sleeping && !tmr1_async())) {
+        return sfr16(PIC_SFR_TMR1L);
+    }
+    return (uint16_t) (tmr1_origin_count + (now_ns - tmr1_origin) / tmr1_tick_ns());
+}
+
+// Count at which the next Timer1 event happens: the overflow, a compare match or,
+// for the special event trigger, the reset one tick after TMR1 reached CCPR1
+static uint32_t tmr1_event_count(void) {
+    uint32_t ccpr1 = sfr16(PIC_SFR_CCPR1L);
+    uint8_t mode = ccp1_mode();
+
+    if (mode == 0x0B && ccpr1 + 1 > tmr1_origin_count) {
+        return ccpr1 + 1;
+    }
+    if (mode >= 0x08 && mode <= 0x0A && ccpr1 > tmr1_origin_count) {
+        return ccpr1;
+    }
+    return 0x10000;
+}
+
+static uint64_t tmr1_event_ns(void) {
+    return tmr1_origin + (tmr1_event_count() - tmr1_origin_count) * tmr1_tick_ns();
+}
+
+static uint32_t tmr2_prescale(void) {
+    static const uint32_t prescale[4] = { 1, 4, 16, 64 };
+    return prescale[sfr[PIC_SFR_T2CON] & 0x03];
+}
+
+static uint64_t tmr2_tick_ns(void) {
+    return tmr2_prescale() * tcy_ns();
+}
+
+// TMR2 counts from 0 to PR2, the match resets it and clocks the postscaler
+static uint64_t tmr2_period_ns(void) {
+    return ((uint64_t) sfr[PIC_SFR_PR2] + 1) * tmr2_tick_ns();
+}
+
+static void refresh_status(void) {
+    // Read-only bits follow the state of the peripherals
+    if (txreg_full) {
+        sfr[PIC_SFR_PIR1] &= (uint8_t) ~0x10;
+    } else {
+        sfr[PIC_SFR_PIR1] |= 0x10;
+    }
+    if (tsr_busy) {
+        sfr[PIC_SFR_TXSTA] &= (uint8_t) ~0x02;
+    } else {
+        sfr[PIC_SFR_TXSTA] |= 0x02;
+    }
+    if (rx_count) {
+        sfr[PIC_SFR_PIR1] |= 0x20;
+        sfr[PIC_SFR_RCREG] = rx_fifo[0];
+    } else {
+        sfr[PIC_SFR_PIR1] &= (uint8_t) ~0x20;
+    }
+    if (tmr2_running && !sleeping) {
+        sfr[PIC_SFR_TMR2] = (uint8_t) ((now_ns - tmr2_period_start) / tmr2_tick_ns());
+    }
+    // The internal oscillators are stable right away, PLLR follows the PLL
+    sfr[PIC_SFR_OSCSTAT] = (uint8_t) (0x1F | (fosc() == 32000000 ? 0x40 : 0));
+    if (sfr[PIC_SFR_FVRCON] & 0x80) {
+        sfr[PIC_SFR_FVRCON] |= 0x40; // FVRRDY, the reference settles right away
+    } else {
+        sfr[PIC_SFR_FVRCON] &= (uint8_t) ~0x40;
+    }
+    if (tmr0_running && !sleeping) {
+        tmr0_published = (uint8_t) (tmr0_origin_count + (now_ns - tmr0_origin) / tmr0_tick_ns());
+        sfr[PIC_SFR_TMR0] = tmr0_published;
+    }
+    sfr[PIC_SFR_INTCON] = (uint8_t) ((sfr[PIC_SFR_INTCON] & ~0x01) | (sfr[PIC_SFR_IOCAF] ? 0x01 : 0));
+    if (tmr1_running && (!sleeping || tmr1_async())) {
+        tmr1_published = (uint16_t) (tmr1_origin_count + (now_ns - tmr1_origin) / tmr1_tick_ns());
+        sfr[PIC_SFR_TMR1L] = (uint8_t) tmr1_published;
+        sfr[PIC_SFR_TMR1H] = (uint8_t) (tmr1_published >> 8);
+    }
+    sfr[PIC_SFR_T1GCON] = (uint8_t) ((sfr[PIC_SFR_T1GCON] & ~0x04) | (t1g_value ? 0x04 : 0));
+
+    // Digital inputs read the pin, outputs read back the latch, analog pins read 0
+    uint8_t tris = sfr[PIC_SFR_TRISA] & 0x3F;
+    uint8_t analog = sfr[PIC_SFR_ANSELA] & 0x17;
+    sfr[PIC_SFR_PORTA] = (uint8_t) (((pins & tris) | (sfr[PIC_SFR_LATA] & ~tris)) & ~analog & 0x3F);
+    last_porta = sfr[PIC_SFR_PORTA];
+
+    uint8_t outputs = sfr[PIC_SFR_LATA] & ~tris & 0x3F;
+    if (trace_pins && outputs != traced_outputs) {
+        for (int pin = 0; pin < 6; pin++) {
+            if ((outputs ^ traced_outputs) & (1u << pin)) {
+                fprintf(stderr, "%12.6f ms RA%d %d\n", now_ns / 1e6, pin, (outputs >> pin) & 1);
+            }
+        }
+    }
+    traced_outputs = outputs;
+}
+
+// RD reads a byte of the data EEPROM right away. WR starts a write only right
+// after the unlock sequence and with WREN set, and stays set until it is done.
+// Flash (EEPGD) and configuration (CFGS) accesses are not modelled.
+static void commit_eecon1(void) {
+    uint8_t eecon1 = sfr[PIC_SFR_EECON1];
+
+    if (eecon1 & 0xC0) {
+        sfr[PIC_SFR_EECON1] = (uint8_t) (eecon1 & ~0x03);
+        return;
+    }
+    if (eecon1 & 0x01) {
+        sfr[PIC_SFR_EEDATL] = eeprom[sfr[PIC_SFR_EEADRL]];
+        sfr[PIC_SFR_EECON1] &= (uint8_t) ~0x01;
+    }
+    if ((eecon1 & 0x02) && !eeprom_busy) {
+        if (eeprom_unlock == 2 && (eecon1 & 0x04)) {
+            eeprom_busy = 1;
+            eeprom_done = now_ns + EEPROM_WRITE_NS;
+            eeprom_address = sfr[PIC_SFR_EEADRL];
+            eeprom_data = sfr[PIC_SFR_EEDATL];
+        } else {
+            sfr[PIC_SFR_EECON1] &= (uint8_t) ~0x02;
+            stats.eeprom_write_errors++;
+        }
+    }
+    if (eeprom_busy) {
+        sfr[PIC_SFR_EECON1] |= 0x02; // Firmware can not clear WR
+    }
+}
+
+static void finish_eeprom(void) {
+    eeprom[eeprom_address] = eeprom_data;
+    eeprom_wear[eeprom_address]++;
+    eeprom_busy = 0;
+    sfr[PIC_SFR_EECON1] &= (uint8_t) ~0x02;
+    sfr[PIC_SFR_PIR2] |= 0x10; // EEIF
+    stats.eeprom_writes++;
+}
+
+// Applies the side effects of the access that happened just before this one
+static void commit_last_access(void) {
+    switch (last_access) {
+        case PIC_SFR_TXREG:
+            // TXREG is write only, any access to it is a write
+            if (sfr[PIC_SFR_TXSTA] & 0x20) {
+                txreg_full = 1;
+                txreg_data = sfr[PIC_SFR_TXREG];
+            }
+            break;
+        case PIC_SFR_RCREG:
+            // Reading RCREG pops the FIFO
+            if (rx_count) {
+                rx_fifo[0] = rx_fifo[1];
+                rx_count--;
+            }
+            break;
+        case PIC_SFR_PORTA:
+            // A write to PORTA lands in LATA
+            if (sfr[PIC_SFR_PORTA] != last_porta) {
+                sfr[PIC_SFR_LATA] = sfr[PIC_SFR_PORTA];
+            }
+            break;
+        case PIC_SFR_EECON2:
+            // Write only, the unlock sequence is 0x55 and then 0xAA
+            eeprom_unlock = sfr[PIC_SFR_EECON2] == 0x55 ? 1 :
+                            (sfr[PIC_SFR_EECON2] == 0xAA && eeprom_unlock == 1) ? 2 : 0;
+            sfr[PIC_SFR_EECON2] = 0;
+            last_access = -1;
+            return;
+        case PIC_SFR_EECON1:
+            commit_eecon1();
+            break;
+        default:
+            break;
+    }
+    eeprom_unlock = 0; // The sequence only counts right before WR is set
+    last_access = -1;
+}
+
+static void emit_uart(uint8_t data) {
+    stats.tx_bytes++;
+    if (baud_error() > 0.05 || baud_error() < -0.05) {
+        stats.tx_bad_bytes++;
+    }
+    if (uart_sink) {
+        uart_sink(data, now_ns);
+    } else {
+        fputc(data, uart_out ? uart_out : stdout);
+    }
+}
+
+// Works out T1GVAL from the T1G pin, RA4 or RA3 with T1GSEL. The Timer0 and
+// comparator sources of the gate are not modelled and keep it closed.
+static void update_t1g(void) {
+    uint8_t t1gcon = sfr[PIC_SFR_T1GCON];
+    uint8_t pin = (sfr[PIC_SFR_APFCON] & 0x08) ? 3 : 4;
+    int level = ((pins >> pin) & 1) && !(sfr[PIC_SFR_ANSELA] & (1u << pin));
+    int input = (t1gcon & 0x03) == 0 && level == ((t1gcon >> 6) & 1); // T1GPOL
+
+    // Toggle mode: the flip-flop changes on every rising edge of the input, so
+    // the gate stays open for a whole period
+    if (!(t1gcon & 0x20)) {
+        t1g_toggle = 0;
+    } else if (input && !t1g_input) {
+        t1g_toggle = !t1g_toggle;
+    }
+    t1g_input = input;
+
+    int signal = (t1gcon & 0x20) ? t1g_toggle : input;
+    int value = signal;
+    if (t1gcon & 0x10) {
+        // Single pulse: opens on the first rising edge after T1GGO is set and
+        // closes on the next falling edge, which clears T1GGO
+        value = (t1gcon & 0x08) && signal && (t1g_value || !t1g_signal);
+        if (t1g_value && !value) {
+            sfr[PIC_SFR_T1GCON] &= (uint8_t) ~0x08;
+        }
+    }
+    t1g_signal = signal;
+
+    if (t1g_value && !value && (t1gcon & 0x80)) {
+        sfr[PIC_SFR_PIR1] |= 0x80; // TMR1GIF, the gate event is complete
+        stats.tmr1_gate_events++;
+    }
+    t1g_value = value;
+}
+
+// CCP1 on RA2, or RA5 with CCP1SEL, latches TMR1 on the edges its mode selects:
+// every falling, every rising, every 4th or every 16th rising edge
+static void capture_edge(uint8_t pin, int rising) {
+    uint8_t mode = ccp1_mode();
+
+    if (mode < 0x04 || mode > 0x07 || pin != ((sfr[PIC_SFR_APFCON] & 0x01) ? 5 : 2)) {
+        return;
+    }
+    if (mode == 0x04 ? rising : !rising) {
+        return;
+    }
+    if (mode >= 0x06 && ++ccp1_edges < (mode == 0x06 ? 4 : 16)) {
+        return;
+    }
+    ccp1_edges = 0;
+
+    uint16_t count = tmr1_count();
+    sfr[PIC_SFR_CCPR1L] = (uint8_t) count;
+    sfr[PIC_SFR_CCPR1H] = (uint8_t) (count >> 8);
+    sfr[PIC_SFR_PIR1] |= 0x04; // CCP1IF
+    stats.ccp1_captures++;
+}
+
+static void set_pin(uint8_t pin, uint8_t level) {
+    uint8_t mask = (uint8_t) (1u << pin);
+    uint8_t old = pins & mask;
+
+    pins = level ? (uint8_t) (pins | mask) : (uint8_t) (pins & ~mask);
+    if (old != (pins & mask) && !(sfr[PIC_SFR_ANSELA] & mask)) {
+        // Interrupt-on-change works on digital inputs, also in SLEEP
+        if (sfr[level ? PIC_SFR_IOCAP : PIC_SFR_IOCAN] & mask) {
+            sfr[PIC_SFR_IOCAF] |= mask;
+            sfr[PIC_SFR_INTCON] |= 0x01; // IOCIF
+        }
+    }
+    if (pin == 2 && old != (pins & mask)) {
+        // RA2 is also the INT pin, INTEDG selects the active edge
+        int rising = level != 0;
+        int intedg = (sfr[PIC_SFR_OPTION_REG] & 0x40) != 0;
+        if (rising == intedg) {
+            sfr[PIC_SFR_INTCON] |= 0x02;
+        }
+    }
+    if (old != (pins & mask) && !(sfr[PIC_SFR_ANSELA] & mask)) {
+        capture_edge(pin, level != 0);
+        update_t1g();
+    }
+}
+
+// A new period or high time takes over at the next edge. A period of 0 stops
+// the wave and leaves the pin low.
+static void start_clock(uint8_t pin, uint64_t period, uint64_t high) {
+    if (pin > 5) {
+        return;
+    }
+    if (period == 0) {
+        clocks[pin].on = 0;
+        set_pin(pin, 0);
+        return;
+    }
+    clocks[pin].period = period;
+    clocks[pin].high = high > 0 && high < period ? high : period / 2;
+    if (!clocks[pin].on) {
+        clocks[pin].on = 1;
+        clocks[pin].next = now_ns; // Starts with a rising edge
+        set_pin(pin, 0);
+    }
+}
+
+static void step_clock(uint8_t pin) {
+    if (!((pins >> pin) & 1)) {
+        clocks[pin].rise = clocks[pin].next;
+        clocks[pin].next += clocks[pin].high;
+        set_pin(pin, 1);
+    } else {
+        clocks[pin].next = clocks[pin].rise + clocks[pin].period;
+        set_pin(pin, 0);
+    }
+}
+
+static void receive_byte(uint8_t data) {
+    uint8_t rcsta = sfr[PIC_SFR_RCSTA];
+
+    if (!(rcsta & 0x80) || !(rcsta & 0x10) || (rcsta & 0x02)) {
+        return; // Port off, receiver off or stalled by an overrun
+    }
+    if (rx_count == 2) {
+        sfr[PIC_SFR_RCSTA] |= 0x02; // OERR, the receiver stops until CREN is cleared
+        stats.rx_overruns++;
+        return;
+    }
+    rx_fifo[rx_count++] = data;
+    stats.rx_bytes++;
+}
+
+// What drives the plant: the PWM duty cycle while CCP1 is in PWM mode, else the
+// DAC while it is on, as a fraction of full drive
+static double plant_input(void) {
+    if (tmr2_running && (sfr[PIC_SFR_CCP1CON] & 0x0C) == 0x0C) {
+        uint32_t duty = ((uint32_t) sfr[PIC_SFR_CCPR1H] << 2) | ((sfr[PIC_SFR_CCP1CON] >> 4) & 0x03);
+        double fraction = (double) duty / (4.0 * (sfr[PIC_SFR_PR2] + 1));
+        return fraction < 1.0 ? fraction : 1.0;
+    }
+    if (sfr[PIC_SFR_DACCON0] & 0x80) {
+        return (sfr[PIC_SFR_DACCON1] & 0x1F) / 32.0;
+    }
+    return 0.0;
+}
+
+// Moves the plant on to time with the input it has had since the last call
+static void plant_advance(uint64_t time) {
+    if (plant_channel < 0 || time <= plant_time) {
+        return;
+    }
+    double dt = (double) (time - plant_time);
+    double target = plant_input() * plant_full_scale;
+
+    plant_output += (target - plant_output) * dt / ((double) plant_tau_ns + dt);
+    plant_time = time;
+}
+
+static void finish_adc(void) {
+    uint8_t channel = (sfr[PIC_SFR_ADCON0] >> 2) & 0x1F;
+    uint16_t value = adc_source ? adc_source(channel, now_ns) : adc_values[channel];
+
+    if (channel == plant_channel) {
+        plant_advance(now_ns);
+        value = (uint16_t) (plant_output + 0.5);
+    }
+
+    // The internal channels read 0 while their source is switched off
+    if ((channel == PIC_SIM_ADC_FVR && !(sfr[PIC_SFR_FVRCON] & 0x80)) ||
+        (channel == PIC_SIM_ADC_TEMPERATURE && !(sfr[PIC_SFR_FVRCON] & 0x20))) {
+        value = 0;
+    }
+
+    value &= 0x3FF;
+    if (adc_sink) {
+        adc_sink(channel, value, now_ns);
+    }
+    if (sfr[PIC_SFR_ADCON1] & 0x80) {
+        sfr[PIC_SFR_ADRESH] = (uint8_t) (value >> 8);
+        sfr[PIC_SFR_ADRESL] = (uint8_t) value;
+    } else {
+        sfr[PIC_SFR_ADRESH] = (uint8_t) (value >> 2);
+        sfr[PIC_SFR_ADRESL] = (uint8_t) (value << 6);
+    }
+    sfr[PIC_SFR_ADCON0] &= (uint8_t) ~0x02; // GO/DONE clears
+    sfr[PIC_SFR_PIR1] |= 0x40; // ADIF
+    adc_busy = 0;
+    stats.adc_conversions++;
+}
+
+static void start_adc(uint64_t at) {
+    sfr[PIC_SFR_ADCON0] |= 0x02; // GO/DONE
+    adc_busy = 1;
+    adc_done = at + adc_conversion_ns();
+}
+
+// Timer0 always runs. A write to TMR0 starts the count over from that value.
+static void step_tmr0(void) {
+    if (!tmr0_running || sfr[PIC_SFR_TMR0] != tmr0_published) {
+        tmr0_running = 1;
+        tmr0_origin = now_ns;
+        tmr0_origin_count = sfr[PIC_SFR_TMR0];
+        tmr0_published = sfr[PIC_SFR_TMR0];
+    }
+
+    uint64_t at;
+    while ((at = tmr0_overflow_ns()) <= now_ns) {
+        sfr[PIC_SFR_INTCON] |= 0x04; // TMR0IF
+        stats.tmr0_overflows++;
+        tmr0_origin = at;
+        tmr0_origin_count = 0;
+    }
+}
+
+// Counts up to the current time, with the overflows and compare matches on the way
+static void advance_tmr1(void) {
+    uint64_t at;
+    while ((at = tmr1_event_ns()) <= now_ns) {
+        uint32_t count = tmr1_event_count();
+
+        tmr1_origin = at;
+        if (count == 0x10000) {
+            sfr[PIC_SFR_PIR1] |= 0x01; // TMR1IF
+            tmr1_origin_count = 0;
+            continue;
+        }
+
+        sfr[PIC_SFR_PIR1] |= 0x04; // CCP1IF
+        stats.ccp1_matches++;
+        if (ccp1_mode() == 0x0B) {
+            // Special event trigger: Timer1 restarts and the ADC converts if it is on
+            tmr1_origin_count = 0;
+            if ((sfr[PIC_SFR_ADCON0] & 0x01) && !adc_busy) {
+                start_adc(at);
+                stats.adc_triggers++;
+            }
+        } else {
+            tmr1_origin_count = count;
+        }
+    }
+}
+
+static void step_tmr1(void) {
+    if (!tmr1_enabled()) {
+        if (tmr1_running && sfr16(PIC_SFR_TMR1L) == tmr1_published) {
+            // Stopped by TMR1ON or the gate, TMR1 holds the count it got to
+            advance_tmr1();
+            tmr1_published = tmr1_count();
+            sfr[PIC_SFR_TMR1L] = (uint8_t) tmr1_published;
+            sfr[PIC_SFR_TMR1H] = (uint8_t) (tmr1_published >> 8);
+        }
+        tmr1_running = 0;
+        return;
+    }
+    if (!tmr1_running || sfr16(PIC_SFR_TMR1L) != tmr1_published) {
+        // Just switched on, the gate opened or the firmware wrote TMR1
+        tmr1_running = 1;
+        tmr1_origin = now_ns;
+        tmr1_origin_count = sfr16(PIC_SFR_TMR1L);
+        tmr1_published = (uint16_t) tmr1_origin_count;
+    }
+    advance_tmr1();
+}
+
+static void step_tmr2(void) {
+    int on = (sfr[PIC_SFR_T2CON] & 0x04) != 0;
+
+    if (on && !tmr2_running) {
+        tmr2_running = 1;
+        tmr2_period_start = now_ns;
+        tmr2_period_end = now_ns + tmr2_period_ns();
+    } else if (!on) {
+        tmr2_running = 0;
+        return;
+    }
+
+    while (now_ns >= tmr2_period_end) {
+        uint8_t postscale = (uint8_t) (((sfr[PIC_SFR_T2CON] >> 3) & 0x0F) + 1);
+
+        stats.tmr2_periods++;
+        if (++tmr2_postscale_count >= postscale) {
+            tmr2_postscale_count = 0;
+            sfr[PIC_SFR_PIR1] |= 0x02; // TMR2IF
+        }
+
+        // The plant saw the old duty cycle until the end of the period
+        plant_advance(tmr2_period_end);
+
+        // In PWM mode the duty cycle written to CCPR1L is latched at the period start
+        if ((sfr[PIC_SFR_CCP1CON] & 0x0C) == 0x0C) {
+            uint16_t duty = (uint16_t) ((sfr[PIC_SFR_CCPR1L] << 2) | ((sfr[PIC_SFR_CCP1CON] >> 4) & 0x03));
+
+            sfr[PIC_SFR_CCPR1H] = sfr[PIC_SFR_CCPR1L];
+            if (pwm_out) {
+                fprintf(pwm_out, "%u\n", duty);
+            }
+            if (pwm_sink) {
+                pwm_sink(duty, tmr2_period_end, pwm_write_offset);
+            }
+        }
+        pwm_write_offset = UINT64_MAX;
+
+        tmr2_period_start = tmr2_period_end;
+        tmr2_period_end += tmr2_period_ns();
+    }
+}
+
+// WDTPS selects 1:32 (1 ms) up to 1:8388608 (256 s) of the 31 kHz LFINTOSC
+static uint64_t wdt_period_ns(void) {
+    uint8_t wdtps = (sfr[PIC_SFR_WDTCON] >> 1) & 0x1F;
+
+    if (wdtps > 0x12) {
+        wdtps = 0x0B; // Reserved, the default of 2 s
+    }
+    return (32ULL << wdtps) * 1000000000ULL / 31000;
+}
+
+// A time-out wakes the core from SLEEP and resets it otherwise. The simulator
+// cannot restart the firmware, so a reset ends the run with an error.
+static void step_wdt(void) {
+    uint8_t wdtcon = sfr[PIC_SFR_WDTCON];
+
+    if (!(wdtcon & 0x01)) {
+        wdt_running = 0;
+        return;
+    }
+    if (!wdt_running || wdtcon != wdt_published) {
+        // Switched on or a new prescaler, which counts from 0 here
+        wdt_running = 1;
+        wdt_origin = now_ns;
+        wdt_published = wdtcon;
+    }
+    if (now_ns >= wdt_origin + wdt_period_ns()) {
+        if (!sleeping) {
+            fprintf(stderr, "%12.6f ms watchdog reset\n", now_ns / 1e6);
+            exit(1);
+        }
+        wdt_origin = now_ns;
+        wdt_woke = 1;
+        stats.wdt_wakes++;
+    }
+}
+
+// Runs everything that is due at the current virtual time
+static void step(void) {
+    // The capture prescaler starts over when the mode changes
+    if (ccp1_mode() != ccp1_capture_mode) {
+        ccp1_capture_mode = ccp1_mode();
+        ccp1_edges = 0;
+    }
+
+    while (event_next < event_count && events[event_next].time <= now_ns) {
+        pic_event_t *event = &events[event_next++];
+        switch (event->type) {
+            case EVENT_PIN:
+                set_pin(event->channel, (uint8_t) event->value);
+                break;
+            case EVENT_ADC:
+                adc_values[event->channel & 0x1F] = event->value;
+                break;
+            case EVENT_RX:
+                receive_byte((uint8_t) event->value);
+                break;
+            case EVENT_PLANT:
+                plant_advance(now_ns);
+                if (plant_channel < 0) {
+                    plant_time = now_ns;
+                }
+                plant_channel = event->channel & 0x1F;
+                plant_tau_ns = PIC_SIM_MS(event->value ? event->value : 1);
+                break;
+            case EVENT_PLANT_SCALE:
+                plant_advance(now_ns);
+                plant_full_scale = (uint16_t) event->value;
+                break;
+            case EVENT_CLOCK:
+                start_clock(event->channel, event->value, event->value2);
+                break;
+        }
+    }
+    for (uint8_t pin = 0; pin < 6; pin++) {
+        while (clocks[pin].on && clocks[pin].next <= now_ns) {
+            step_clock(pin);
+        }
+    }
+
+    // Clearing CREN resets the receiver and clears OERR
+    if (!(sfr[PIC_SFR_RCSTA] & 0x10)) {
+        sfr[PIC_SFR_RCSTA] &= (uint8_t) ~0x02;
+    }
+
+    if (tsr_busy && now_ns >= tsr_done) {
+        tsr_busy = 0;
+        emit_uart(tsr_data);
+    }
+    if (txreg_full && !tsr_busy) {
+        tsr_busy = 1;
+        tsr_data = txreg_data;
+        tsr_done = now_ns + device_frame_ns();
+        txreg_full = 0;
+    }
+
+    if (sfr[PIC_SFR_ADCON0] & 0x01) {
+        stats.adc_on_ns += now_ns - last_step;
+    }
+    if (sfr[PIC_SFR_RCSTA] & 0x80) {
+        stats.uart_on_ns += now_ns - last_step;
+    }
+    last_step = now_ns;
+
+    step_wdt();
+    update_t1g(); // T1GGO or the gate settings may have changed
+    if (!sleeping) {
+        step_tmr0();
+        step_tmr2();
+    }
+    if (!sleeping || tmr1_async()) {
+        step_tmr1();
+    }
+
+    if (eeprom_busy && now_ns >= eeprom_done) {
+        finish_eeprom();
+    }
+
+    uint8_t adcon0 = sfr[PIC_SFR_ADCON0];
+    if (adc_busy && now_ns >= adc_done) {
+        finish_adc();
+    } else if (!adc_busy && (adcon0 & 0x01) && (adcon0 & 0x02)) {
+        start_adc(now_ns);
+    }
+
+    refresh_status();
+}
+
+static int interrupt_pending(void);
+
+// Remembers when an interrupt became due, for the latency numbers. A flag the
+// firmware polls and clears itself while GIE is off never was an interrupt.
+static void note_pending(void) {
+    if (!interrupt_pending()) {
+        pending_since = 0;
+    } else if (pending_since == 0) {
+        pending_since = now_ns;
+    }
+}
+
+static int interrupt_pending(void) {
+    uint8_t intcon = sfr[PIC_SFR_INTCON];
+
+    // TMR0IF/INTF/IOCIF sit three bits below their enable bits
+    if ((intcon >> 3) & intcon & 0x07) {
+        return 1;
+    }
+    if (intcon & 0x40) {
+        if ((sfr[PIC_SFR_PIE1] & sfr[PIC_SFR_PIR1]) || (sfr[PIC_SFR_PIE2] & sfr[PIC_SFR_PIR2])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void enter_interrupt(void) {
+    // The core clears GIE on entry and RETFIE sets it again. Entering takes
+    // about 3 cycles after the flag is set, RETFIE 2 more.
+    uint64_t entered = cycles;
+
+    sfr[PIC_SFR_INTCON] &= (uint8_t) ~0x80;
+    in_isr = 1;
+    now_ns += 3 * tcy_ns();
+    cycles += 3;
+
+    uint64_t latency = now_ns - (pending_since ? pending_since : now_ns);
+    stats.interrupts++;
+    stats.latency_total += latency;
+    if (latency < stats.latency_min) {
+        stats.latency_min = latency;
+    }
+    if (latency > stats.latency_max) {
+        stats.latency_max = latency;
+    }
+
+    ((void (*)(void)) __start_pic_isr)();
+    commit_last_access();
+    now_ns += 2 * tcy_ns();
+    cycles += 2;
+    in_isr = 0;
+    sfr[PIC_SFR_INTCON] |= 0x80;
+    pending_since = 0;
+
+    uint64_t spent = cycles - entered;
+    stats.isr_cycles += spent;
+    if (spent > stats.isr_longest) {
+        stats.isr_longest = spent;
+    }
+    bring_up_to_date();
+}
+
+static void dispatch_interrupt(void) {
+    if ((void *) __start_pic_isr == (void *) __stop_pic_isr) {
+        return; // The program has no interrupt routine
+    }
+
+    // A flag that is still or again set after RETFIE causes the next entry right away
+    while (!in_isr && (sfr[PIC_SFR_INTCON] & 0x80) && interrupt_pending()) {
+        enter_interrupt();
+    }
+}
+
+static void bring_up_to_date(void) {
+    if (now_ns >= time_limit) {
+        exit(0);
+    }
+    step();
+    note_pending();
+    quiet_until = next_deadline(UINT64_MAX);
+}
+
+static uint64_t next_deadline(uint64_t target) {
+    uint64_t next = target;
+
+    if (event_next < event_count && events[event_next].time < next) {
+        next = events[event_next].time;
+    }
+    if (tsr_busy && tsr_done < next) {
+        next = tsr_done;
+    }
+    if (adc_busy && adc_done < next) {
+        next = adc_done;
+    }
+    if (eeprom_busy && eeprom_done < next) {
+        next = eeprom_done;
+    }
+    for (int pin = 0; pin < 6; pin++) {
+        if (clocks[pin].on && clocks[pin].next < next) {
+            next = clocks[pin].next;
+        }
+    }
+    if (wdt_running && wdt_origin + wdt_period_ns() < next) {
+        next = wdt_origin + wdt_period_ns();
+    }
+    if (tmr1_running && (!sleeping || tmr1_async()) && tmr1_event_ns() < next) {
+        next = tmr1_event_ns();
+    }
+    if (!sleeping) {
+        if (tmr0_running && tmr0_overflow_ns() < next) {
+            next = tmr0_overflow_ns();
+        }
+        if (tmr2_running && tmr2_period_end < next) {
+            next = tmr2_period_end;
+        }
+    }
+    if (time_limit < next) {
+        next = time_limit;
+    }
+    return next;
+}
+
+// Moves the clock forward, stopping at every peripheral event on the way so
+// interrupts are taken at the right time
+static void run_for(uint64_t ns) {
+    uint64_t target = now_ns + ns;
+
+    commit_last_access();
+    bring_up_to_date();
+    dispatch_interrupt();
+    while (now_ns < target) {
+        uint64_t next = next_deadline(target);
+        if (next <= now_ns) {
+            next = now_ns + 1;
+        }
+        cycles += (next - now_ns) / tcy_ns();
+        now_ns = next;
+        bring_up_to_date();
+        dispatch_interrupt();
+    }
+}
+
+volatile uint8_t *pic_sfr_access(uint8_t id) {
+    commit_last_access();
+    now_ns += tcy_ns();
+    cycles++;
+    bring_up_to_date();
+    dispatch_interrupt();
+
+    // Reading the same register again and finding it unchanged is a polling loop
+    if (!in_isr) {
+        if (id == poll_sfr && sfr[id] == poll_value) {
+            stats.polling_cycles++;
+        }
+        poll_sfr = id;
+        poll_value = sfr[id];
+    }
+
+    // When the duty cycle is written tells how steady a waveform comes out
+    if (id == PIC_SFR_CCPR1L && tmr2_running && (sfr[PIC_SFR_CCP1CON] & 0x0C) == 0x0C) {
+        uint64_t offset = now_ns - tmr2_period_start;
+
+        stats.pwm_writes++;
+        stats.pwm_write_min = offset < stats.pwm_write_min ? offset : stats.pwm_write_min;
+        stats.pwm_write_max = offset > stats.pwm_write_max ? offset : stats.pwm_write_max;
+        pwm_write_offset = offset;
+    }
+
+    last_access = id;
+    return &sfr[id];
+}
+
+void pic_delay_cycles(uint32_t count) {
+    uint64_t before = cycles;
+
+    run_for((uint64_t) count * tcy_ns());
+    if (!in_isr) {
+        stats.delay_cycles += cycles - before;
+    }
+}
+
+void pic_nop(void) {
+    // Idle loops call this millions of times, skip the bookkeeping when nothing
+    // has been written since the last step and no peripheral event is due
+    if (!in_isr) {
+        stats.idle_cycles++;
+    }
+    if (last_access < 0 && now_ns + tcy_ns() < quiet_until) {
+        now_ns += tcy_ns();
+        cycles++;
+        return;
+    }
+    run_for(tcy_ns());
+}
+
+void pic_clrwdt(void) {
+    wdt_origin = now_ns;
+    run_for(tcy_ns());
+}
+
+// Any enabled interrupt flag wakes the core, GIE only decides whether the
+// interrupt routine runs afterwards. Peripheral flags still need PEIE. The
+// watchdog wakes it without an interrupt.
+static int wake_pending(void) {
+    uint8_t intcon = sfr[PIC_SFR_INTCON];
+
+    if (wdt_woke || ((intcon >> 3) & intcon & 0x07)) {
+        return 1;
+    }
+    return (intcon & 0x40) &&
+           ((sfr[PIC_SFR_PIE1] & sfr[PIC_SFR_PIR1]) || (sfr[PIC_SFR_PIE2] & sfr[PIC_SFR_PIR2]));
+}
+
+// The oscillator stops, only external events, the watchdog, Timer1 on its
+// crystal and the FRC clocked ADC go on
+void pic_sleep(void) {
+    commit_last_access();
+    bring_up_to_date();
+    wdt_origin = now_ns; // SLEEP clears the watchdog
+    wdt_woke = 0;
+
+    uint64_t asleep = now_ns;
+    uint64_t counted = now_ns;
+    if (((sfr[PIC_SFR_ADCON1] >> 4) & 0x03) != 0x03) {
+        adc_busy = 0; // Only a conversion on the FRC clock survives SLEEP
+    }
+    sleeping = 1;
+    stats.sleeps++;
+    while (!wake_pending()) {
+        uint64_t next = next_deadline(time_limit);
+        if (tsr_busy && next == tsr_done) {
+            tsr_done = time_limit; // The shift register is clocked from Fosc
+            continue;
+        }
+        now_ns = next > now_ns ? next : now_ns + 1;
+        stats.sleep_ns += now_ns - counted;
+        counted = now_ns;
+        bring_up_to_date();
+    }
+    sleeping = 0;
+    wdt_woke = 0;
+
+    // The timers pick up where they stopped
+    uint64_t slept = now_ns - asleep;
+    tmr0_origin += slept;
+    if (!tmr1_async()) {
+        tmr1_origin += slept;
+    }
+    tmr2_period_start += slept;
+    tmr2_period_end += slept;
+
+    now_ns += tcy_ns();
+    cycles++;
+    dispatch_interrupt();
+}
+
+uint64_t pic_sim_time_ns(void) {
+    return now_ns;
+}
+
+uint64_t pic_sim_cycles(void) {
+    return cycles;
+}
+
+uint32_t pic_sim_eeprom_writes(uint8_t address) {
+    return eeprom_wear[address];
+}
+
+uint64_t pic_sim_isr_longest_cycles(void) {
+    return stats.isr_longest;
+}
+
+void pic_sim_set_time_limit(uint64_t time_ns) {
+    time_limit = time_ns;
+}
+
+void pic_sim_set_adc_source(pic_sim_adc_source_t source) {
+    adc_source = source;
+}
+
+void pic_sim_set_adc_sink(pic_sim_adc_sink_t sink) {
+    adc_sink = sink;
+}
+
+void pic_sim_set_uart_sink(pic_sim_uart_sink_t sink) {
+    uart_sink = sink;
+}
+
+void pic_sim_set_pwm_sink(pic_sim_pwm_sink_t sink) {
+    pwm_sink = sink;
+}
+
+void pic_sim_set_adc(uint8_t channel, uint16_t value) {
+    adc_values[channel & 0x1F] = value;
+}
+
+void pic_sim_set_pin(uint8_t pin, uint8_t level) {
+    set_pin(pin, level);
+}
+
+static void schedule(uint64_t time, uint8_t type, uint8_t channel, uint64_t value, uint64_t value2) {
+    size_t i;
+
+    if (event_count == PIC_SIM_MAX_EVENTS) {
+        fprintf(stderr, "simulator: too many stimulus events\n");
+        exit(1);
+    }
+
+    // Keep the list sorted, events at the same time stay in the order given
+    for (i = event_count; i > event_next && events[i - 1].time > time; i--) {
+        events[i] = events[i - 1];
+    }
+    events[i].time = time;
+    events[i].type = type;
+    events[i].channel = channel;
+    events[i].value = value;
+    events[i].value2 = value2;
+    event_count++;
+}
+
+void pic_sim_schedule_adc(uint64_t time_ns, uint8_t channel, uint16_t value) {
+    schedule(time_ns, EVENT_ADC, channel, value, 0);
+}
+
+void pic_sim_schedule_pin(uint64_t time_ns, uint8_t pin, uint8_t level) {
+    schedule(time_ns, EVENT_PIN, pin, level, 0);
+}
+
+void pic_sim_schedule_clock(uint64_t time_ns, uint8_t pin, uint64_t period_ns, uint64_t high_ns) {
+    schedule(time_ns, EVENT_CLOCK, pin, period_ns, high_ns);
+}
+
+void pic_sim_schedule_plant(uint64_t time_ns, uint8_t channel, uint16_t tau_ms, uint16_t full_scale) {
+    schedule(time_ns, EVENT_PLANT, channel, tau_ms, 0);
+    schedule(time_ns, EVENT_PLANT_SCALE, channel, full_scale, 0);
+}
+
+void pic_sim_schedule_rx(uint64_t time_ns, const uint8_t *data, size_t length) {
+    // Bytes arrive back to back at the line rate, after whatever is already queued
+    uint64_t time = time_ns > rx_line_free ? time_ns : rx_line_free;
+
+    for (size_t i = 0; i < length; i++) {
+        time += line_frame_ns();
+        schedule(time, EVENT_RX, 0, data[i], 0);
+    }
+    rx_line_free = time;
+}
+
+static size_t unescape(char *text) {
+    char *in = text;
+    char *out = text;
+
+    while (*in) {
+        if (*in == '\\' && in[1]) {
+            in++;
+            switch (*in) {
+                case 'n': *out++ = '\n'; break;
+                case 'r': *out++ = '\r'; break;
+                case 't': *out++ = '\t'; break;
+                case '0': *out++ = '\0'; break;
+                case 'x': {
+                    unsigned value = 0;
+                    int digits = 0;
+                    while (digits < 2 && strchr("0123456789abcdefABCDEF", in[1]) && in[1]) {
+                        in++;
+                        value = value * 16 + (unsigned) (*in <= '9' ? *in - '0' : (*in | 0x20) - 'a' + 10);
+                        digits++;
+                    }
+                    *out++ = (char) value;
+                    break;
+                }
+                default: *out++ = *in; break;
+            }
+            in++;
+        } else {
+            *out++ = *in++;
+        }
+    }
+    return (size_t) (out - text);
+}
+
+int pic_sim_load_stimulus(const char *path) {
+    FILE *file = fopen(path, "r");
+    char line[256];
+    int number = 0;
+
+    if (!file) {
+        perror(path);
+        return -1;
+    }
+
+    while (fgets(line, sizeof line, file)) {
+        double time_ms;
+        char event[16];
+        int offset = 0;
+
+        number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+        if (sscanf(line, "%lf %15s %n", &time_ms, event, &offset) < 2) {
+            fprintf(stderr, "%s:%d: expected \"<time ms> <event> ...\"\n", path, number);
+            fclose(file);
+            return -1;
+        }
+
+        uint64_t time = (uint64_t) (time_ms * 1e6);
+        unsigned a = 0;
+        unsigned b = 0;
+        double period_us = 0;
+        double high_us = 0;
+        if (strcmp(event, "pin") == 0 && sscanf(line + offset, "%u %u", &a, &b) == 2) {
+            pic_sim_schedule_pin(time, (uint8_t) a, (uint8_t) b);
+        } else if (strcmp(event, "adc") == 0 && sscanf(line + offset, "%u %u", &a, &b) == 2) {
+            pic_sim_schedule_adc(time, (uint8_t) a, (uint16_t) b);
+        } else if (strcmp(event, "plant") == 0 && sscanf(line + offset, "%u %u", &a, &b) == 2) {
+            unsigned full_scale = 1023;
+            sscanf(line + offset, "%*u %*u %u", &full_scale);
+            pic_sim_schedule_plant(time, (uint8_t) a, (uint16_t) b, (uint16_t) full_scale);
+        } else if (strcmp(event, "clock") == 0 && sscanf(line + offset, "%u %lf", &a, &period_us) == 2) {
+            sscanf(line + offset, "%*u %*f %lf", &high_us);
+            pic_sim_schedule_clock(time, (uint8_t) a, (uint64_t) (period_us * 1e3 + 0.5), (uint64_t) (high_us * 1e3 + 0.5));
+        } else if (strcmp(event, "baud") == 0 && sscanf(line + offset, "%u", &a) == 1 && a != 0) {
+            line_baud = a; // A setting of the PC, not a timed event
+        } else if (strcmp(event, "rx") == 0) {
+            char *text = line + offset;
+            pic_sim_schedule_rx(time, (const uint8_t *) text, unescape(text));
+        } else {
+            fprintf(stderr, "%s:%d: unknown event \"%s\"\n", path, number, event);
+            fclose(file);
+            return -1;
+        }
+    }
+
+    fclose(file);
+    return 0;
+}
+
+static double percent(uint64_t part, uint64_t whole) {
+    return whole ? 100.0 * (double) part / (double) whole : 0.0;
+}
+
+static void report(void) {
+    double seconds = now_ns / 1e9;
+    FILE *out = stderr;
+
+    if (uart_out) {
+        fflush(uart_out);
+    }
+    if (pwm_out) {
+        fflush(pwm_out);
+    }
+    fflush(stdout);
+
+    if (report_path) {
+        out = fopen(report_path, "w");
+        if (!out) {
+            perror(report_path);
+            return;
+        }
+    }
+
+    // One "key value" pair per line so scripts can pick the numbers up
+    fprintf(out, "time_ms %.3f\n", now_ns / 1e6);
+    fprintf(out, "fosc_hz %u\n", fosc());
+    fprintf(out, "cycles %llu\n", (unsigned long long) cycles);
+    fprintf(out, "busy_wait_percent_at_most %.2f\n",
+            percent(stats.delay_cycles + stats.polling_cycles + stats.idle_cycles, cycles));
+    fprintf(out, "delay_percent %.2f\n", percent(stats.delay_cycles, cycles));
+    fprintf(out, "polling_percent_at_most %.2f\n", percent(stats.polling_cycles, cycles));
+    fprintf(out, "idle_loop_percent_at_most %.2f\n", percent(stats.idle_cycles, cycles));
+    fprintf(out, "isr_percent_at_least %.2f\n", percent(stats.isr_cycles, cycles));
+    fprintf(out, "sleep_percent_at_most %.2f\n", percent(stats.sleep_ns, now_ns));
+    fprintf(out, "sleeps %llu\n", (unsigned long long) stats.sleeps);
+    if (stats.sleeps) {
+        // What one sample costs a program that sleeps between its samples
+        fprintf(out, "awake_us_per_wake_at_least %.1f\n", (now_ns - stats.sleep_ns) / 1e3 / stats.sleeps);
+        fprintf(out, "asleep_ms_per_wake_at_most %.3f\n", stats.sleep_ns / 1e6 / stats.sleeps);
+        fprintf(out, "wdt_wakes %llu\n", (unsigned long long) stats.wdt_wakes);
+    }
+    fprintf(out, "adc_on_percent %.2f\n", percent(stats.adc_on_ns, now_ns));
+    fprintf(out, "uart_on_percent %.2f\n", percent(stats.uart_on_ns, now_ns));
+    fprintf(out, "interrupts %llu\n", (unsigned long long) stats.interrupts);
+    if (stats.interrupts) {
+        fprintf(out, "isr_latency_min_us_at_least %.3f\n", stats.latency_min / 1e3);
+        fprintf(out, "isr_latency_avg_us_at_least %.3f\n", stats.latency_total / 1e3 / stats.interrupts);
+        fprintf(out, "isr_latency_max_us_at_least %.3f\n", stats.latency_max / 1e3);
+        // Register accesses and the entry and return only, a lower bound
+        fprintf(out, "isr_longest_cycles_at_least %llu\n", (unsigned long long) stats.isr_longest);
+    }
+    if ((sfr[PIC_SFR_RCSTA] & 0x80) || stats.tx_bytes) {
+        fprintf(out, "uart_baud %.1f\n", device_baud());
+        fprintf(out, "uart_baud_error_percent %.2f\n", 100.0 * baud_error());
+        fprintf(out, "uart_tx_bytes %llu\n", (unsigned long long) stats.tx_bytes);
+        fprintf(out, "uart_tx_bytes_per_s %.1f\n", seconds > 0 ? stats.tx_bytes / seconds : 0.0);
+        fprintf(out, "uart_tx_unreadable_bytes %llu\n", (unsigned long long) stats.tx_bad_bytes);
+        fprintf(out, "uart_rx_bytes %llu\n", (unsigned long long) stats.rx_bytes);
+        fprintf(out, "uart_rx_overruns %llu\n", (unsigned long long) stats.rx_overruns);
+    }
+    if (stats.adc_conversions) {
+        uint64_t tad = adc_tad_ns();
+        fprintf(out, "adc_conversions %llu\n", (unsigned long long) stats.adc_conversions);
+        fprintf(out, "adc_samples_per_s %.1f\n", stats.adc_conversions / seconds);
+        fprintf(out, "adc_tad_us %.3f%s\n", tad / 1e3, tad < 1000 || tad > 9000 ? " out_of_spec" : "");
+        fprintf(out, "adc_conversion_us %.3f\n", adc_conversion_ns() / 1e3);
+        fprintf(out, "adc_awake_us_per_sample_at_least %.1f\n", (now_ns - stats.sleep_ns) / 1e3 / stats.adc_conversions);
+        if (stats.adc_triggers) {
+            fprintf(out, "adc_triggered_percent %.2f\n", percent(stats.adc_triggers, stats.adc_conversions));
+        }
+    }
+    if (stats.eeprom_writes || stats.eeprom_write_errors) {
+        uint32_t most = 0;
+        for (int i = 0; i < EEPROM_SIZE; i++) {
+            most = eeprom_wear[i] > most ? eeprom_wear[i] : most;
+        }
+        fprintf(out, "eeprom_writes %llu\n", (unsigned long long) stats.eeprom_writes);
+        fprintf(out, "eeprom_writes_per_s %.2f\n", stats.eeprom_writes / seconds);
+        fprintf(out, "eeprom_most_writes_per_byte %u\n", most); // Wear levelling keeps this low
+        fprintf(out, "eeprom_write_errors %llu\n", (unsigned long long) stats.eeprom_write_errors);
+    }
+    if (stats.ccp1_captures) {
+        fprintf(out, "ccp1_captures %llu\n", (unsigned long long) stats.ccp1_captures);
+        fprintf(out, "ccp1_capture_rate_hz %.1f\n", stats.ccp1_captures / seconds);
+    }
+    if (stats.tmr1_gate_events) {
+        fprintf(out, "tmr1_gate_events %llu\n", (unsigned long long) stats.tmr1_gate_events);
+    }
+    if (stats.ccp1_matches) {
+        fprintf(out, "ccp1_matches %llu\n", (unsigned long long) stats.ccp1_matches);
+        fprintf(out, "ccp1_match_rate_hz %.1f\n", stats.ccp1_matches / seconds);
+    }
+    if (tmr2_running) {
+        fprintf(out, "tmr2_period_us %.3f\n", tmr2_period_ns() / 1e3);
+        if ((sfr[PIC_SFR_CCP1CON] & 0x0C) == 0x0C) {
+            uint32_t duty = ((uint32_t) sfr[PIC_SFR_CCPR1L] << 2) | ((sfr[PIC_SFR_CCP1CON] >> 4) & 0x03);
+            fprintf(out, "pwm_frequency_hz %.1f\n", 1e9 / tmr2_period_ns());
+            fprintf(out, "pwm_duty_percent %.2f\n", percent(duty, 4ULL * (sfr[PIC_SFR_PR2] + 1)));
+        }
+        if (stats.pwm_writes) {
+            fprintf(out, "pwm_writes %llu\n", (unsigned long long) stats.pwm_writes);
+            fprintf(out, "pwm_write_offset_min_us_at_least %.3f\n", stats.pwm_write_min / 1e3);
+            fprintf(out, "pwm_write_offset_max_us_at_least %.3f\n", stats.pwm_write_max / 1e3);
+            fprintf(out, "pwm_write_jitter_us %.3f\n", (stats.pwm_write_max - stats.pwm_write_min) / 1e3);
+        }
+    }
+
+    if (out != stderr) {
+        fclose(out);
+    }
+}
+
+// A write still in progress is lost, like when the power goes
+static void save_eeprom(void) {
+    FILE *file = fopen(eeprom_path, "wb");
+
+    if (!file || fwrite(eeprom, 1, EEPROM_SIZE, file) != EEPROM_SIZE) {
+        perror(eeprom_path);
+    }
+    if (file) {
+        fclose(file);
+    }
+}
+
+// Power-on reset values and the environment, before the firmware's main()
+__attribute__((constructor)) static void pic_sim_reset(void) {
+    const char *value;
+
+    sfr[PIC_SFR_TRISA] = 0x3F;
+    sfr[PIC_SFR_ANSELA] = 0x17;
+    sfr[PIC_SFR_WPUA] = 0x3F;
+    sfr[PIC_SFR_OSCCON] = 0x38; // 500 kHz MFINTOSC
+    sfr[PIC_SFR_OPTION_REG] = 0xFF;
+    sfr[PIC_SFR_PR2] = 0xFF;
+    sfr[PIC_SFR_TXSTA] = 0x02;
+    sfr[PIC_SFR_BAUDCON] = 0x40;
+    sfr[PIC_SFR_WDTCON] = 0x16;
+    refresh_status();
+
+    // A 5 V supply: 1.024 V from the FVR and about 2.6 V from the temperature
+    // indicator in the high range at room temperature
+    adc_values[PIC_SIM_ADC_FVR] = 210;
+    adc_values[PIC_SIM_ADC_TEMPERATURE] = 532;
+
+    if ((value = getenv("PIC_SIM_TIME_MS")) != NULL) {
+        time_limit = PIC_SIM_MS(strtoull(value, NULL, 10));
+    }
+    if ((value = getenv("PIC_SIM_TRACE_PINS")) != NULL) {
+        trace_pins = atoi(value);
+    }
+    if ((value = getenv("PIC_SIM_BAUD")) != NULL) {
+        line_baud = (uint32_t) strtoul(value, NULL, 10);
+    }
+    report_path = getenv("PIC_SIM_REPORT");
+    if ((value = getenv("PIC_SIM_PWM_OUT")) != NULL) {
+        pwm_out = fopen(value, "w");
+        if (!pwm_out) {
+            perror(value);
+            exit(1);
+        }
+    }
+    if ((value = getenv("PIC_SIM_UART_OUT")) != NULL) {
+        uart_out = fopen(value, "wb");
+        if (!uart_out) {
+            perror(value);
+            exit(1);
+        }
+    }
+    if ((value = getenv("PIC_SIM_STIMULUS")) != NULL && *value && pic_sim_load_stimulus(value) != 0) {
+        exit(1);
+    }
+    memset(eeprom, 0xFF, sizeof eeprom);
+    if ((eeprom_path = getenv("PIC_SIM_EEPROM")) != NULL) {
+        FILE *file = fopen(eeprom_path, "rb");
+        if (file) {
+            if (fread(eeprom, 1, EEPROM_SIZE, file) != EEPROM_SIZE) {
+                memset(eeprom, 0xFF, sizeof eeprom); // Not an image of this chip, start erased
+            }
+            fclose(file);
+        }
+        atexit(save_eeprom);
+    }
+
+    atexit(report);
+}
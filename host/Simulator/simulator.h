@@ -0,0 +1,116 @@
+//**********************************************************************************
+// Hooks of the host PIC12F1822 simulator
+//
+// The simulator is linked together with one of the samples in src/. The sample
+// keeps its own main(), so everything here is either set from the environment
+// when the program starts or from a constructor function of a test runner:
+//
+//   PIC_SIM_TIME_MS    virtual time after which the program exits (default 1000)
+//   PIC_SIM_STIMULUS   file with timed input events, see pic_sim_load_stimulus()
+//   PIC_SIM_UART_OUT   file that receives the bytes sent on TX (default stdout)
+//   PIC_SIM_BAUD       bit rate of the PC end of the serial line (default 9600),
+//                      used for received bytes and to check the EUSART setting
+//   PIC_SIM_PWM_OUT    file that receives the 10 bit duty cycle of every PWM
+//                      period as it starts, one number per line
+//   PIC_SIM_REPORT     file for the report, stderr when not set
+//   PIC_SIM_TRACE_PINS 1 to print every change of an output pin on stderr
+//   PIC_SIM_EEPROM     file with the 256 bytes of the data EEPROM, read when the
+//                      program starts and written when it exits, so the contents
+//                      survive from one run to the next like on the chip
+//
+// All times are virtual nanoseconds since reset. Nothing depends on the speed of
+// the host, so the same program and stimulus always produce the same output.
+//**********************************************************************************
+
+#ifndef PIC_SIM_SIMULATOR_H
+#define PIC_SIM_SIMULATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PIC_SIM_MS(x) ((uint64_t) (x) * 1000000ULL)
+#define PIC_SIM_US(x) ((uint64_t) (x) * 1000ULL)
+
+// ADC channels as selected by ADCON0bits.CHS
+#define PIC_SIM_ADC_TEMPERATURE 0x1D
+#define PIC_SIM_ADC_DAC         0x1E
+#define PIC_SIM_ADC_FVR         0x1F
+
+// Returns the 10 bit conversion result for a channel. The default source returns
+// the last value set with pic_sim_set_adc() or a "adc" stimulus line. The FVR and
+// temperature channels start out with the readings of a 5 V supply.
+typedef uint16_t (*pic_sim_adc_source_t)(uint8_t channel, uint64_t time_ns);
+
+// Receives the 10 bit result of every conversion as it finishes, from whichever
+// source it came
+typedef void (*pic_sim_adc_sink_t)(uint8_t channel, uint16_t value, uint64_t time_ns);
+
+// Receives every byte the EUSART finished shifting out on TX
+typedef void (*pic_sim_uart_sink_t)(uint8_t data, uint64_t time_ns);
+
+// Receives the 10 bit duty cycle of every PWM period as it starts, and how long
+// after the start of the period before CCPR1L was last written, UINT64_MAX when
+// it was not
+typedef void (*pic_sim_pwm_sink_t)(uint16_t duty, uint64_t time_ns, uint64_t write_offset_ns);
+
+uint64_t pic_sim_time_ns(void);
+uint64_t pic_sim_cycles(void);
+
+// Writes to one byte of the data EEPROM that finished in this run
+uint32_t pic_sim_eeprom_writes(uint8_t address);
+
+// Longest run of the interrupt routine so far, entry and RETFIE included, in the
+// cycles the simulator charges
+uint64_t pic_sim_isr_longest_cycles(void);
+
+void pic_sim_set_time_limit(uint64_t time_ns);
+void pic_sim_set_adc_source(pic_sim_adc_source_t source);
+void pic_sim_set_adc_sink(pic_sim_adc_sink_t sink);
+void pic_sim_set_uart_sink(pic_sim_uart_sink_t sink);
+void pic_sim_set_pwm_sink(pic_sim_pwm_sink_t sink);
+
+// Immediate changes of the inputs
+void pic_sim_set_adc(uint8_t channel, uint16_t value);
+void pic_sim_set_pin(uint8_t pin, uint8_t level);
+
+// Timed changes of the inputs, they take effect when the virtual clock gets there
+void pic_sim_schedule_adc(uint64_t time_ns, uint8_t channel, uint16_t value);
+void pic_sim_schedule_pin(uint64_t time_ns, uint8_t pin, uint8_t level);
+void pic_sim_schedule_rx(uint64_t time_ns, const uint8_t *data, size_t length);
+
+// From time_ns on the pin is driven with a square wave that starts with a rising
+// edge, high for high_ns of every period_ns (half of it when high_ns is 0). On a
+// pin that already has one the new settings take over at its next edge, so the
+// frequency changes without a short period. A period of 0 stops it.
+void pic_sim_schedule_clock(uint64_t time_ns, uint8_t pin, uint64_t period_ns, uint64_t high_ns);
+
+// From time_ns on the ADC channel reads a first order plant driven by the PWM
+// duty cycle, or by the DAC when CCP1 is not in PWM mode: it moves towards duty x
+// full_scale with a time constant of tau_ms. Scheduling it again changes the time
+// constant or the gain, a load change, without a jump of the output.
+void pic_sim_schedule_plant(uint64_t time_ns, uint8_t channel, uint16_t tau_ms, uint16_t full_scale);
+
+// Reads a stimulus file. Each line is "<time in ms> <event> <arguments>":
+//   10 pin 2 1         drive RA2 high at 10 ms
+//   20 adc 2 512       channel AN2 converts to 512 from 20 ms on
+//   30 rx R50\n        the host sends "R50" and a new line, C escapes allowed
+//   0 baud 115200      the PC end of the line runs at 115200 baud, for the whole
+//                      run whatever the time, instead of PIC_SIM_BAUD
+//   0 plant 3 50 900   AN3 reads a plant with a 50 ms time constant that reaches
+//                      900 at full drive, see pic_sim_schedule_plant()
+//   40 clock 2 1000 250
+//                      a 1 kHz square wave on RA2, high for 250 us of every
+//                      1000 us, see pic_sim_schedule_clock(). Fractions of a
+//                      microsecond are allowed.
+// Empty lines and lines starting with # are skipped.
+int pic_sim_load_stimulus(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
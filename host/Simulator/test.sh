@@ -0,0 +1,49 @@
+#!/bin/sh
+#**********************************************************************************
+# Builds and runs the host tests in host/Simulator/tests
+#
+# Usage: host/Simulator/test.sh
+#
+# A unit test has its own main(), includes the header it tests and links with
+# the simulator for the registers. A sample test is linked with the sample of the
+# same name in src/, runs it on the stimulus of the same name and checks what came
+# out from an atexit() handler. Every test prints its count of checks and exits
+# with 1 when one failed; this script exits with 1 when a test did.
+#**********************************************************************************
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/../.." && pwd)
+SIM="$ROOT/host/Simulator"
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# The samples use XC8's #pragma config and void main()
+CFLAGS="-O1 -Wall -Wextra -Werror -Wno-unknown-pragmas -Wno-main"
+
+UNIT_TESTS="eepromLog filters format uart"
+SAMPLE_TESTS="Capture/capture DDS/dds Interrupt/interrupt PID/pid"
+
+failed=0
+
+for test in $UNIT_TESTS; do
+    gcc $CFLAGS -I "$SIM" "$SIM/tests/${test}Test.c" "$SIM/simulator.c" -o "$WORK/$test"
+    PIC_SIM_REPORT="$WORK/$test.report" PIC_SIM_UART_OUT=/dev/null "$WORK/$test" || failed=1
+done
+
+for sample in $SAMPLE_TESTS; do
+    name=$(basename "$sample")
+    case $name in
+        interrupt) flags=-DINTERRUPT_ALL_SOURCES ;; # Every source of the dispatcher
+        *) flags= ;;
+    esac
+    gcc $CFLAGS $flags -I "$SIM" "$SIM/tests/${name}Test.c" "$ROOT/src/$sample.c" "$SIM/simulator.c" -o "$WORK/$name" -lm
+
+    stimulus="$SIM/stimulus/$name.txt"
+    [ -f "$stimulus" ] || stimulus=
+
+    PIC_SIM_STIMULUS=$stimulus PIC_SIM_REPORT="$WORK/$name.report" PIC_SIM_UART_OUT=/dev/null \
+        "$WORK/$name" || failed=1
+done
+
+exit $failed
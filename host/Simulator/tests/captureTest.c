@@ -0,0 +1,137 @@
+//**********************************************************************************
+// Host test of src/Capture/capture.c on stimulus/capture.txt
+//
+// The simulator drives RA2 and RA3 with the square waves of the stimulus and
+// hands back every line the sample sends. The lines after each command are
+// checked against the input after the run:
+//      500 ms      F100 on 1234.56 us: 810005 mHz and 9876 cycles
+//      1500 ms     W10 with 300 us high: 24.30 % and 2400 cycles
+//      2700 ms     W100 on 40 us with 12 us high: 25 kHz, 30.00 % and 96 cycles
+//      3000 ms     F1600, CCP1 captures every 16th edge: 320 cycles
+//      4000 ms     H and P through the gate: 96 and 320 cycles
+//      5000 ms     F1 on 2 Hz, then no edge from 7000 ms on: 0 after 2 s
+//      9300 ms     H on a 0.25 us pulse: 2 cycles
+//      9500 ms     F4 on 1 Hz: a capture every 4 s, which must not time out
+// A cycle is 125 ns at 32 MHz. The gate and the simulator both synchronise the
+// edges to a cycle, so a gate measurement may be one off.
+//**********************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "check.h"
+#include "simulator.h"
+
+#define RUN_MS          16800 // The F4 result comes at 16600 ms
+#define MAX_LINES       512
+#define MAX_LINE        40
+
+typedef struct {
+    double ms; // When the line was complete
+    int fields; // Numbers in it, 0 for OK and ERR
+    unsigned long value[3];
+} line_t;
+
+static line_t lines[MAX_LINES];
+static unsigned line_count;
+static char text[MAX_LINE];
+static unsigned text_length;
+
+static void sink(uint8_t data, uint64_t time_ns) {
+    if (data != '\n') {
+        if (text_length < MAX_LINE - 1) {
+            text[text_length++] = (char) data;
+        }
+        return;
+    }
+    text[text_length] = '\0';
+    text_length = 0;
+    if (line_count < MAX_LINES) {
+        line_t *line = &lines[line_count++];
+        int fields = sscanf(text, "%lu %lu %lu", &line->value[0], &line->value[1], &line->value[2]);
+
+        line->ms = time_ns / 1e6;
+        line->fields = fields < 0 ? 0 : fields;
+    }
+}
+
+// Every result line between from_ms and to_ms has the given numbers, each within
+// its tolerance, and there is at least one
+static void check_lines(double from_ms, double to_ms, int fields, const unsigned long *expected,
+                        const unsigned long *tolerance) {
+    unsigned found = 0;
+
+    for (unsigned i = 0; i < line_count; i++) {
+        const line_t *line = &lines[i];
+
+        if (line->ms < from_ms || line->ms >= to_ms || line->fields == 0) {
+            continue;
+        }
+        found++;
+        CHECK_EQUAL(line->fields, fields);
+        for (int n = 0; n < fields && n < line->fields; n++) {
+            CHECK_RANGE(line->value[n], expected[n] - tolerance[n], expected[n] + tolerance[n]);
+        }
+    }
+    CHECK(found > 0);
+}
+
+static void check_period(double from_ms, double to_ms, unsigned long millihertz, unsigned long cycles) {
+    const unsigned long expected[] = { millihertz, cycles };
+    const unsigned long tolerance[] = { 0, 0 };
+
+    check_lines(from_ms, to_ms, 2, expected, tolerance);
+}
+
+static void check_pulse(double from_ms, double to_ms, unsigned long millihertz, unsigned long duty,
+                        unsigned long cycles, unsigned long millihertz_tolerance) {
+    const unsigned long expected[] = { millihertz, duty, cycles };
+    const unsigned long tolerance[] = { millihertz_tolerance, 0, 0 };
+
+    check_lines(from_ms, to_ms, 3, expected, tolerance);
+}
+
+// The one line of a gate measurement, the first result after the command
+static void check_gate(double from_ms, unsigned long cycles) {
+    for (unsigned i = 0; i < line_count; i++) {
+        if (lines[i].ms >= from_ms && lines[i].fields != 0) {
+            CHECK_EQUAL(lines[i].fields, 1);
+            CHECK_RANGE(lines[i].value[0], cycles - 1, cycles + 1);
+            return;
+        }
+    }
+    CHECK(!"no gate result");
+}
+
+static void check(void) {
+    CHECK(line_count < MAX_LINES);
+
+    // 1234.56 us is 9876.48 cycles. W10 sums only 10 periods, 1 cycle in 98765.
+    check_period(501, 1500, 810005, 9876);
+    check_pulse(1501, 2500, 810005, 2430, 2400, 10);
+    check_pulse(2701, 3000, 25000000, 3000, 96, 0);
+    check_period(3001, 4000, 25000000, 320);
+
+    check_gate(4000, 96);
+    check_gate(4100, 320);
+
+    check_period(5500, 7500, 2000, 4000000);
+    check_period(8500, 9100, 0, 0); // 2 s after the last edge at 6500 ms
+
+    check_gate(9300, 2);
+
+    // Nothing until the second capture, 4 periods after the first at 12600 ms
+    check_period(9501, RUN_MS, 1000, 8000000);
+
+    if (check_summary("capture") != 0) {
+        fflush(NULL);
+        _exit(1); // The run ends with exit(0) at the time limit
+    }
+}
+
+__attribute__((constructor)) static void setup(void) {
+    pic_sim_set_uart_sink(sink);
+    pic_sim_set_time_limit(PIC_SIM_MS(RUN_MS));
+    atexit(check);
+}
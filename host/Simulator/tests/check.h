@@ -0,0 +1,73 @@
+//**********************************************************************************
+// Checks for the host tests in host/Simulator/tests
+//
+// A failed check prints the expression and where it is and the test goes on, so
+// one run shows every failure. check_summary() prints the counts and returns the
+// exit status of the test: 0 when everything passed.
+//**********************************************************************************
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+#define CHECK_PRINT_LIMIT 20 // Failures printed per test, the rest are only counted
+
+static unsigned check_count;
+static unsigned check_failures;
+
+#define CHECK(condition)            check_true((condition) != 0, #condition, __FILE__, __LINE__)
+#define CHECK_EQUAL(actual, expected) \
+    check_equal((long) (actual), (long) (expected), #actual, __FILE__, __LINE__)
+#define CHECK_RANGE(value, low, high) \
+    check_range((double) (value), (low), (high), #value, __FILE__, __LINE__)
+
+static inline int check_failed(const char *file, int line) {
+    check_count++;
+    check_failures++;
+    if (check_failures <= CHECK_PRINT_LIMIT) {
+        printf("%s:%d: ", file, line);
+        return 1;
+    }
+    return 0;
+}
+
+static inline int check_true(int passed, const char *text, const char *file, int line) {
+    if (passed) {
+        check_count++;
+    } else if (check_failed(file, line)) {
+        printf("%s\n", text);
+    }
+    return passed;
+}
+
+static inline int check_equal(long actual, long expected, const char *text, const char *file, int line) {
+    if (actual == expected) {
+        check_count++;
+        return 1;
+    }
+    if (check_failed(file, line)) {
+        printf("%s is %ld, expected %ld\n", text, actual, expected);
+    }
+    return 0;
+}
+
+static inline int check_range(double value, double low, double high, const char *text, const char *file,
+                              int line) {
+    if (value >= low && value <= high) {
+        check_count++;
+        return 1;
+    }
+    if (check_failed(file, line)) {
+        printf("%s is %g, expected %g to %g\n", text, value, low, high);
+    }
+    return 0;
+}
+
+static inline int check_summary(const char *name) {
+    printf("%s: %u checks, %u failed\n", name, check_count, check_failures);
+    fflush(stdout);
+    return check_failures != 0;
+}
+
+#endif
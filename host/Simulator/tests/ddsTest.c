@@ -0,0 +1,273 @@
+//**********************************************************************************
+// Host test of src/DDS/dds.c on stimulus/dds.txt
+//
+// The simulator hands over the duty cycle of every PWM period as it is latched,
+// which is the waveform the RC filter sees, sampled at 31.25 kHz. Each stretch of
+// the stimulus is checked after the run:
+//      0 ms        440 Hz sine: frequency, and every other line of the spectrum
+//      1000 ms     261.63 Hz sine: the same
+//      1500 ms     triangle: the odd harmonics at 1/n^2
+//      2000 ms     organ: the second and third harmonic at 1/2 and 1/4
+//      2500 ms     soft start over 1 second: a ramp from 0 to full that holds
+// A period whose sample was not written in time, or written at a different point
+// of the period than the others, is a miss or jitter in the update rate.
+//**********************************************************************************
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "check.h"
+#include "simulator.h"
+
+#define RUN_MS          3600
+#define SAMPLE_HZ       31250.0 // 32 MHz / 4 / 256
+#define PERIOD_NS       32000
+#define MAX_PERIODS     (RUN_MS * 32) // 31.25 per millisecond and some room
+#define FFT_LENGTH      8192 // 262 ms, 3.8 Hz a bin
+#define FULL_SCALE      (255 << 2) // The DDS only writes CCPR1L
+
+static uint16_t duty[MAX_PERIODS];
+static uint64_t write_offset[MAX_PERIODS];
+static unsigned periods;
+static uint64_t first_ns;
+
+static double windowed[FFT_LENGTH];
+static double re[FFT_LENGTH];
+static double im[FFT_LENGTH];
+
+static void sink(uint16_t value, uint64_t time_ns, uint64_t offset_ns) {
+    if (periods == 0) {
+        first_ns = time_ns;
+    }
+    if (periods < MAX_PERIODS) {
+        duty[periods] = value;
+        write_offset[periods] = offset_ns;
+        periods++;
+    }
+}
+
+// Index of the first period at or after a time of the stimulus
+static unsigned at_ms(double ms) {
+    double index = (ms * 1e6 - (double) first_ns) / PERIOD_NS;
+
+    return index < 0 ? 0 : (unsigned) index;
+}
+
+// Frequency from the upward crossings of the mean, with the crossing point
+// interpolated between the two samples around it
+static double frequency(unsigned start, unsigned length) {
+    double mean = 0;
+    double first = -1;
+    double last = 0;
+    unsigned crossings = 0;
+
+    for (unsigned i = start; i < start + length; i++) {
+        mean += duty[i];
+    }
+    mean /= length;
+    for (unsigned i = start + 1; i < start + length; i++) {
+        double a = duty[i - 1] - mean;
+        double b = duty[i] - mean;
+
+        if (a < 0 && b >= 0) {
+            last = i - 1 + a / (a - b);
+            if (first < 0) {
+                first = last;
+            }
+            crossings++;
+        }
+    }
+    return crossings < 2 ? 0 : (crossings - 1) * SAMPLE_HZ / (last - first);
+}
+
+// In place radix 2 FFT of re[] and im[]
+static void fft(void) {
+    for (unsigned i = 1, j = 0; i < FFT_LENGTH; i++) {
+        unsigned bit = FFT_LENGTH >> 1;
+
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            double t = re[i];
+            re[i] = re[j];
+            re[j] = t;
+            t = im[i];
+            im[i] = im[j];
+            im[j] = t;
+        }
+    }
+    for (unsigned length = 2; length <= FFT_LENGTH; length <<= 1) {
+        double angle = -2 * M_PI / length;
+
+        for (unsigned i = 0; i < FFT_LENGTH; i += length) {
+            for (unsigned k = 0; k < length / 2; k++) {
+                double wr = cos(angle * k);
+                double wi = sin(angle * k);
+                unsigned a = i + k;
+                unsigned b = a + length / 2;
+                double br = re[b] * wr - im[b] * wi;
+                double bi = re[b] * wi + im[b] * wr;
+
+                re[b] = re[a] - br;
+                im[b] = im[a] - bi;
+                re[a] += br;
+                im[a] += bi;
+            }
+        }
+    }
+}
+
+// Hann windowed FFT_LENGTH periods without the mean in windowed[], and their
+// spectrum in re[] as the magnitude of each bin
+static void spectrum(unsigned start) {
+    double mean = 0;
+
+    for (unsigned i = 0; i < FFT_LENGTH; i++) {
+        mean += duty[start + i];
+    }
+    mean /= FFT_LENGTH;
+    for (unsigned i = 0; i < FFT_LENGTH; i++) {
+        windowed[i] = (duty[start + i] - mean) * (0.5 - 0.5 * cos(2 * M_PI * i / FFT_LENGTH));
+        re[i] = windowed[i];
+        im[i] = 0;
+    }
+    fft();
+    for (unsigned i = 0; i < FFT_LENGTH / 2; i++) {
+        re[i] = hypot(re[i], im[i]);
+    }
+}
+
+// Magnitude at exactly one frequency, on the same scale as the bins. A line
+// between two bins reads the same as one on a bin.
+static double level(double hz) {
+    double sum_re = 0;
+    double sum_im = 0;
+
+    for (unsigned i = 0; i < FFT_LENGTH; i++) {
+        double angle = 2 * M_PI * hz * i / SAMPLE_HZ;
+
+        sum_re += windowed[i] * cos(angle);
+        sum_im -= windowed[i] * sin(angle);
+    }
+    return hypot(sum_re, sum_im);
+}
+
+static double decibels(double ratio) {
+    return 20 * log10(ratio);
+}
+
+// Strongest line of the spectrum that is not a harmonic of the fundamental up to
+// the given one, relative to the fundamental
+static double spur(double hz, int harmonics) {
+    double fundamental = level(hz);
+    double peak = 0;
+
+    for (int i = 3; i < FFT_LENGTH / 2; i++) {
+        double n = i * SAMPLE_HZ / FFT_LENGTH / hz;
+        double nearest = round(n);
+
+        if (nearest >= 1 && nearest <= harmonics && fabs(n - nearest) * hz * FFT_LENGTH / SAMPLE_HZ <= 4) {
+            continue; // Main lobe of a line that belongs there
+        }
+        if (re[i] > peak) {
+            peak = re[i];
+        }
+    }
+    return decibels(peak / fundamental);
+}
+
+static void check_sine(double from_ms, double hz) {
+    unsigned start = at_ms(from_ms);
+
+    CHECK_RANGE(frequency(start, FFT_LENGTH), hz - 0.05, hz + 0.05);
+    spectrum(start);
+    CHECK_RANGE(spur(hz, 1), -200.0, -45.0); // 8 bit samples, about -48 dB
+}
+
+static void check_triangle(double from_ms, double hz) {
+    unsigned start = at_ms(from_ms);
+
+    CHECK_RANGE(frequency(start, FFT_LENGTH), hz - 0.05, hz + 0.05);
+    spectrum(start);
+    CHECK_RANGE(decibels(level(3 * hz) / level(hz)), -19.4, -18.8); // 1/9
+    CHECK_RANGE(decibels(level(5 * hz) / level(hz)), -28.3, -27.7); // 1/25
+    CHECK_RANGE(decibels(level(2 * hz) / level(hz)), -200.0, -40.0); // No even ones
+    CHECK_RANGE(spur(hz, 15), -200.0, -45.0);
+}
+
+static void check_organ(double from_ms, double hz) {
+    unsigned start = at_ms(from_ms);
+
+    spectrum(start);
+    CHECK_RANGE(decibels(level(2 * hz) / level(hz)), -6.3, -5.7); // 1/2
+    CHECK_RANGE(decibels(level(3 * hz) / level(hz)), -12.3, -11.7); // 1/4
+    CHECK_RANGE(spur(hz, 3), -200.0, -45.0);
+}
+
+// From 0 to full within 5 % of the second, never down on the way, then held
+static void check_soft_start(double from_ms, double to_ms) {
+    unsigned i = at_ms(from_ms);
+    unsigned end = at_ms(to_ms);
+
+    while (i < end && duty[i] != 0) {
+        i++;
+    }
+    unsigned start = i;
+    for (i++; i < end && duty[i] < FULL_SCALE; i++) {
+        if (duty[i] < duty[i - 1]) {
+            CHECK(duty[i] >= duty[i - 1]);
+            break;
+        }
+    }
+    CHECK_RANGE((i - start) / SAMPLE_HZ, 0.95, 1.05);
+    for (; i < end; i++) {
+        if (duty[i] != FULL_SCALE) {
+            CHECK_EQUAL(duty[i], FULL_SCALE);
+            break;
+        }
+    }
+}
+
+// Every period got its sample, and always at the same point of the period
+static void check_updates(void) {
+    uint64_t offset_min = UINT64_MAX;
+    uint64_t offset_max = 0;
+    unsigned missed = 0;
+
+    for (unsigned i = at_ms(10); i < periods; i++) {
+        if (write_offset[i] == UINT64_MAX) {
+            missed++;
+            continue;
+        }
+        offset_min = write_offset[i] < offset_min ? write_offset[i] : offset_min;
+        offset_max = write_offset[i] > offset_max ? write_offset[i] : offset_max;
+    }
+    CHECK_EQUAL(missed, 0);
+    CHECK_RANGE(offset_max - offset_min, 0, 124); // Not one instruction cycle apart
+    CHECK_RANGE(offset_max, 0, PERIOD_NS / 4);
+}
+
+static void check(void) {
+    CHECK(periods >= at_ms(RUN_MS - 1));
+    check_sine(200, 440);
+    check_sine(1100, 261.63);
+    check_triangle(1600, 261.63);
+    check_organ(2100, 261.63);
+    check_soft_start(2500, 3500);
+    check_updates();
+
+    if (check_summary("dds") != 0) {
+        fflush(NULL);
+        _exit(1); // The run ends with exit(0) at the time limit
+    }
+}
+
+__attribute__((constructor)) static void setup(void) {
+    pic_sim_set_pwm_sink(sink);
+    pic_sim_set_time_limit(PIC_SIM_MS(RUN_MS));
+    atexit(check);
+}
@@ -0,0 +1,277 @@
+//**********************************************************************************
+// Host test of src/EepromLog/eepromLog.h
+//
+// The simulator's data EEPROM takes 4 ms per write and raises EEIF when one is
+// done, like the chip. The test holds the interrupt back after every single
+// write, so it can read the whole EEPROM at each point a power cut could leave
+// it in, and decodes the image the way the format in eepromLog.h describes:
+//
+//  - After every write the log holds readings that were added one after the
+//    other, up to the newest one or the one before it, which is being written.
+//  - Once the queue is empty it ends with the newest reading, and a full ring
+//    holds at least 15 pages worth.
+//  - A reset at any write, which loses the queued writes and the RAM, finds the
+//    end of the log again and goes on from there, also over the wrap of the
+//    sequence numbers from 254 to 0.
+//  - No byte is written more than twice per round of the ring.
+//**********************************************************************************
+
+#include <xc.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "check.h"
+#include "simulator.h"
+
+#define _XTAL_FREQ  1000000 // Fewer cycles to spin through while a write takes 4 ms
+#include "../../../src/Config/config.h"
+#include "../../../src/EepromLog/eepromLog.h"
+
+#define MAX_HISTORY     8000
+#define MAX_LOG         (EEPROM_LOG_PAGES * (EEPROM_LOG_PAGE_SIZE - 2)) // All 1 byte differences
+#define CRASH_READINGS  1500 // Read after every write
+#define WRAP_READINGS   4000 // Over 255 pages with 2 byte differences
+#define RESET_EVERY     37 // Readings
+
+static uint16_t history[MAX_HISTORY]; // Everything added, in order
+static unsigned history_count;
+static unsigned pages_started;
+static uint32_t seed = 1;
+
+void __interrupt(high_priority) high_priority_interrupt(void) {
+    eeprom_log_isr();
+}
+
+// Numerical Recipes LCG, the same stream on every host
+static uint32_t random_u32(void) {
+    seed = seed * 1664525u + 1013904223u;
+    return seed;
+}
+
+// Stretches of slow readings that take 1 byte per difference, of big jumps that
+// take 2, and of both mixed
+static uint16_t next_reading(unsigned i) {
+    static uint16_t value = 2000;
+    uint32_t r = random_u32() >> 8;
+    int delta;
+
+    switch ((i / 300) % 3) {
+        case 0:
+            delta = (int) (r % 41) - 20;
+            break;
+        case 1:
+            delta = (int) (r % 4001) - 2000;
+            break;
+        default:
+            delta = r % 5 == 0 ? (int) (r % 2001) - 1000 : (int) (r % 129) - 64;
+            break;
+    }
+    value = (uint16_t) ((value + delta) & 0x0FFF);
+    return value;
+}
+
+// The readings of an image in the order they were added. Checks that the pages
+// in the log have sequence numbers one after the other.
+static unsigned decode(const uint8_t *image, uint16_t *log) {
+    unsigned newest = EEPROM_LOG_PAGES;
+    unsigned count = 0;
+    int last_sequence = -1;
+
+    for (unsigned page = 0; page < EEPROM_LOG_PAGES; page++) {
+        uint8_t sequence = image[page * EEPROM_LOG_PAGE_SIZE];
+        uint8_t next = image[(page + 1) % EEPROM_LOG_PAGES * EEPROM_LOG_PAGE_SIZE];
+
+        if (sequence != EEPROM_LOG_END && next != (sequence + 1) % EEPROM_LOG_SEQUENCES) {
+            newest = page;
+            break;
+        }
+    }
+    if (newest == EEPROM_LOG_PAGES) {
+        return 0;
+    }
+
+    // Oldest first, the page after the newest
+    for (unsigned n = 1; n <= EEPROM_LOG_PAGES; n++) {
+        const uint8_t *page = &image[(newest + n) % EEPROM_LOG_PAGES * EEPROM_LOG_PAGE_SIZE];
+        uint16_t value;
+
+        if (page[0] == EEPROM_LOG_END) {
+            continue; // Being written over, not in the log
+        }
+        if (last_sequence >= 0) {
+            CHECK_EQUAL(page[0], (last_sequence + 1) % EEPROM_LOG_SEQUENCES);
+        }
+        last_sequence = page[0];
+
+        value = (uint16_t) (page[1] | page[2] << 8);
+        log[count++] = value;
+        for (unsigned position = EEPROM_LOG_HEADER_SIZE; position < EEPROM_LOG_PAGE_SIZE; position++) {
+            uint16_t zigzag = page[position];
+
+            if (zigzag == EEPROM_LOG_END) {
+                break;
+            }
+            if (zigzag & 0x80) {
+                if (position + 1 == EEPROM_LOG_PAGE_SIZE) {
+                    break;
+                }
+                zigzag = (uint16_t) ((zigzag & 0x7F) << 7 | page[++position]);
+            }
+            value = (uint16_t) (value + ((zigzag & 1) ? ~(zigzag >> 1) : zigzag >> 1));
+            log[count++] = value;
+        }
+    }
+    return count;
+}
+
+// Decodes the EEPROM as it is now, with no write in progress
+static unsigned read_log(uint16_t *log) {
+    uint8_t image[EEPROM_LOG_SIZE];
+
+    for (unsigned address = 0; address < EEPROM_LOG_SIZE; address++) {
+        image[address] = eeprom_log_read((uint8_t) address);
+    }
+    return decode(image, log);
+}
+
+// The log must be the readings right before history[end], with end the newest
+// one or, while it is being written, the one before
+static unsigned check_log(int complete) {
+    uint16_t log[MAX_LOG];
+    unsigned count = read_log(log);
+    unsigned end = history_count;
+
+    if (count == 0 && !complete && history_count == 1) {
+        return 0; // The first page of an erased EEPROM is not in yet
+    }
+    if (count == 0 || count > history_count) {
+        CHECK(count > 0 && count <= history_count);
+        return count;
+    }
+    if (!complete && memcmp(log, &history[end - count], count * sizeof log[0]) != 0) {
+        end--; // The newest reading is not in yet
+    }
+    CHECK(end >= count && memcmp(log, &history[end - count], count * sizeof log[0]) == 0);
+    return count;
+}
+
+static void add(uint16_t value) {
+    uint8_t page = eeprom_log_page;
+
+    CHECK(history_count < MAX_HISTORY);
+    history[history_count++] = value;
+    CHECK(eeprom_log_add(value)); // The queue is empty every time
+    pages_started += eeprom_log_page != page || history_count == 1;
+}
+
+// Lets the queued writes finish one at a time and returns after write number
+// stop, or when they are all done
+static void step_writes(unsigned stop, int check_each) {
+    for (unsigned write = 0; !eeprom_log_idle() && write != stop; write++) {
+        INTCONbits.GIE = 0; // The next write only starts after the check
+        while (EECON1bits.WR) {
+            NOP(); // The simulated clock only moves on register accesses
+        }
+        if (check_each) {
+            check_log(0);
+        }
+        INTCONbits.GIE = 1;
+        NOP(); // Now EEIF starts the next write
+    }
+}
+
+// What a reset does: the queue and everything in RAM are gone
+static void reset(void) {
+    INTCONbits.GIE = 0;
+    while (EECON1bits.WR) {
+        NOP(); // A write that is cut off leaves its byte undefined
+    }
+    PIR2bits.EEIF = 0;
+    eeprom_log_page = 0;
+    eeprom_log_position = 0;
+    eeprom_log_sequence = 0;
+    eeprom_log_last = 0;
+    eeprom_log_dropped = 0;
+    eeprom_log_head = 0;
+    eeprom_log_tail = 0;
+    eeprom_log_writing = 0;
+
+    eeprom_log_init();
+    INTCONbits.GIE = 1;
+}
+
+// Every state between two writes is a complete log
+static void test_crash_consistency(void) {
+    unsigned full_ring = 0;
+
+    for (unsigned i = 0; i < CRASH_READINGS; i++) {
+        add(next_reading(i));
+        step_writes(UINT32_MAX, 1);
+
+        unsigned count = check_log(1);
+        if (pages_started > EEPROM_LOG_PAGES) {
+            CHECK(count >= (EEPROM_LOG_PAGES - 1) * 7); // 15 pages of 2 byte differences
+            full_ring++;
+        }
+    }
+    CHECK(full_ring > 0);
+}
+
+// Resets at every point of a reading, over the wrap of the sequence numbers
+static void test_reset_and_wrap(void) {
+    uint16_t log[MAX_LOG];
+    uint8_t wrapped = 0;
+
+    for (unsigned i = 0; i < WRAP_READINGS; i++) {
+        uint8_t sequence = eeprom_log_sequence;
+
+        add(next_reading(i));
+        if (i % RESET_EVERY != 0) {
+            step_writes(UINT32_MAX, 0);
+            check_log(1);
+            wrapped |= eeprom_log_sequence < sequence;
+            continue;
+        }
+
+        // The writes so far decide what is left, at most the newest reading is lost
+        step_writes(i / RESET_EVERY % 6, 0);
+        reset();
+        unsigned count = check_log(0);
+        CHECK(count > 0);
+
+        // From here on the log is what the history goes on from
+        count = read_log(log);
+        memcpy(history, log, count * sizeof log[0]);
+        history_count = count;
+        CHECK_EQUAL(eeprom_log_last, log[count - 1]);
+    }
+    CHECK(wrapped);
+}
+
+// Each round of the ring writes every byte at most twice
+static void test_wear(void) {
+    unsigned rounds = (pages_started + EEPROM_LOG_PAGES - 1) / EEPROM_LOG_PAGES;
+    uint32_t most = 0;
+
+    for (unsigned address = 0; address < EEPROM_LOG_SIZE; address++) {
+        uint32_t writes = pic_sim_eeprom_writes((uint8_t) address);
+        most = writes > most ? writes : most;
+    }
+    CHECK(rounds > 0);
+    CHECK_RANGE(most, 1, 2 * rounds);
+}
+
+int main(void) {
+    pic_sim_set_time_limit(UINT64_MAX); // The test ends itself
+
+    config_oscillator();
+    eeprom_log_init(); // Erased
+    INTCONbits.PEIE = 1;
+    INTCONbits.GIE = 1;
+
+    test_crash_consistency();
+    test_reset_and_wrap();
+    test_wear();
+
+    return check_summary("eepromLog");
+}
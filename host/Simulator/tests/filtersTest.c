@@ -0,0 +1,156 @@
+//**********************************************************************************
+// Host test of src/Filters/filters.h
+//
+// Every filter gets the same long stream of 12 bit readings: noise over the whole
+// range, a flat signal with single and double spikes, a slow ramp and steps
+// between 0 and 4095, which are the worst case for the 16 bit sums. Each output
+// is compared with a plain reference that keeps the whole history and does the
+// obvious thing: a double precision average, a division, a sort.
+//**********************************************************************************
+
+#include <stdint.h>
+
+#include "check.h"
+#include "../../../src/Filters/filters.h"
+
+#define READINGS    40000
+#define SEGMENT     500 // Readings of one kind in a row
+
+static uint16_t readings[READINGS];
+static uint32_t seed = 1;
+
+// Numerical Recipes LCG, the same stream on every host
+static uint16_t random_reading(void) {
+    seed = seed * 1664525u + 1013904223u;
+    return (uint16_t) (seed >> 20); // 12 bits
+}
+
+static void make_readings(void) {
+    for (int i = 0; i < READINGS; i++) {
+        uint16_t value;
+
+        switch ((i / SEGMENT) % 4) {
+            case 0:
+                value = random_reading();
+                break;
+            case 1:
+                value = 1000 + (random_reading() & 0x0F);
+                if (random_reading() < 200) {
+                    value = random_reading() & 1 ? 4095 : 0; // Spike, sometimes two in a row
+                }
+                break;
+            case 2:
+                value = (uint16_t) ((i % SEGMENT) * 4095 / (SEGMENT - 1));
+                break;
+            default:
+                value = (i / 7) & 1 ? 4095 : 0;
+                break;
+        }
+        readings[i] = value;
+    }
+}
+
+// The reading n back from i, the first reading stands in for those before it,
+// the same as the init functions fill the filters
+static uint16_t history(int i, int n) {
+    return i - n < 0 ? readings[0] : readings[i - n];
+}
+
+static uint16_t median(int i, int length) {
+    uint16_t window[5];
+
+    for (int n = 0; n < length; n++) {
+        window[n] = history(i, n);
+    }
+    for (int a = 1; a < length; a++) {
+        for (int b = a; b > 0 && window[b - 1] > window[b]; b--) {
+            uint16_t t = window[b];
+            window[b] = window[b - 1];
+            window[b - 1] = t;
+        }
+    }
+    return window[length / 2];
+}
+
+// The 16 bit sum must do what the same sum does in 32 bits, and that stays
+// within one count of the exact average
+static void test_ema(void) {
+    filter_ema_t filter;
+    uint32_t sum = (uint32_t) readings[0] << FILTER_EMA_SHIFT;
+    double exact = readings[0];
+    double weight = 1.0 / (1 << FILTER_EMA_SHIFT);
+
+    filter_ema_init(&filter, readings[0]);
+    for (int i = 0; i < READINGS; i++) {
+        uint16_t output = filter_ema(&filter, readings[i]);
+
+        sum = sum - (sum >> FILTER_EMA_SHIFT) + readings[i];
+        exact += (readings[i] - exact) * weight;
+        CHECK_EQUAL(output, sum >> FILTER_EMA_SHIFT);
+        CHECK_RANGE(output - exact, -1.0, 1.0);
+    }
+}
+
+static void test_boxcar(void) {
+    filter_boxcar_t filter;
+
+    filter_boxcar_init(&filter, readings[0]);
+    for (int i = 0; i < READINGS; i++) {
+        uint32_t sum = 0;
+
+        for (int n = 0; n < FILTER_BOXCAR_LENGTH; n++) {
+            sum += history(i, n);
+        }
+        CHECK_EQUAL(filter_boxcar(&filter, readings[i]), sum / FILTER_BOXCAR_LENGTH);
+    }
+}
+
+static void test_median3(void) {
+    filter_median3_t filter;
+
+    filter_median3_init(&filter, readings[0]);
+    for (int i = 0; i < READINGS; i++) {
+        CHECK_EQUAL(filter_median3(&filter, readings[i]), median(i, 3));
+    }
+}
+
+static void test_median5(void) {
+    filter_median5_t filter;
+
+    filter_median5_init(&filter, readings[0]);
+    for (int i = 0; i < READINGS; i++) {
+        CHECK_EQUAL(filter_median5(&filter, readings[i]), median(i, 5));
+    }
+}
+
+// The state is whatever the last reading outside the band said, the start state
+// while there was none
+static void test_hysteresis(uint16_t off_below, uint16_t on_above, uint8_t start) {
+    filter_hysteresis_t filter;
+    int last_outside = -1;
+
+    filter_hysteresis_init(&filter, start);
+    for (int i = 0; i < READINGS; i++) {
+        uint8_t output = filter_hysteresis(&filter, readings[i], off_below, on_above);
+
+        if (readings[i] > on_above || readings[i] < off_below) {
+            last_outside = i;
+        }
+        CHECK_EQUAL(output, last_outside < 0 ? start : readings[last_outside] > on_above);
+    }
+}
+
+int main(void) {
+    make_readings();
+
+    test_ema();
+    test_boxcar();
+    test_median3();
+    test_median5();
+    test_hysteresis(1800, 2200, 0);
+    test_hysteresis(1800, 2200, 1);
+    test_hysteresis(1000, 1010, 0); // Inside the wobble of the spike segments
+    test_hysteresis(0, 4095, 1); // Nothing is ever outside
+
+    return check_summary("filters");
+}
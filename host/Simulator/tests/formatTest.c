@@ -0,0 +1,113 @@
+//**********************************************************************************
+// Host test of src/Format/format.h
+//
+// Every 8 and 16 bit value, and every 16 bit value with 1 to 3 decimals, is
+// formatted and compared with what snprintf() makes of it. 32 bits are too many
+// for that: format_u32() gets every value up to 2^17, where it switches from the
+// 16 bit path, the values around each power of ten, the top of the range and a
+// million random ones. The returned length must match, and nothing may be
+// written past the size the header gives for the buffer.
+//**********************************************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "check.h"
+#include "../../../src/Format/format.h"
+
+#define GUARD 0x5A // Fills the buffer past its size
+
+static char buffer[FORMAT_U32_SIZE + 4];
+static uint32_t seed = 1;
+
+// Numerical Recipes LCG, the same stream on every host
+static uint32_t random_u32(void) {
+    seed = seed * 1664525u + 1013904223u;
+    return seed;
+}
+
+static void fill(void) {
+    memset(buffer, GUARD, sizeof buffer);
+}
+
+static void check_text(uint8_t length, const char *expected, uint8_t size) {
+    int same = strcmp(buffer, expected) == 0;
+
+    CHECK_EQUAL(length, strlen(expected));
+    if (!CHECK(same) && check_failures <= CHECK_PRINT_LIMIT) {
+        printf("    \"%s\", expected \"%s\"\n", buffer, expected);
+    }
+    for (unsigned i = size; i < sizeof buffer; i++) {
+        CHECK_EQUAL(buffer[i], GUARD);
+    }
+}
+
+static void test_u8(void) {
+    char expected[16];
+
+    for (unsigned value = 0; value <= 0xFF; value++) {
+        snprintf(expected, sizeof expected, "%u", value);
+        fill();
+        check_text(format_u8(buffer, (uint8_t) value), expected, FORMAT_U8_SIZE);
+    }
+}
+
+static void test_u16(void) {
+    char expected[16];
+
+    for (unsigned value = 0; value <= 0xFFFF; value++) {
+        snprintf(expected, sizeof expected, "%u", value);
+        fill();
+        check_text(format_u16(buffer, (uint16_t) value), expected, FORMAT_U16_SIZE);
+    }
+}
+
+static void test_fixed(void) {
+    static const unsigned scale[] = { 1, 10, 100, 1000 };
+    char expected[16];
+
+    for (uint8_t decimals = 1; decimals <= 3; decimals++) {
+        for (unsigned value = 0; value <= 0xFFFF; value++) {
+            snprintf(expected, sizeof expected, "%u.%0*u", value / scale[decimals], decimals,
+                     value % scale[decimals]);
+            fill();
+            check_text(format_fixed(buffer, (uint16_t) value, decimals), expected, FORMAT_FIXED_SIZE);
+        }
+    }
+}
+
+static void check_u32(uint32_t value) {
+    char expected[16];
+
+    snprintf(expected, sizeof expected, "%lu", (unsigned long) value);
+    fill();
+    check_text(format_u32(buffer, value), expected, FORMAT_U32_SIZE);
+}
+
+static void test_u32(void) {
+    for (uint32_t value = 0; value <= 0x20000; value++) {
+        check_u32(value);
+    }
+    for (uint32_t power = 10; power <= 1000000000; power *= 10) {
+        for (uint32_t offset = 0; offset < 3; offset++) {
+            check_u32(power - 1 - offset);
+            check_u32(power + offset);
+        }
+    }
+    for (uint32_t offset = 0; offset < 1000; offset++) {
+        check_u32(UINT32_MAX - offset);
+    }
+    for (int i = 0; i < 1000000; i++) {
+        check_u32(random_u32());
+    }
+}
+
+int main(void) {
+    test_u8();
+    test_u16();
+    test_fixed();
+    test_u32();
+
+    return check_summary("format");
+}
@@ -0,0 +1,104 @@
+//**********************************************************************************
+// Host test of src/Interrupt/interrupt.c on stimulus/interrupt.txt
+//
+// The sample is built with -DINTERRUPT_ALL_SOURCES, so all eight sources of the
+// dispatcher are enabled. From 2500 ms on INT and IOC fire at 5 kHz while bytes
+// stream in and a reply goes out, with the timers and the ADC running, so several
+// flags are often set at once. The sample answers every '?' with the events of
+// each source and the dropped ones, and the replies are checked after the run
+// against what the stimulus sent: every edge, byte and TXIF handled, the timers
+// at their rates and nothing dropped from the queue.
+// The routine handles one source per entry, so its longest run is that of the
+// longest handler however many flags are set. The simulator only charges the
+// register accesses, so the bound here is on those; the length on the chip comes
+// from a -DPROFILER build.
+//**********************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "check.h"
+#include "simulator.h"
+
+#define RUN_MS          3200
+#define REPLIES         3 // At 2510, 3000 and 3100 ms
+#define SOURCES         8 // INT, IOC, TMR0, TMR1, TMR2, RX, TX_READY, ADC
+#define MAX_LINE        64
+#define PRESSES         4
+#define EDGES           200 // 40 ms at 5 kHz
+#define RX_BYTES        (PRESSES + 3 * 36 + 3) // Bytes, streams and '?' up to 3100 ms
+#define ISR_CYCLES_MAX  24 // The RX handler, with every check before it
+
+enum { INT, IOC, TMR0, TMR1, TMR2, RX, TX_READY, ADC, DROPPED };
+
+static char line[MAX_LINE];
+static unsigned line_length;
+static unsigned reply[REPLIES][SOURCES + 1];
+static unsigned reply_length[REPLIES]; // Bytes, CR LF included
+static unsigned replies;
+
+static void sink(uint8_t data, uint64_t time_ns) {
+    (void) time_ns;
+    if (line_length < MAX_LINE - 1) {
+        line[line_length++] = (char) data;
+    }
+    if (data != '\n') {
+        return;
+    }
+    line[line_length] = '\0';
+    if (replies < REPLIES) {
+        unsigned *r = reply[replies];
+        int fields = sscanf(line, "%u %u %u %u %u %u %u %u %u", &r[0], &r[1], &r[2], &r[3], &r[4], &r[5],
+                            &r[6], &r[7], &r[8]);
+
+        CHECK_EQUAL(fields, SOURCES + 1);
+        reply_length[replies] = line_length;
+    }
+    replies++;
+    line_length = 0;
+}
+
+// The reply to the '?' at ms
+static void check_reply(const unsigned *r, double ms) {
+    CHECK_RANGE(r[TMR0], ms / 16.384 - 2, ms / 16.384);
+    CHECK_RANGE(r[TMR1], ms / 32.768 - 2, ms / 32.768);
+    CHECK_RANGE(r[TMR2], ms - 2, ms);
+    CHECK_RANGE(r[ADC], r[TMR2] - 1, r[TMR2]); // One conversion per Timer2 period
+    CHECK_EQUAL(r[DROPPED], 0);
+}
+
+static void check(void) {
+    CHECK_EQUAL(replies, REPLIES);
+
+    // In the middle of the stream
+    CHECK_RANGE(reply[0][INT], PRESSES + 1, PRESSES + EDGES);
+    CHECK_RANGE(reply[0][IOC], PRESSES + 1, PRESSES + EDGES);
+    CHECK_EQUAL(reply[0][TX_READY], 0);
+    check_reply(reply[0], 2510);
+
+    // Every edge and byte, and a TXIF for every byte of the replies before and
+    // one more after the last
+    for (unsigned i = 1; i < REPLIES; i++) {
+        CHECK_EQUAL(reply[i][INT], PRESSES + EDGES);
+        CHECK_EQUAL(reply[i][IOC], PRESSES + EDGES);
+        CHECK_EQUAL(reply[i][RX], RX_BYTES - (REPLIES - 1 - i));
+    }
+    CHECK_EQUAL(reply[1][TX_READY], reply_length[0] + 1);
+    CHECK_EQUAL(reply[2][TX_READY], reply_length[0] + reply_length[1] + 2);
+    check_reply(reply[1], 3000);
+    check_reply(reply[2], 3100);
+
+    CHECK_RANGE(pic_sim_isr_longest_cycles(), 1, ISR_CYCLES_MAX);
+
+    if (check_summary("interrupt") != 0) {
+        fflush(NULL);
+        _exit(1); // The run ends with exit(0) at the time limit
+    }
+}
+
+__attribute__((constructor)) static void setup(void) {
+    pic_sim_set_uart_sink(sink);
+    pic_sim_set_time_limit(PIC_SIM_MS(RUN_MS));
+    atexit(check);
+}
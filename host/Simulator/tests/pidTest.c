@@ -0,0 +1,195 @@
+//**********************************************************************************
+// Host test of src/PID/pid.c on stimulus/pid.txt
+//
+// The simulator runs the plant of the stimulus, an RC with a 50 ms time constant,
+// and hands over every conversion of AN3, the measurement, and every duty cycle
+// the PWM latches, the output. The response to each step of the stimulus is
+// checked after the run:
+//      0 ms        the start at 512 settles and stays there
+//      1000 ms     step to 300: settling time and overshoot
+//      2000 ms     the plant gain drops from 900 to 700: back at 300
+//      3000 ms     setpoint 800, out of reach: the output sits at the limit
+//      3500 ms     back to 400: the output leaves the limit at once and the
+//                  measurement settles about as fast as after the first step
+//      4500 ms     S: no loop overrun, updates at the upper limit counted, and
+//                  the loop done within one period of TMR2. The simulator does
+//                  not charge the arithmetic, so that figure is a lower bound,
+//                  less than one count of 64 cycles here.
+// Settling means within 2 % of the step for good. With the anti-windup of pid.h
+// taken out the output stays at the limit for 170 ms after the 3500 ms step and
+// the measurement needs 300 ms to get there.
+//**********************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "check.h"
+#include "simulator.h"
+
+#define RUN_MS          4700 // The stimulus asks for the statistics at 4500 ms
+#define STATS_MS        4500
+#define MEASUREMENT     3 // AN3
+#define MAX_UPDATES     (RUN_MS * 2) // 1953 a second and some room
+#define OUTPUT_MAX      1023
+#define PERIOD_COUNTS   256 // PR2 = 255
+#define MAX_LINE        32
+
+typedef struct {
+    uint64_t time_ns;
+    uint16_t value;
+} reading_t;
+
+static reading_t measurement[MAX_UPDATES];
+static reading_t output[MAX_UPDATES];
+static unsigned measurements;
+static unsigned outputs;
+
+static char line[MAX_LINE];
+static unsigned line_length;
+static unsigned stats[4]; // Loop counts, overruns, upper and lower limit
+static int stats_fields;
+
+static void adc_sink(uint8_t channel, uint16_t value, uint64_t time_ns) {
+    if (channel == MEASUREMENT && measurements < MAX_UPDATES) {
+        measurement[measurements].time_ns = time_ns;
+        measurement[measurements].value = value;
+        measurements++;
+    }
+}
+
+static void pwm_sink(uint16_t duty, uint64_t time_ns, uint64_t write_offset_ns) {
+    (void) write_offset_ns;
+    if (outputs < MAX_UPDATES) {
+        output[outputs].time_ns = time_ns;
+        output[outputs].value = duty;
+        outputs++;
+    }
+}
+
+// The first reply after the S with four numbers, the reports have three
+static void uart_sink(uint8_t data, uint64_t time_ns) {
+    if (data != '\n') {
+        if (line_length < MAX_LINE - 1) {
+            line[line_length++] = (char) data;
+        }
+        return;
+    }
+    line[line_length] = '\0';
+    line_length = 0;
+    if (time_ns >= PIC_SIM_MS(STATS_MS) && stats_fields != 4) {
+        stats_fields = sscanf(line, "%u %u %u %u", &stats[0], &stats[1], &stats[2], &stats[3]);
+    }
+}
+
+// Milliseconds from a time of the stimulus until the last reading between then
+// and the end of the window that was further than band from the target
+static double last_outside(const reading_t *readings, unsigned count, double from_ms, double to_ms,
+                           int target, int band) {
+    uint64_t from = PIC_SIM_MS(from_ms);
+    uint64_t to = PIC_SIM_MS(to_ms);
+    uint64_t last = from;
+
+    for (unsigned i = 0; i < count && readings[i].time_ns < to; i++) {
+        if (readings[i].time_ns >= from && abs(readings[i].value - target) > band) {
+            last = readings[i].time_ns;
+        }
+    }
+    return (last - from) / 1e6;
+}
+
+// Milliseconds from a time of the stimulus until the first reading within band
+// of the target
+static double first_inside(const reading_t *readings, unsigned count, double from_ms, int target,
+                           int band) {
+    uint64_t from = PIC_SIM_MS(from_ms);
+
+    for (unsigned i = 0; i < count; i++) {
+        if (readings[i].time_ns >= from && abs(readings[i].value - target) <= band) {
+            return (readings[i].time_ns - from) / 1e6;
+        }
+    }
+    return 1e9;
+}
+
+// How far the measurement went past the target, in percent of the step
+static double overshoot(double from_ms, double to_ms, int start, int target) {
+    uint64_t from = PIC_SIM_MS(from_ms);
+    uint64_t to = PIC_SIM_MS(to_ms);
+    int most = 0;
+
+    for (unsigned i = 0; i < measurements && measurement[i].time_ns < to; i++) {
+        if (measurement[i].time_ns >= from) {
+            int past = target > start ? measurement[i].value - target : target - measurement[i].value;
+            most = past > most ? past : most;
+        }
+    }
+    return 100.0 * most / abs(target - start);
+}
+
+// A setpoint step at from_ms: within 2 % of the step after settle_ms, and no
+// more than overshoot_percent past the setpoint before that
+static void check_step(double from_ms, double to_ms, int start, int target, double settle_ms,
+                       double overshoot_percent) {
+    int band = abs(target - start) / 50;
+
+    CHECK_RANGE(last_outside(measurement, measurements, from_ms, to_ms, target, band), 0, settle_ms);
+    CHECK_RANGE(overshoot(from_ms, to_ms, start, target), 0, overshoot_percent);
+}
+
+// The output at the limit in all but a few of the periods from from_ms on
+static void check_saturated(double from_ms, double to_ms) {
+    unsigned periods = 0;
+    unsigned limited = 0;
+
+    for (unsigned i = 0; i < outputs && output[i].time_ns < PIC_SIM_MS(to_ms); i++) {
+        if (output[i].time_ns >= PIC_SIM_MS(from_ms)) {
+            periods++;
+            limited += output[i].value >= OUTPUT_MAX - 3;
+        }
+    }
+    CHECK(periods > 0);
+    CHECK_RANGE(limited, periods * 0.95, periods);
+}
+
+static void check(void) {
+    CHECK_RANGE(measurements, RUN_MS * 1.9, MAX_UPDATES);
+    CHECK_RANGE(outputs, RUN_MS * 1.9, MAX_UPDATES);
+
+    // No error left once settled
+    CHECK_RANGE(last_outside(measurement, measurements, 0, 1000, 512, 10), 0, 200);
+    CHECK_RANGE(last_outside(measurement, measurements, 500, 1000, 512, 1), 0, 0);
+    CHECK_RANGE(last_outside(measurement, measurements, 1500, 2000, 300, 1), 0, 0);
+
+    check_step(1000, 2000, 512, 300, 200, 10); // 140 ms and 4 %
+    CHECK_RANGE(last_outside(measurement, measurements, 2000, 3000, 300, 4), 0, 300); // 160 ms
+    CHECK_RANGE(last_outside(measurement, measurements, 2500, 3000, 300, 1), 0, 0);
+
+    // 700 is all the plant can do
+    check_saturated(3100, 3500);
+    CHECK_RANGE(last_outside(measurement, measurements, 3000, 3500, 700, 4), 0, 300);
+
+    // Anti-windup: off the limit within a few periods, 1 ms here
+    CHECK_RANGE(first_inside(output, outputs, 3500, 0, OUTPUT_MAX - 4), 0, 5);
+    CHECK_RANGE(first_inside(measurement, measurements, 3500, 400, 6), 0, 100); // 50 ms
+    check_step(3500, STATS_MS, 699, 400, 250, 15); // 174 ms and 9 %
+
+    // The statistics of the whole run
+    CHECK_EQUAL(stats_fields, 4);
+    CHECK_RANGE(stats[0], 0, PERIOD_COUNTS - 1); // 0 here, the ISR charges less than a count
+    CHECK_EQUAL(stats[1], 0);
+    CHECK_RANGE(stats[2], 500, 1000); // From 3000 ms on, 0.4 s at 1953 a second
+
+    if (check_summary("pid") != 0) {
+        fflush(NULL);
+        _exit(1); // The run ends with exit(0) at the time limit
+    }
+}
+
+__attribute__((constructor)) static void setup(void) {
+    pic_sim_set_adc_sink(adc_sink);
+    pic_sim_set_pwm_sink(pwm_sink);
+    pic_sim_set_uart_sink(uart_sink);
+    pic_sim_set_time_limit(PIC_SIM_MS(RUN_MS));
+    atexit(check);
+}
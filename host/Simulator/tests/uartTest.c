@@ -0,0 +1,172 @@
+//**********************************************************************************
+// Host test of the transmit path of src/UART/uart.h
+//
+// The simulator stands in for the EUSART: TXREG, TXIF and the shift register run
+// at the configured baud rate and call the interrupt routine like the chip would,
+// and every byte that leaves the shift register comes back through the UART
+// sink. The test checks that the bytes come out in the order they were queued,
+// that the indexes wrap around the ring and their 8 bit counters many times
+// without losing or repeating a byte, and that uart_write() queues no more than
+// there is room for while the EUSART is kept busy back to back.
+//**********************************************************************************
+
+#include <xc.h>
+#include <stdint.h>
+
+#include "check.h"
+#include "simulator.h"
+
+#define _XTAL_FREQ  16000000
+#define CONFIG_BAUD 9600 // The default rate of the PC end of the simulated line
+#include "../../../src/Config/config.h"
+#include "../../../src/UART/uart.h"
+
+#define STREAM_LENGTH   1000 // Almost four turns of the 8 bit indexes
+#define BYTE_NS         (10ULL * 1000000000ULL / 9600) // Start, 8 data and stop bit
+
+static uint8_t received[STREAM_LENGTH];
+static uint64_t received_ns[STREAM_LENGTH];
+static unsigned received_count;
+
+void __interrupt(high_priority) high_priority_interrupt(void) {
+    uart_isr();
+}
+
+static void sink(uint8_t data, uint64_t time_ns) {
+    if (received_count < STREAM_LENGTH) {
+        received[received_count] = data;
+        received_ns[received_count] = time_ns;
+    }
+    received_count++;
+}
+
+// Byte i of a stream, not a multiple of the buffer size so a byte that comes
+// out one turn of the ring early or late does not match by chance
+static uint8_t stream_byte(unsigned i) {
+    return (uint8_t) (i * 7 + i / 251);
+}
+
+// Runs the virtual clock until the EUSART is idle and the ring is empty
+static void drain(void) {
+    uint64_t deadline = pic_sim_time_ns() + (UART_TX_BUFFER_SIZE + 2) * BYTE_NS + PIC_SIM_MS(1);
+
+    while ((uart_tx_free() != UART_TX_BUFFER_SIZE || !TXSTAbits.TRMT) && pic_sim_time_ns() < deadline) {
+        NOP();
+    }
+    CHECK_EQUAL(uart_tx_free(), UART_TX_BUFFER_SIZE);
+    CHECK(TXSTAbits.TRMT);
+    CHECK(!PIE1bits.TXIE); // Masked again once the ring ran empty
+}
+
+static void test_order(void) {
+    static const char message[] = "0123456789";
+
+    received_count = 0;
+    CHECK_EQUAL(uart_write(message, sizeof message - 1), sizeof message - 1);
+    drain();
+    CHECK_EQUAL(received_count, sizeof message - 1);
+    for (unsigned i = 0; i < sizeof message - 1 && i < received_count; i++) {
+        CHECK_EQUAL(received[i], message[i]);
+    }
+}
+
+// More than fits: exactly the free room is queued, and a full ring takes nothing
+static void test_back_pressure(void) {
+    uint8_t data[3 * UART_TX_BUFFER_SIZE];
+    unsigned queued;
+
+    for (unsigned i = 0; i < sizeof data; i++) {
+        data[i] = stream_byte(i);
+    }
+    received_count = 0;
+
+    // Interrupts off, nothing drains while the ring is looked at
+    INTCONbits.GIE = 0;
+    CHECK_EQUAL(uart_write(data, sizeof data), UART_TX_BUFFER_SIZE);
+    CHECK_EQUAL(uart_tx_free(), 0);
+    CHECK_EQUAL(uart_write(data, 1), 0);
+    INTCONbits.GIE = 1;
+
+    // The caller retries the rest as room comes free
+    queued = UART_TX_BUFFER_SIZE;
+    uint64_t deadline = pic_sim_time_ns() + (sizeof data + 2) * BYTE_NS;
+    while (queued < sizeof data && pic_sim_time_ns() < deadline) {
+        uint8_t free = uart_tx_free();
+        uint8_t length = (uint8_t) (sizeof data - queued);
+        uint8_t count = uart_write(&data[queued], length);
+
+        CHECK(count <= length);
+        CHECK(count >= (free < length ? free : length)); // The interrupt only makes room
+        queued += count;
+        NOP(); // The simulated clock only moves on register accesses
+    }
+    drain();
+
+    CHECK_EQUAL(received_count, sizeof data);
+    for (unsigned i = 0; i < sizeof data && i < received_count; i++) {
+        CHECK_EQUAL(received[i], data[i]);
+    }
+}
+
+// Chunks of 1 to UART_TX_BUFFER_SIZE bytes, each queued as soon as there is
+// room for all of it, so the head and the tail wrap at every position of the
+// ring. The EUSART never waits for the main loop: after the first byte every
+// byte follows the one before it by exactly one byte time.
+static void test_wraparound(void) {
+    unsigned queued = 0;
+    unsigned chunk = 0;
+    uint64_t deadline = pic_sim_time_ns() + (STREAM_LENGTH + 2) * BYTE_NS + PIC_SIM_MS(1);
+
+    received_count = 0;
+    while (queued < STREAM_LENGTH && pic_sim_time_ns() < deadline) {
+        uint8_t data[UART_TX_BUFFER_SIZE];
+        uint8_t length = (uint8_t) (chunk % UART_TX_BUFFER_SIZE + 1);
+
+        if (length > STREAM_LENGTH - queued) {
+            length = (uint8_t) (STREAM_LENGTH - queued);
+        }
+        if (uart_tx_free() < length) {
+            NOP(); // Wait for room for the whole chunk
+            continue;
+        }
+        for (uint8_t i = 0; i < length; i++) {
+            data[i] = stream_byte(queued + i);
+        }
+        CHECK_EQUAL(uart_write(data, length), length);
+        queued += length;
+        chunk++;
+    }
+    drain();
+
+    CHECK_EQUAL(queued, STREAM_LENGTH);
+    CHECK_EQUAL(received_count, STREAM_LENGTH);
+    for (unsigned i = 0; i < STREAM_LENGTH && i < received_count; i++) {
+        CHECK_EQUAL(received[i], stream_byte(i));
+    }
+
+    uint64_t gap_min = UINT64_MAX;
+    uint64_t gap_max = 0;
+    for (unsigned i = 2; i < STREAM_LENGTH && i < received_count; i++) {
+        uint64_t gap = received_ns[i] - received_ns[i - 1];
+        gap_min = gap < gap_min ? gap : gap_min;
+        gap_max = gap > gap_max ? gap : gap_max;
+    }
+    CHECK(gap_max - gap_min <= 1000); // Within a microsecond of the bit timing
+    CHECK_RANGE(gap_max, BYTE_NS * 0.98, BYTE_NS * 1.02);
+}
+
+int main(void) {
+    pic_sim_set_time_limit(UINT64_MAX); // The test ends itself
+    pic_sim_set_uart_sink(sink);
+
+    config_oscillator();
+    uart_init();
+    INTCONbits.GIE = 1;
+
+    test_order();
+    test_back_pressure();
+    test_wraparound();
+    test_order(); // Still right after the indexes wrapped
+
+    return check_summary("uart");
+}
@@ -0,0 +1,337 @@
+//**********************************************************************************
+// Host stand-in for <xc.h> so the PIC12F1822 samples build with gcc on Linux
+//
+// Every SFR used by the samples is declared with the same names and bitfields as
+// the XC8 device header. Each access goes through pic_sfr_access(), which lets the
+// simulator advance its virtual clock, run the peripherals and call the interrupt
+// routine between two register accesses, the same way the chip would between two
+// instructions. See simulator.h for the hooks and simulator.c for the model.
+//
+// Build a sample with:
+//   gcc -Wno-unknown-pragmas -I host/Simulator src/UART/uart.c host/Simulator/simulator.c
+//**********************************************************************************
+
+#ifndef PIC_SIM_XC_H
+#define PIC_SIM_XC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Registers of the model. The low/high pairs come first and next to each other so
+// the 16 bit views (ADRES, TMR1, CCPR1) can read them as one aligned little endian word.
+enum {
+    PIC_SFR_ADRESL,
+    PIC_SFR_ADRESH,
+    PIC_SFR_TMR1L,
+    PIC_SFR_TMR1H,
+    PIC_SFR_CCPR1L,
+    PIC_SFR_CCPR1H,
+    PIC_SFR_PORTA,
+    PIC_SFR_LATA,
+    PIC_SFR_TRISA,
+    PIC_SFR_ANSELA,
+    PIC_SFR_WPUA,
+    PIC_SFR_APFCON,
+    PIC_SFR_OSCCON,
+    PIC_SFR_OSCSTAT,
+    PIC_SFR_OPTION_REG,
+    PIC_SFR_INTCON,
+    PIC_SFR_PIE1,
+    PIC_SFR_PIE2,
+    PIC_SFR_PIR1,
+    PIC_SFR_PIR2,
+    PIC_SFR_IOCAP,
+    PIC_SFR_IOCAN,
+    PIC_SFR_IOCAF,
+    PIC_SFR_TMR0,
+    PIC_SFR_T1CON,
+    PIC_SFR_T1GCON,
+    PIC_SFR_TMR2,
+    PIC_SFR_PR2,
+    PIC_SFR_T2CON,
+    PIC_SFR_CCP1CON,
+    PIC_SFR_PWM1CON,
+    PIC_SFR_CCP1AS,
+    PIC_SFR_PSTR1CON,
+    PIC_SFR_ADCON0,
+    PIC_SFR_ADCON1,
+    PIC_SFR_FVRCON,
+    PIC_SFR_DACCON0,
+    PIC_SFR_DACCON1,
+    PIC_SFR_TXREG,
+    PIC_SFR_RCREG,
+    PIC_SFR_SPBRGL,
+    PIC_SFR_SPBRGH,
+    PIC_SFR_TXSTA,
+    PIC_SFR_RCSTA,
+    PIC_SFR_BAUDCON,
+    PIC_SFR_EEADRL,
+    PIC_SFR_EEADRH,
+    PIC_SFR_EEDATL,
+    PIC_SFR_EEDATH,
+    PIC_SFR_EECON1,
+    PIC_SFR_EECON2,
+    PIC_SFR_WDTCON,
+    PIC_SFR_COUNT
+};
+
+volatile uint8_t *pic_sfr_access(uint8_t sfr);
+void pic_delay_cycles(uint32_t cycles);
+void pic_nop(void);
+void pic_sleep(void);
+void pic_clrwdt(void);
+
+#define PIC_SFR8(sfr)          (*pic_sfr_access(PIC_SFR_##sfr))
+#define PIC_SFR16(sfr)         (*(volatile uint16_t *) pic_sfr_access(PIC_SFR_##sfr))
+#define PIC_SFRBITS(sfr, type) (*(volatile type *) pic_sfr_access(PIC_SFR_##sfr))
+
+// Compiler built-ins
+#define __interrupt(priority) __attribute__((section("pic_isr"), used, noinline))
+#define __delay_ms(x) pic_delay_cycles((uint32_t) ((unsigned long long) (x) * (_XTAL_FREQ / 4000ULL)))
+#define __delay_us(x) pic_delay_cycles((uint32_t) ((unsigned long long) (x) * (_XTAL_FREQ / 4000ULL) / 1000ULL))
+#define _delay(x) pic_delay_cycles((uint32_t) (x))
+#define NOP() pic_nop()
+#define SLEEP() pic_sleep()
+#define CLRWDT() pic_clrwdt()
+#define ei() (INTCONbits.GIE = 1)
+#define di() (INTCONbits.GIE = 0)
+
+typedef struct {
+    unsigned char RA0 : 1, RA1 : 1, RA2 : 1, RA3 : 1, RA4 : 1, RA5 : 1, : 2;
+} PORTAbits_t;
+
+typedef struct {
+    unsigned char LATA0 : 1, LATA1 : 1, LATA2 : 1, LATA3 : 1, LATA4 : 1, LATA5 : 1, : 2;
+} LATAbits_t;
+
+typedef struct {
+    unsigned char TRISA0 : 1, TRISA1 : 1, TRISA2 : 1, TRISA3 : 1, TRISA4 : 1, TRISA5 : 1, : 2;
+} TRISAbits_t;
+
+typedef struct {
+    unsigned char ANSA0 : 1, ANSA1 : 1, ANSA2 : 1, : 1, ANSA4 : 1, : 3;
+} ANSELAbits_t;
+
+typedef struct {
+    unsigned char WPUA0 : 1, WPUA1 : 1, WPUA2 : 1, WPUA3 : 1, WPUA4 : 1, WPUA5 : 1, : 2;
+} WPUAbits_t;
+
+typedef struct {
+    unsigned char CCP1SEL : 1, P1BSEL : 1, TXCKSEL : 1, T1GSEL : 1, : 1, SSSEL : 1, SDOSEL : 1, RXDTSEL : 1;
+} APFCONbits_t;
+
+typedef struct {
+    unsigned char SCS : 2, : 1, IRCF : 4, SPLLEN : 1;
+} OSCCONbits_t;
+
+typedef struct {
+    unsigned char HFIOFS : 1, LFIOFR : 1, MFIOFR : 1, HFIOFL : 1, HFIOFR : 1, OSTS : 1, PLLR : 1, T1OSCR : 1;
+} OSCSTATbits_t;
+
+typedef struct {
+    unsigned char PS : 3, PSA : 1, TMR0SE : 1, TMR0CS : 1, INTEDG : 1, nWPUEN : 1;
+} OPTION_REGbits_t;
+
+typedef struct {
+    unsigned char IOCIF : 1, INTF : 1, TMR0IF : 1, IOCIE : 1, INTE : 1, TMR0IE : 1, PEIE : 1, GIE : 1;
+} INTCONbits_t;
+
+typedef struct {
+    unsigned char TMR1IE : 1, TMR2IE : 1, CCP1IE : 1, SSP1IE : 1, TXIE : 1, RCIE : 1, ADIE : 1, TMR1GIE : 1;
+} PIE1bits_t;
+
+typedef struct {
+    unsigned char : 3, BCL1IE : 1, EEIE : 1, C1IE : 1, : 1, OSFIE : 1;
+} PIE2bits_t;
+
+typedef struct {
+    unsigned char TMR1IF : 1, TMR2IF : 1, CCP1IF : 1, SSP1IF : 1, TXIF : 1, RCIF : 1, ADIF : 1, TMR1GIF : 1;
+} PIR1bits_t;
+
+typedef struct {
+    unsigned char : 3, BCL1IF : 1, EEIF : 1, C1IF : 1, : 1, OSFIF : 1;
+} PIR2bits_t;
+
+typedef struct {
+    unsigned char IOCAP0 : 1, IOCAP1 : 1, IOCAP2 : 1, IOCAP3 : 1, IOCAP4 : 1, IOCAP5 : 1, : 2;
+} IOCAPbits_t;
+
+typedef struct {
+    unsigned char IOCAN0 : 1, IOCAN1 : 1, IOCAN2 : 1, IOCAN3 : 1, IOCAN4 : 1, IOCAN5 : 1, : 2;
+} IOCANbits_t;
+
+typedef struct {
+    unsigned char IOCAF0 : 1, IOCAF1 : 1, IOCAF2 : 1, IOCAF3 : 1, IOCAF4 : 1, IOCAF5 : 1, : 2;
+} IOCAFbits_t;
+
+typedef struct {
+    unsigned char TMR1ON : 1, : 1, nT1SYNC : 1, T1OSCEN : 1, T1CKPS : 2, TMR1CS : 2;
+} T1CONbits_t;
+
+typedef struct {
+    unsigned char T1GSS : 2, T1GVAL : 1, T1GGO : 1, T1GSPM : 1, T1GTM : 1, T1GPOL : 1, TMR1GE : 1;
+} T1GCONbits_t;
+
+typedef struct {
+    unsigned char T2CKPS : 2, TMR2ON : 1, T2OUTPS : 4, : 1;
+} T2CONbits_t;
+
+typedef struct {
+    unsigned char CCP1M : 4, DC1B : 2, P1M : 2;
+} CCP1CONbits_t;
+
+typedef struct {
+    unsigned char P1DC : 7, P1RSEN : 1;
+} PWM1CONbits_t;
+
+typedef struct {
+    unsigned char PSS1BD : 2, PSS1AC : 2, CCP1AS : 3, CCP1ASE : 1;
+} CCP1ASbits_t;
+
+typedef struct {
+    unsigned char STR1A : 1, STR1B : 1, : 2, STR1SYNC : 1, : 3;
+} PSTR1CONbits_t;
+
+typedef union {
+    struct {
+        unsigned char ADON : 1, GO_nDONE : 1, CHS : 5, : 1;
+    };
+    struct {
+        unsigned char : 1, GO : 1, : 6;
+    };
+} ADCON0bits_t;
+
+typedef struct {
+    unsigned char ADPREF : 2, : 2, ADCS : 3, ADFM : 1;
+} ADCON1bits_t;
+
+typedef struct {
+    unsigned char ADFVR : 2, CDAFVR : 2, TSRNG : 1, TSEN : 1, FVRRDY : 1, FVREN : 1;
+} FVRCONbits_t;
+
+typedef struct {
+    unsigned char : 2, DACPSS : 2, : 1, DACOE : 1, DACLPS : 1, DACEN : 1;
+} DACCON0bits_t;
+
+typedef struct {
+    unsigned char DACR : 5, : 3;
+} DACCON1bits_t;
+
+typedef struct {
+    unsigned char TX9D : 1, TRMT : 1, BRGH : 1, SENDB : 1, SYNC : 1, TXEN : 1, TX9 : 1, CSRC : 1;
+} TXSTAbits_t;
+
+typedef struct {
+    unsigned char RX9D : 1, OERR : 1, FERR : 1, ADDEN : 1, CREN : 1, SREN : 1, RX9 : 1, SPEN : 1;
+} RCSTAbits_t;
+
+typedef struct {
+    unsigned char ABDEN : 1, WUE : 1, : 1, BRG16 : 1, SCKP : 1, : 1, RCIDL : 1, ABDOVF : 1;
+} BAUDCONbits_t;
+
+typedef struct {
+    unsigned char RD : 1, WR : 1, WREN : 1, WRERR : 1, FREE : 1, LWLO : 1, CFGS : 1, EEPGD : 1;
+} EECON1bits_t;
+
+typedef struct {
+    unsigned char SWDTEN : 1, WDTPS : 5, : 2;
+} WDTCONbits_t;
+
+#define PORTA          PIC_SFR8(PORTA)
+#define PORTAbits      PIC_SFRBITS(PORTA, PORTAbits_t)
+#define LATA           PIC_SFR8(LATA)
+#define LATAbits       PIC_SFRBITS(LATA, LATAbits_t)
+#define TRISA          PIC_SFR8(TRISA)
+#define TRISAbits      PIC_SFRBITS(TRISA, TRISAbits_t)
+#define ANSELA         PIC_SFR8(ANSELA)
+#define ANSELAbits     PIC_SFRBITS(ANSELA, ANSELAbits_t)
+#define WPUA           PIC_SFR8(WPUA)
+#define WPUAbits       PIC_SFRBITS(WPUA, WPUAbits_t)
+#define APFCON         PIC_SFR8(APFCON)
+#define APFCONbits     PIC_SFRBITS(APFCON, APFCONbits_t)
+#define OSCCON         PIC_SFR8(OSCCON)
+#define OSCCONbits     PIC_SFRBITS(OSCCON, OSCCONbits_t)
+#define OSCSTAT        PIC_SFR8(OSCSTAT)
+#define OSCSTATbits    PIC_SFRBITS(OSCSTAT, OSCSTATbits_t)
+#define OPTION_REG     PIC_SFR8(OPTION_REG)
+#define OPTION_REGbits PIC_SFRBITS(OPTION_REG, OPTION_REGbits_t)
+#define INTCON         PIC_SFR8(INTCON)
+#define INTCONbits     PIC_SFRBITS(INTCON, INTCONbits_t)
+#define PIE1           PIC_SFR8(PIE1)
+#define PIE1bits       PIC_SFRBITS(PIE1, PIE1bits_t)
+#define PIE2           PIC_SFR8(PIE2)
+#define PIE2bits       PIC_SFRBITS(PIE2, PIE2bits_t)
+#define PIR1           PIC_SFR8(PIR1)
+#define PIR1bits       PIC_SFRBITS(PIR1, PIR1bits_t)
+#define PIR2           PIC_SFR8(PIR2)
+#define PIR2bits       PIC_SFRBITS(PIR2, PIR2bits_t)
+#define IOCAP          PIC_SFR8(IOCAP)
+#define IOCAPbits      PIC_SFRBITS(IOCAP, IOCAPbits_t)
+#define IOCAN          PIC_SFR8(IOCAN)
+#define IOCANbits      PIC_SFRBITS(IOCAN, IOCANbits_t)
+#define IOCAF          PIC_SFR8(IOCAF)
+#define IOCAFbits      PIC_SFRBITS(IOCAF, IOCAFbits_t)
+#define TMR0           PIC_SFR8(TMR0)
+#define TMR1L          PIC_SFR8(TMR1L)
+#define TMR1H          PIC_SFR8(TMR1H)
+#define TMR1           PIC_SFR16(TMR1L)
+#define T1CON          PIC_SFR8(T1CON)
+#define T1CONbits      PIC_SFRBITS(T1CON, T1CONbits_t)
+#define T1GCON         PIC_SFR8(T1GCON)
+#define T1GCONbits     PIC_SFRBITS(T1GCON, T1GCONbits_t)
+#define TMR2           PIC_SFR8(TMR2)
+#define PR2            PIC_SFR8(PR2)
+#define T2CON          PIC_SFR8(T2CON)
+#define T2CONbits      PIC_SFRBITS(T2CON, T2CONbits_t)
+#define CCPR1L         PIC_SFR8(CCPR1L)
+#define CCPR1H         PIC_SFR8(CCPR1H)
+#define CCPR1          PIC_SFR16(CCPR1L)
+#define CCP1CON        PIC_SFR8(CCP1CON)
+#define CCP1CONbits    PIC_SFRBITS(CCP1CON, CCP1CONbits_t)
+#define PWM1CON        PIC_SFR8(PWM1CON)
+#define PWM1CONbits    PIC_SFRBITS(PWM1CON, PWM1CONbits_t)
+#define CCP1AS         PIC_SFR8(CCP1AS)
+#define CCP1ASbits     PIC_SFRBITS(CCP1AS, CCP1ASbits_t)
+#define PSTR1CON       PIC_SFR8(PSTR1CON)
+#define PSTR1CONbits   PIC_SFRBITS(PSTR1CON, PSTR1CONbits_t)
+#define ADRESL         PIC_SFR8(ADRESL)
+#define ADRESH         PIC_SFR8(ADRESH)
+#define ADRES          PIC_SFR16(ADRESL)
+#define ADCON0         PIC_SFR8(ADCON0)
+#define ADCON0bits     PIC_SFRBITS(ADCON0, ADCON0bits_t)
+#define ADCON1         PIC_SFR8(ADCON1)
+#define ADCON1bits     PIC_SFRBITS(ADCON1, ADCON1bits_t)
+#define FVRCON         PIC_SFR8(FVRCON)
+#define FVRCONbits     PIC_SFRBITS(FVRCON, FVRCONbits_t)
+#define DACCON0        PIC_SFR8(DACCON0)
+#define DACCON0bits    PIC_SFRBITS(DACCON0, DACCON0bits_t)
+#define DACCON1        PIC_SFR8(DACCON1)
+#define DACCON1bits    PIC_SFRBITS(DACCON1, DACCON1bits_t)
+#define TXREG          PIC_SFR8(TXREG)
+#define RCREG          PIC_SFR8(RCREG)
+#define SPBRGL         PIC_SFR8(SPBRGL)
+#define SPBRGH         PIC_SFR8(SPBRGH)
+#define TXSTA          PIC_SFR8(TXSTA)
+#define TXSTAbits      PIC_SFRBITS(TXSTA, TXSTAbits_t)
+#define RCSTA          PIC_SFR8(RCSTA)
+#define RCSTAbits      PIC_SFRBITS(RCSTA, RCSTAbits_t)
+#define BAUDCON        PIC_SFR8(BAUDCON)
+#define BAUDCONbits    PIC_SFRBITS(BAUDCON, BAUDCONbits_t)
+#define EEADRL         PIC_SFR8(EEADRL)
+#define EEADRH         PIC_SFR8(EEADRH)
+#define EEDATL         PIC_SFR8(EEDATL)
+#define EEDATH         PIC_SFR8(EEDATH)
+#define EECON1         PIC_SFR8(EECON1)
+#define EECON1bits     PIC_SFRBITS(EECON1, EECON1bits_t)
+#define EECON2         PIC_SFR8(EECON2)
+#define WDTCON         PIC_SFR8(WDTCON)
+#define WDTCONbits     PIC_SFRBITS(WDTCON, WDTCONbits_t)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
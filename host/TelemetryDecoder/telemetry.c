@@ -0,0 +1,200 @@
+//**********************************************************************************
+// PC side decoder for the telemetry frames of src/Telemetry/telemetry.h
+//**********************************************************************************
+
+#include "telemetry.h"
+
+#include <ctype.h>
+#include <string.h>
+
+uint8_t telemetry_crc8(const uint8_t *data, size_t length) {
+    uint8_t crc = 0;
+
+    while (length-- != 0) {
+        crc ^= *data++;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t) ((crc << 1) ^ 0x07) : (uint8_t) (crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+long telemetry_cobs_decode(const uint8_t *in, size_t length, uint8_t *out) {
+    size_t read = 0;
+    size_t written = 0;
+
+    while (read < length) {
+        uint8_t code = in[read++];
+
+        if (code == 0 || read + code - 1 > length) {
+            return -1;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            if (in[read] == 0) {
+                return -1;
+            }
+            out[written++] = in[read++];
+        }
+        // A code below 0xFF stands for a zero, except after the last block
+        if (code != 0xFF && read < length) {
+            out[written++] = 0;
+        }
+    }
+
+    return (long) written;
+}
+
+int telemetry_parse(const uint8_t *data, size_t length, telemetry_frame_t *frame) {
+    if (length < TELEMETRY_HEADER_SIZE + 1 || telemetry_crc8(data, length - 1) != data[length - 1]) {
+        return -1;
+    }
+
+    const uint8_t *payload = data + TELEMETRY_HEADER_SIZE;
+    size_t payload_length = length - TELEMETRY_HEADER_SIZE - 1;
+
+    frame->type = data[0] & 0xF0;
+    frame->count = data[0] & 0x0F;
+    frame->sequence = data[1];
+    frame->tick = (uint16_t) (data[2] | (data[3] << 8));
+
+    if (frame->type == TELEMETRY_TYPE_SAMPLES || frame->type == TELEMETRY_TYPE_SAMPLES12) {
+        unsigned width = frame->type == TELEMETRY_TYPE_SAMPLES12 ? 12 : 10;
+        uint32_t bits = 0;
+        unsigned bit_count = 0;
+        size_t used = 0;
+
+        if (payload_length != (frame->count * width + 7) / 8) {
+            return -1;
+        }
+        for (uint8_t i = 0; i < frame->count; i++) {
+            while (bit_count < width) {
+                bits = (bits << 8) | payload[used++];
+                bit_count += 8;
+            }
+            bit_count -= width;
+            frame->values[i] = (uint16_t) ((bits >> bit_count) & ((1u << width) - 1));
+        }
+    } else if (frame->type == TELEMETRY_TYPE_VALUES || frame->type == TELEMETRY_TYPE_LOG
+               || frame->type == TELEMETRY_TYPE_PROFILE) {
+        if (payload_length != frame->count * 2u) {
+            return -1;
+        }
+        for (uint8_t i = 0; i < frame->count; i++) {
+            frame->values[i] = (uint16_t) (payload[2 * i] | (payload[2 * i + 1] << 8));
+        }
+    } else {
+        return -1;
+    }
+
+    return 0;
+}
+
+// Same rules as eeprom_log_init() on the device: a page whose successor does not
+// carry the next sequence number is the newest, the one after it the oldest
+size_t telemetry_log_decode(const uint8_t *image, uint16_t *readings) {
+    const unsigned pages = TELEMETRY_LOG_SIZE / TELEMETRY_LOG_PAGE_SIZE;
+    unsigned newest = pages;
+    size_t count = 0;
+
+    for (unsigned page = 0; page < pages && newest == pages; page++) {
+        uint8_t sequence = image[page * TELEMETRY_LOG_PAGE_SIZE];
+        uint8_t next = image[(page + 1) % pages * TELEMETRY_LOG_PAGE_SIZE];
+
+        if (sequence != 0xFF && next != (sequence == 254 ? 0 : sequence + 1)) {
+            newest = page;
+        }
+    }
+    if (newest == pages) {
+        return 0; // Erased
+    }
+
+    for (unsigned i = 1; i <= pages; i++) {
+        const uint8_t *page = &image[(newest + i) % pages * TELEMETRY_LOG_PAGE_SIZE];
+        unsigned position = 3;
+
+        if (page[0] == 0xFF) {
+            continue; // Never written
+        }
+
+        uint16_t reading = (uint16_t) (page[1] | (page[2] << 8));
+        readings[count++] = reading;
+        while (position < TELEMETRY_LOG_PAGE_SIZE && page[position] != 0xFF) {
+            unsigned zigzag = page[position++];
+
+            if (zigzag & 0x80) {
+                if (position == TELEMETRY_LOG_PAGE_SIZE) {
+                    break;
+                }
+                zigzag = ((zigzag & 0x7F) << 7) | page[position++];
+            }
+            reading = (uint16_t) (reading + ((zigzag & 1) ? ~(zigzag >> 1) : zigzag >> 1));
+            readings[count++] = reading;
+        }
+    }
+
+    return count;
+}
+
+void telemetry_decoder_init(telemetry_decoder_t *decoder) {
+    memset(decoder, 0, sizeof *decoder);
+}
+
+static int is_text(const uint8_t *data, size_t length) {
+    if (length == 0) {
+        return 0;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (!isprint(data[i]) && data[i] != '\r' && data[i] != '\n' && data[i] != '\t') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+telemetry_result_t telemetry_decoder_push(telemetry_decoder_t *decoder, uint8_t data,
+                                          telemetry_frame_t *frame, char *text, size_t text_size) {
+    if (data != 0) {
+        if (decoder->length < sizeof decoder->buffer) {
+            decoder->buffer[decoder->length++] = data;
+        } else {
+            decoder->overflow = 1;
+        }
+        return TELEMETRY_NONE;
+    }
+
+    size_t length = decoder->length;
+    int overflow = decoder->overflow;
+    uint8_t decoded[TELEMETRY_MAX_ENCODED];
+    long decoded_length;
+
+    decoder->length = 0;
+    decoder->overflow = 0;
+    if (length == 0) {
+        return TELEMETRY_NONE; // Back to back delimiters
+    }
+
+    if (!overflow) {
+        decoded_length = telemetry_cobs_decode(decoder->buffer, length, decoded);
+        if (decoded_length > 0 && telemetry_parse(decoded, (size_t) decoded_length, frame) == 0) {
+            if (decoder->have_sequence && frame->sequence != decoder->next_sequence) {
+                decoder->lost_frames += (uint8_t) (frame->sequence - decoder->next_sequence);
+            }
+            decoder->have_sequence = 1;
+            decoder->next_sequence = (uint8_t) (frame->sequence + 1);
+            decoder->frames++;
+            return TELEMETRY_FRAME;
+        }
+
+        if (is_text(decoder->buffer, length) && text_size > 0) {
+            size_t copy = length < text_size - 1 ? length : text_size - 1;
+            memcpy(text, decoder->buffer, copy);
+            text[copy] = '\0';
+            decoder->text_lines++;
+            return TELEMETRY_TEXT;
+        }
+    }
+
+    decoder->bad_frames++;
+    return TELEMETRY_BAD;
+}
@@ -0,0 +1,86 @@
+//**********************************************************************************
+// PC side decoder for the telemetry frames of src/Telemetry/telemetry.h
+//
+// Feed the received bytes one at a time to telemetry_decoder_push(). Every time a
+// zero delimiter completes a frame it is COBS decoded, checked against its CRC-8
+// and unpacked into a telemetry_frame_t. Anything between two delimiters that is
+// not a valid frame but looks like text (the OK/ERR answers of the device) is
+// handed back as text instead of being counted as an error.
+//**********************************************************************************
+
+#ifndef TELEMETRY_DECODER_H
+#define TELEMETRY_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TELEMETRY_TYPE_SAMPLES  0x00
+#define TELEMETRY_TYPE_VALUES   0x10
+#define TELEMETRY_TYPE_SAMPLES12 0x20
+#define TELEMETRY_TYPE_LOG      0x30
+#define TELEMETRY_TYPE_PROFILE  0x40 // Region in the tick: runs, min, max, total low, total high
+
+// The EEPROM log of src/EepromLog/eepromLog.h
+#define TELEMETRY_LOG_SIZE      256
+#define TELEMETRY_LOG_PAGE_SIZE 16
+#define TELEMETRY_LOG_MAX_READINGS (TELEMETRY_LOG_SIZE / TELEMETRY_LOG_PAGE_SIZE * (TELEMETRY_LOG_PAGE_SIZE - 2))
+
+#define TELEMETRY_HEADER_SIZE   4
+#define TELEMETRY_MAX_VALUES    15
+#define TELEMETRY_MAX_ENCODED   256
+
+typedef struct {
+    uint8_t type;
+    uint8_t sequence;
+    uint16_t tick;
+    uint8_t count;
+    uint16_t values[TELEMETRY_MAX_VALUES];
+} telemetry_frame_t;
+
+typedef struct {
+    uint8_t buffer[TELEMETRY_MAX_ENCODED];
+    size_t length;
+    int overflow;
+
+    int have_sequence;
+    uint8_t next_sequence;
+
+    unsigned long frames;
+    unsigned long bad_frames; // COBS, CRC or length errors
+    unsigned long lost_frames; // Gaps in the sequence numbers
+    unsigned long text_lines;
+} telemetry_decoder_t;
+
+typedef enum {
+    TELEMETRY_NONE, // Need more bytes
+    TELEMETRY_FRAME, // *frame holds a valid frame
+    TELEMETRY_TEXT, // *text holds a zero terminated line of text
+    TELEMETRY_BAD // A delimiter ended something that is neither
+} telemetry_result_t;
+
+uint8_t telemetry_crc8(const uint8_t *data, size_t length);
+
+// Decodes one COBS block without its zero delimiter. Returns the decoded length,
+// or -1 if the block is malformed. out must hold at least length bytes.
+long telemetry_cobs_decode(const uint8_t *in, size_t length, uint8_t *out);
+
+// Checks and unpacks a decoded frame. Returns 0 on success, -1 otherwise.
+int telemetry_parse(const uint8_t *data, size_t length, telemetry_frame_t *frame);
+
+// Turns the 256 bytes of a log dump into the readings, oldest first. Returns how
+// many there are, at most TELEMETRY_LOG_MAX_READINGS.
+size_t telemetry_log_decode(const uint8_t *image, uint16_t *readings);
+
+void telemetry_decoder_init(telemetry_decoder_t *decoder);
+telemetry_result_t telemetry_decoder_push(telemetry_decoder_t *decoder, uint8_t data,
+                                          telemetry_frame_t *frame, char *text, size_t text_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
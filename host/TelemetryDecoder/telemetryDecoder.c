@@ -0,0 +1,222 @@
+//**********************************************************************************
+// Prints the telemetry frames sent by the samples
+//
+// Reads from a capture file, a serial port or a pty and prints one line per frame:
+//      <sequence> <tick> <type> <value> <value> ...
+// Text answers of the device are printed with a leading #. The pieces of an
+// EEPROM log dump are put together, and when the last one is in the readings of
+// the log are printed oldest first, one per line:
+//      log <index> <reading>
+// The statistics of src/Profiler/profiler.h come one region per line, in Timer1
+// counts:
+//      <sequence> profile <latency | region n> runs <n> min <t> max <t> mean <t>
+// A summary with the number of frames, bad frames and frames lost on the way goes
+// to stderr.
+//
+// Build and run:
+//      gcc -O2 -o telemetryDecoder telemetryDecoder.c telemetry.c
+//      ./telemetryDecoder /dev/ttyUSB0            (9600 baud)
+//      ./telemetryDecoder -b 115200 /dev/ttyUSB0
+//      ./telemetryDecoder capture.bin
+//**********************************************************************************
+
+#include "telemetry.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+static speed_t baud_constant(long baud) {
+    switch (baud) {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        default: return 0;
+    }
+}
+
+// Raw 8N1 so no byte of the binary stream gets translated or eaten
+static int configure_tty(int fd, long baud) {
+    struct termios tty;
+    speed_t speed = baud_constant(baud);
+
+    if (speed == 0) {
+        fprintf(stderr, "unsupported baud rate %ld\n", baud);
+        return -1;
+    }
+    if (tcgetattr(fd, &tty) != 0) {
+        perror("tcgetattr");
+        return -1;
+    }
+
+    cfmakeraw(&tty);
+    cfsetispeed(&tty, speed);
+    cfsetospeed(&tty, speed);
+    tty.c_cflag |= CLOCAL | CREAD;
+    tty.c_cc[VMIN] = 1;
+    tty.c_cc[VTIME] = 0;
+
+    if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+        perror("tcsetattr");
+        return -1;
+    }
+    return 0;
+}
+
+// The log dump put together from its frames
+static uint8_t log_image[TELEMETRY_LOG_SIZE];
+static unsigned log_received; // Bytes in order from address 0
+
+static void collect_log(const telemetry_frame_t *frame) {
+    unsigned address = frame->tick;
+
+    if (address == 0) {
+        log_received = 0; // A new dump
+    }
+    if (address != log_received || address + 2u * frame->count > TELEMETRY_LOG_SIZE) {
+        fprintf(stderr, "log piece at %u out of order, dump incomplete\n", address);
+        log_received = TELEMETRY_LOG_SIZE + 1; // Ignore the rest until the next dump
+        return;
+    }
+    for (uint8_t i = 0; i < frame->count; i++) {
+        log_image[address++] = (uint8_t) frame->values[i];
+        log_image[address++] = (uint8_t) (frame->values[i] >> 8);
+    }
+    log_received = address;
+
+    if (log_received == TELEMETRY_LOG_SIZE) {
+        uint16_t readings[TELEMETRY_LOG_MAX_READINGS];
+        size_t count = telemetry_log_decode(log_image, readings);
+
+        for (size_t i = 0; i < count; i++) {
+            printf("log %zu %u\n", i, readings[i]);
+        }
+    }
+}
+
+// One region of src/Profiler/profiler.h, region 0 is the interrupt latency. The
+// times are in Timer1 counts, instruction cycles unless the sample changed the
+// prescaler.
+static void print_profile(const telemetry_frame_t *frame) {
+    if (frame->count < 5) {
+        return;
+    }
+    unsigned runs = frame->values[0];
+    uint32_t total = frame->values[3] | ((uint32_t) frame->values[4] << 16);
+
+    printf("%3u profile ", frame->sequence);
+    if (frame->tick == 0) {
+        printf("latency");
+    } else {
+        printf("region %u", frame->tick);
+    }
+    if (runs == 0) {
+        printf(" runs 0\n");
+        return;
+    }
+    printf(" runs %u min %u max %u mean %.1f\n", runs, frame->values[1], frame->values[2], (double) total / runs);
+}
+
+static void print_frame(const telemetry_frame_t *frame) {
+    const char *type = "values";
+
+    if (frame->type == TELEMETRY_TYPE_SAMPLES) {
+        type = "samples";
+    } else if (frame->type == TELEMETRY_TYPE_SAMPLES12) {
+        type = "samples12";
+    } else if (frame->type == TELEMETRY_TYPE_LOG) {
+        collect_log(frame);
+        return;
+    } else if (frame->type == TELEMETRY_TYPE_PROFILE) {
+        print_profile(frame);
+        return;
+    }
+
+    printf("%3u %5u %s", frame->sequence, frame->tick, type);
+    for (uint8_t i = 0; i < frame->count; i++) {
+        printf(" %u", frame->values[i]);
+    }
+    putchar('\n');
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-b baud] <capture file | serial port | pty>\n", name);
+}
+
+int main(int argc, char **argv) {
+    long baud = 9600;
+    int option;
+
+    while ((option = getopt(argc, argv, "b:h")) != -1) {
+        switch (option) {
+            case 'b':
+                baud = strtol(optarg, NULL, 10);
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    const char *path = argv[optind];
+    int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY | O_NOCTTY);
+    if (fd < 0) {
+        perror(path);
+        return 1;
+    }
+    if (isatty(fd) && configure_tty(fd, baud) != 0) {
+        return 1;
+    }
+
+    telemetry_decoder_t decoder;
+    telemetry_frame_t frame;
+    char text[128];
+    uint8_t buffer[4096];
+
+    telemetry_decoder_init(&decoder);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    for (;;) {
+        ssize_t count = read(fd, buffer, sizeof buffer);
+
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("read");
+            break;
+        }
+        if (count == 0) {
+            break;
+        }
+
+        for (ssize_t i = 0; i < count; i++) {
+            switch (telemetry_decoder_push(&decoder, buffer[i], &frame, text, sizeof text)) {
+                case TELEMETRY_FRAME:
+                    print_frame(&frame);
+                    break;
+                case TELEMETRY_TEXT:
+                    text[strcspn(text, "\r\n")] = '\0';
+                    printf("# %s\n", text);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    fprintf(stderr, "%lu frames, %lu bad, %lu lost, %lu text lines\n",
+            decoder.frames, decoder.bad_frames, decoder.lost_frames, decoder.text_lines);
+    return 0;
+}
@@ -14,12 +14,43 @@
 // The sensor works like this: if the soil is dry it outputs 5V, if it is moist it outputs less.
 // After I obtain the data from the sensor I send it to my PC using UART protocol.
 // In order to receive the connection I use PuTTY.
+// The ADC is started by hardware: Timer1 runs from Fosc/4 and the CCP1 special
+// event trigger restarts it and starts a conversion every time it reaches CCPR1,
+// so the sample rate does not depend on how long the main loop takes.
+// Every conversion reads the next channel of ScanChannels: the sensor on AN2, a
+// second input on AN3, the temperature indicator and the 1.024 V fixed voltage
+// reference. The interrupt selects the next channel as soon as a conversion is
+// done, so the channel has the whole trigger period to settle before it is read.
+// It adds up 16 conversions of every channel and keeps 12 bits of each sum, 4
+// times less noise than a single reading. With the default 500 us trigger period
+// a complete scan of the 4 channels comes out 31 times per second.
+// The FVR reading tells what Vdd is, so the other readings are sent in millivolts
+// and the FVR slot of the frame carries Vdd in millivolts. All channels of one
+// scan go out together in a binary telemetry frame, see ../Telemetry/telemetry.h.
+// host/TelemetryDecoder prints them on the PC. The tick of a frame counts scans.
+// Before it is sent the sensor reading goes through one of the filters of
+// ../Filters/filters.h, and a hysteresis on the filtered reading lights the LED on
+// RA5 while the soil is dry, without flickering at the threshold.
+// Every 310th filtered sensor reading, about one every 10 s, also goes into a log
+// in the data EEPROM, see ../EepromLog/eepromLog.h. It survives a reset and holds
+// a few hundred readings, so the PC does not have to listen all the time: send M0
+// to keep the line quiet and D now and then to fetch the log in one burst.
+// The PC can also change the settings at runtime by sending a command and Enter:
+//      R<n>    start a conversion every n us (250-16383, default 500)
+//      M<n>    reporting mode, 0 = quiet, 1 = millivolts, 2 = raw 12 bit readings,
+//              3 = a line of text with the volts for a terminal like PuTTY
+//      F<n>    sensor filter, 0 = none, 1 = moving average (default),
+//              2 = boxcar of 4, 3 = median of 3, 4 = median of 5
+//      L<n>    log the sensor reading of every n-th scan, 0 = off
+//      D       dump the log, 32 telemetry frames with 8 bytes of the EEPROM each
+// The device answers OK or ERR, followed by a zero byte so the decoder can
+// tell the answer apart from the frames. The OK of D comes after the last frame.
 //**********************************************************************************
 //                                   PIC12F1822 Pinout for this example
 //                                   ----------
 //            5V Power source -> Vdd |1      8| GND
-//                               RA5 |2      7| RA0 -> TX
-//                               RA4 |3      6| RA1 -> RX
+//                    Dry LED <- RA5 |2      7| RA0 -> TX
+//        Second analog input -> RA4 |3      6| RA1 -> RX
 //                               RA3 |4      5| RA2 <- Voltage in from analog sensor
 //                                   ----------
 //**********************************************************************************
@@ -45,144 +76,329 @@
 #pragma config LVP = ON         // Low-Voltage Programming Enable (Low-voltage programming enabled)
 
 #include <xc.h> // Include standard header file
-#include <stdlib.h>
-#include <stdio.h>
 
 // Definitions
-#define _XTAL_FREQ  1000000 // This is used by the __delay_ms(xx) and __delay_us(xx) functions
-
-void uart_init() {
-    SPBRGH = 25 >> 8; // For 9600 Baud and with 11.0592 Mhz Crystal
-    SPBRGL = 25 & 0xFF;
-    APFCONbits.RXDTSEL = 0; // RA1 as RX Pin
-    APFCONbits.TXCKSEL = 0; // RA0 as TX Pin
-    TRISAbits.TRISA0 = 0; // RA0 as O/P Pin
-    TRISAbits.TRISA1 = 1; // RA0 as I/P Pin
-    ANSELA = 0; // Port A all pins are digital I/O Pin
-    WPUAbits.WPUA0 = 1; // Enable weak pull up on RA0
-    WPUAbits.WPUA1 = 1; // Enable weak pull up on RA1
-    TXSTAbits.TX9 = 0; // 8-BIT DATA MODE
-    TXSTAbits.TXEN = 1; // ENABLE TRANSMITTER
-    TXSTAbits.SYNC = 0; // ENABLE ASYNCHRONOUS MODE
-    TXSTAbits.SENDB = 0; // SYNC BREAK TRANSMISSION COMPLETED
-    TXSTAbits.BRGH = 1; // SELECT LOW BAUD RATE
-    BAUDCONbits.SCKP = 0; // DON'T INVERT POLARITY
-    BAUDCONbits.BRG16 = 1; // 8-BIT BAUDRATE GENERATOR
-    BAUDCONbits.ABDEN = 0; // AUTO BAUD RATE DETECT DISABLE
-
-    RCSTAbits.RX9 = 0; // ENABLE 8-BIT RECEPTION
-    RCSTAbits.CREN = 1; // ENABLE RECEIVER
-    RCSTAbits.FERR = 0;
-    RCSTAbits.OERR = 0;
-    RCSTAbits.SPEN = 1; // ENABLE SERIAL PORT 
+#define _XTAL_FREQ  16000000 // This is used by the __delay_ms(xx) and __delay_us(xx) functions
+
+#define CONFIG_BAUD 9600
+#define CONFIG_ADC
+#include "../Config/config.h"
+#define UART_TX_BUFFER_SIZE 32 // Room for a whole telemetry frame
+#include "../UART/uart.h"
+#define TELEMETRY_MAX_VALUES 4 // One scan per frame
+#include "../Telemetry/telemetry.h"
+#include "../Filters/filters.h"
+#include "../Format/format.h"
+#include "../EepromLog/eepromLog.h"
+
+#define OVERSAMPLE_COUNT 16 // Conversions per result, 4^2 for 2 extra bits
+
+// ADC channels as selected by ADCON0bits.CHS
+#define CHANNEL_AN2 0b00010 // RA2
+#define CHANNEL_AN3 0b00011 // RA4
+#define CHANNEL_TEMPERATURE 0b11101
+#define CHANNEL_FVR 0b11111
+
+#define FVR_MILLIVOLTS 1024 // FVRCONbits.ADFVR = 0b01
+
+// The order of the values in a frame. Remove the FVR and the readings go out raw.
+static const uint8_t ScanChannels[] = { CHANNEL_AN2, CHANNEL_AN3, CHANNEL_TEMPERATURE, CHANNEL_FVR };
+#define SCAN_COUNT sizeof ScanChannels
+
+// Settings the PC can change, see process_command()
+static uint16_t TriggerPeriod = 500; // Microseconds between two conversions
+static uint8_t ReportMode = 1; // 0 = quiet, 1 = millivolts, 2 = raw readings, 3 = text
+static uint8_t FilterMode = 1; // See filter_sensor()
+
+// Only one filter runs at a time, so they share the memory
+static union {
+    filter_ema_t ema;
+    filter_boxcar_t boxcar;
+    filter_median3_t median3;
+    filter_median5_t median5;
+} SensorFilter;
+static uint8_t SensorFilterStarted; // 0 until the first reading after a change
+static filter_hysteresis_t DryDetector;
+
+// The sensor reads near Vdd in dry soil. Raw 12 bit readings, so the thresholds
+// follow Vdd just like the sensor does.
+#define DRY_ON_ABOVE 3300 // About 80 % of Vdd
+#define DRY_OFF_BELOW 2900 // About 70 % of Vdd
+
+// Filled by the ADC interrupt
+static uint16_t Accumulators[SCAN_COUNT]; // 16 x 1023 still fits
+static uint8_t ScanIndex; // The channel that is converted now
+static uint8_t AccumulatedCount; // Complete scans in Accumulators
+static uint16_t ScanCount; // Results since start, the tick of the telemetry frames
+static uint16_t Snapshot[SCAN_COUNT]; // 12 bit results of one scan, owned by the main loop while SnapshotReady is 1
+static volatile uint8_t SnapshotReady;
+static volatile uint16_t SnapshotTick;
+static volatile uint8_t SnapshotOverruns; // Scans the main loop did not take in time
+
+// EEPROM log, see process_command()
+static uint16_t LogEvery = 310; // Scans per logged reading, 0 = off
+static uint16_t LogScans; // Since the last logged reading
+static uint8_t LogDumping; // A D command is being answered
+static uint8_t LogDumpAddress; // Of the next piece to send
+
+static const char ReplyOk[] = "OK\r\n"; // Sent with the terminating zero
+static const char ReplyError[] = "ERR\r\n";
+
+void __interrupt(high_priority) high_priority_interrupt(void) {
+    uart_isr(); // Move bytes between the EUSART and the ring buffers
+    eeprom_log_isr(); // Start the next queued EEPROM write
+
+    if (PIR1bits.ADIF) {
+        PIR1bits.ADIF = 0;
+        PIR1bits.CCP1IF = 0; // Only used to trigger the ADC
+        Accumulators[ScanIndex] += ADRES;
+
+        // Switch now, the acquisition of the next channel runs until the next trigger
+        if (++ScanIndex == SCAN_COUNT) {
+            ScanIndex = 0;
+            AccumulatedCount++;
+        }
+        ADCON0bits.CHS = ScanChannels[ScanIndex];
+
+        if (AccumulatedCount < OVERSAMPLE_COUNT) {
+            return;
+        }
+
+        // 16 samples add up to 14 bits, dropping 2 leaves 12 good bits
+        if (SnapshotReady) {
+            SnapshotOverruns++; // The main loop still has the last one, drop this one
+        } else {
+            for (uint8_t i = 0; i < SCAN_COUNT; i++) {
+                Snapshot[i] = Accumulators[i] >> 2;
+            }
+            SnapshotTick = ScanCount;
+            SnapshotReady = 1;
+        }
+        for (uint8_t i = 0; i < SCAN_COUNT; i++) {
+            Accumulators[i] = 0;
+        }
+        AccumulatedCount = 0;
+        ScanCount++;
+    }
+}
+
+// Sets the time between two conversions, Timer1 counts Fosc/4 = 4 MHz
+void set_trigger_period(uint16_t microseconds) {
+    uint16_t compare = microseconds * 4 - 1; // Timer1 restarts one count after the match
+
+    CCPR1H = compare >> 8;
+    CCPR1L = compare & 0xFF;
+    // Start over, a Timer1 already past the new match would run to the overflow first
+    TMR1H = 0;
+    TMR1L = 0;
+}
+
+// Turns the readings of one scan into millivolts in place. The FVR reading is
+// FVR_MILLIVOLTS on a scale where 4092 is Vdd, so every reading scales by the same
+// factor; the FVR slot is replaced by Vdd itself. Without an FVR channel in the
+// scan the readings stay as they are.
+uint8_t calibrate(uint16_t *values) {
+    uint16_t reference = 0;
+
+    for (uint8_t i = 0; i < SCAN_COUNT; i++) {
+        if (ScanChannels[i] == CHANNEL_FVR) {
+            reference = values[i];
+        }
+    }
+    if (reference == 0) {
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < SCAN_COUNT; i++) {
+        uint16_t reading = (ScanChannels[i] == CHANNEL_FVR) ? 4092 : values[i];
+        values[i] = (uint16_t) ((uint32_t) reading * FVR_MILLIVOLTS / reference);
+    }
+    return 1;
+}
+
+// Runs the sensor reading through the filter FilterMode selects
+uint16_t filter_sensor(uint16_t reading) {
+    if (!SensorFilterStarted) {
+        // Start from the current reading, not from 0
+        switch (FilterMode) {
+            case 1: filter_ema_init(&SensorFilter.ema, reading); break;
+            case 2: filter_boxcar_init(&SensorFilter.boxcar, reading); break;
+            case 3: filter_median3_init(&SensorFilter.median3, reading); break;
+            case 4: filter_median5_init(&SensorFilter.median5, reading); break;
+        }
+        SensorFilterStarted = 1;
+    }
+
+    switch (FilterMode) {
+        case 1: return filter_ema(&SensorFilter.ema, reading);
+        case 2: return filter_boxcar(&SensorFilter.boxcar, reading);
+        case 3: return filter_median3(&SensorFilter.median3, reading);
+        case 4: return filter_median5(&SensorFilter.median5, reading);
+        default: return reading;
+    }
+}
+
+// Longest line send_text() writes: "65.535 " per value and the line end
+#define TEXT_LINE_LENGTH (SCAN_COUNT * FORMAT_FIXED_SIZE + 3)
+
+// Sends one scan as text, volts with 3 decimals when calibrated, else the raw
+// readings. Like a frame the line is sent whole or not at all. It ends with a
+// zero, the same as the command answers, so the decoder shows it as text too.
+void send_text(const uint16_t *values, uint8_t calibrated) {
+    char Number[FORMAT_FIXED_SIZE];
+
+    if (uart_tx_free() < TEXT_LINE_LENGTH) {
+        return;
+    }
+    for (uint8_t i = 0; i < SCAN_COUNT; i++) {
+        uint8_t length = calibrated ? format_fixed(Number, values[i], 3) : format_u16(Number, values[i]);
+        Number[length++] = (i == SCAN_COUNT - 1) ? '\r' : ' ';
+        uart_write(Number, length);
+    }
+    uart_write("\n", 2); // With the terminating zero
 }
 
-void uart_send(char* message) {
-    for (size_t i = 0; i < sizeof message / sizeof message[0]; i++) {
-        TXREG = message[i];
+// Sends the next 8 bytes of the EEPROM log while a dump runs. It waits for the
+// queued writes so the log does not change under it, and logs nothing until it
+// is done. The OK goes out with the last piece.
+void send_log(void) {
+    uint16_t Piece[TELEMETRY_MAX_VALUES];
+
+    if (!eeprom_log_idle() || uart_tx_free() < TELEMETRY_BUFFER_SIZE + sizeof ReplyOk) {
+        return;
+    }
+    for (uint8_t i = 0; i < TELEMETRY_MAX_VALUES; i++) {
+        uint8_t address = (uint8_t) (LogDumpAddress + 2 * i);
+        Piece[i] = eeprom_log_read(address) | (uint16_t) (eeprom_log_read(address + 1) << 8);
+    }
+    telemetry_send(TELEMETRY_TYPE_LOG, LogDumpAddress, Piece, TELEMETRY_MAX_VALUES);
 
-        // The heart of the EUSART is the serial
-        // Transmit Shift Register (TSR). The TSR obtains its data from
-        // the transmit buffer, which is the TXREG register
-        while (TXSTAbits.TRMT == 0); // Wait the register to clear out
+    LogDumpAddress += 2 * TELEMETRY_MAX_VALUES;
+    if (LogDumpAddress == 0) {
+        LogDumping = 0; // Went all the way around
+        uart_write(ReplyOk, sizeof ReplyOk);
     }
 }
 
-unsigned int Read_ADC_Value(void) {
-    unsigned int ADCValue;
+// Runs the command line that uart_read_line() just completed
+void process_command(void) {
+    uint16_t value;
 
-    ADCON0bits.GO = 1; // start conversion
-    while (ADCON0bits.GO); // wait for conversion to finish
-    ADCValue = ADRESH << 8; // get the 2 msbs of the result and rotate 8 bits to the left
-    ADCValue = ADCValue + ADRESL; // now add the low 8 bits of the resut into our return variable
-    return (ADCValue); // return the 10bit result in a single variable
+    if (uart_line[0] == 'D' && uart_line[1] == '\0') {
+        LogDumping = 1;
+        LogDumpAddress = 0;
+        return;
+    }
+
+    if (!uart_parse_number(&uart_line[1], &value)) {
+        uart_write(ReplyError, sizeof ReplyError);
+        return;
+    }
+
+    if (uart_line[0] == 'R' && value >= 250 && value <= 16383) {
+        // The temperature indicator needs 200 us to settle after the switch
+        TriggerPeriod = value;
+        set_trigger_period(TriggerPeriod);
+    } else if (uart_line[0] == 'M' && value <= 3) {
+        ReportMode = (uint8_t) value;
+    } else if (uart_line[0] == 'F' && value <= 4) {
+        FilterMode = (uint8_t) value;
+        SensorFilterStarted = 0;
+    } else if (uart_line[0] == 'L') {
+        LogEvery = value;
+        LogScans = 0;
+    } else {
+        uart_write(ReplyError, sizeof ReplyError);
+        return;
+    }
+
+    uart_write(ReplyOk, sizeof ReplyOk);
 }
 
 int main(void) {
-    unsigned int AnalogValue; // used to store ADC result after capture
+    config_oscillator(); // Internal oscillator at _XTAL_FREQ
 
     uart_init();
 
-    // Set up oscillator control register
-    OSCCONbits.SPLLEN = 0; // PLL is disabled
-    OSCCONbits.IRCF = 0b1011; // Set OSCCON IRCF bits to select OSC frequency=1Mhz
-    OSCCONbits.SCS = 0x02; // Set the SCS bits to select internal oscillator block
-
-    TRISAbits.TRISA0 = 0; // RA0 = DAC voltage output
-    TRISAbits.TRISA1 = 0; // RA1 = nc
+    TRISAbits.TRISA0 = 0; // RA0 = TX
+    // RA1 = RX, already an input after uart_init()
     TRISAbits.TRISA2 = 1; // RA2 = Analog voltage in
     TRISAbits.TRISA3 = 0; // RA3 = nc (MCLR)
-    TRISAbits.TRISA4 = 0; // RA4 = nc
-    TRISAbits.TRISA5 = 0; // RA5 = nc
+    TRISAbits.TRISA4 = 1; // RA4 = Second analog input
+    TRISAbits.TRISA5 = 0; // RA5 = Dry LED
+    LATAbits.LATA5 = 0;
 
     // Set up ADC
     ANSELAbits.ANSA2 = 1; // Select A2 as analog input pin for analog sensor
+    ANSELAbits.ANSA4 = 1; // and A4 (AN3) for the second input
     // You will need to set the ANSA bits for each pin you want
     // to use as analog inputs
 
-    ADCON0bits.CHS = 0b00010; // This selects which analog input to use for the ADC conversion
-    // for this example we are using A2 as our input
+    // Fixed voltage reference at 1.024 V for the ADC and the temperature indicator
+    // in the high range, which needs Vdd above 3.6 V
+    FVRCONbits.ADFVR = 0b01;
+    FVRCONbits.TSRNG = 1;
+    FVRCONbits.TSEN = 1;
+    FVRCONbits.FVREN = 1;
+    while (!FVRCONbits.FVRRDY); // wait for the reference to settle
+
+    ADCON0bits.CHS = ScanChannels[0]; // This selects which analog input to use for the ADC conversion
+    // the interrupt moves on to the next channel of the scan after every conversion
 
-    ADCON1bits.ADCS = 0x01; // select ADC conversion clock select as Fosc/8
+    ADCON1bits.ADCS = CONFIG_ADCS; // select ADC conversion clock, Fosc/16 = 1 us at 16 MHz
     ADCON1bits.ADFM = 0x01; // results are right justified
 
     ADCON0bits.ADON = 1; // ADC is on
 
-    int DAC_Value; // this could be used to set the DAC output register
+    eeprom_log_init(); // Goes on after the last reading logged before the reset
+
+    // Timer1 on Fosc/4 without prescaler, CCP1 restarts it and starts the ADC
+    T1CONbits.TMR1CS = 0b00;
+    T1CONbits.T1CKPS = 0b00;
+    set_trigger_period(TriggerPeriod);
+    CCP1CONbits.CCP1M = 0b1011; // Compare mode, special event trigger
+    PIR1bits.ADIF = 0;
+    PIE1bits.ADIE = 1;
+    INTCONbits.PEIE = 1;
+    INTCONbits.GIE = 1; // Enable global interrupts, the ADC and the UART run from the interrupt
+    T1CONbits.TMR1ON = 1;
+
+    uint16_t Values[SCAN_COUNT];
     for (;;) {
-        AnalogValue = Read_ADC_Value(); // Read the analog voltage on pin RA1
-        DAC_Value = (AnalogValue >> 5) & 0x1F; // divide ADC value by 32 and mask off lower 5 bits
-
-        // Since this chip is too little to use some of the fancy functions
-        // like sprintf or itoa and ftoa I had to improvise
-        if (AnalogValue > 10 && AnalogValue <= 20) {
-            uart_send("A ");
-        } else if (AnalogValue > 20 && AnalogValue <= 30) {
-            uart_send("B ");
-        } else if (AnalogValue > 30 && AnalogValue <= 40) {
-            uart_send("C ");
-        } else if (AnalogValue > 40 && AnalogValue <= 50) {
-            uart_send("D ");
-        } else if (AnalogValue > 50 && AnalogValue <= 60) {
-            uart_send("E ");
-        } else if (AnalogValue > 60 && AnalogValue <= 70) {
-            uart_send("F ");
-        } else if (AnalogValue > 70 && AnalogValue <= 80) {
-            uart_send("G ");
-        } else if (AnalogValue > 80 && AnalogValue <= 90) {
-            uart_send("H ");
-        } else if (AnalogValue > 90 && AnalogValue <= 100) {
-            uart_send("G ");
-        } else {
-            uart_send("Z ");
-        }
+        if (SnapshotReady) {
+            for (uint8_t i = 0; i < SCAN_COUNT; i++) {
+                Values[i] = Snapshot[i];
+            }
+            uint16_t Tick = SnapshotTick;
+            SnapshotReady = 0; // The interrupt can fill in the next scan now
 
-        // Same idea as above
-        if (DAC_Value > 10 && DAC_Value <= 20) {
-            uart_send("A1 ");
-        } else if (DAC_Value > 20 && DAC_Value <= 30) {
-            uart_send("B1 ");
-        } else if (DAC_Value > 30 && DAC_Value <= 40) {
-            uart_send("C1 ");
-        } else if (DAC_Value > 40 && DAC_Value <= 50) {
-            uart_send("D1 ");
-        } else if (DAC_Value > 50 && DAC_Value <= 60) {
-            uart_send("E1 ");
-        } else if (DAC_Value > 60 && DAC_Value <= 70) {
-            uart_send("F1 ");
-        } else if (DAC_Value > 70 && DAC_Value <= 80) {
-            uart_send("G1 ");
-        } else if (DAC_Value > 80 && DAC_Value <= 90) {
-            uart_send("H1 ");
-        } else if (DAC_Value > 90 && DAC_Value <= 100) {
-            uart_send("G1 ");
-        } else {
-            uart_send("Z1 ");
+            Values[0] = filter_sensor(Values[0]);
+            if (LogEvery != 0 && ++LogScans >= LogEvery && !LogDumping) {
+                LogScans = 0;
+                eeprom_log_add(Values[0]); // Raw 12 bits, the millivolts depend on Vdd
+            }
+            LATAbits.LATA5 = filter_hysteresis(&DryDetector, Values[0], DRY_OFF_BELOW, DRY_ON_ABOVE);
+
+            // Since this chip is too little to use some of the fancy functions
+            // like sprintf or itoa and ftoa the readings go out in binary, or as
+            // text made by ../Format/format.h, which needs no division.
+            // A full frame is queued and the interrupt sends it while we sample.
+            if (ReportMode == 3) {
+                send_text(Values, calibrate(Values));
+            } else if (ReportMode == 1 && calibrate(Values)) {
+                telemetry_send(TELEMETRY_TYPE_VALUES, Tick, Values, SCAN_COUNT);
+            } else if (ReportMode != 0) {
+                telemetry_send(TELEMETRY_TYPE_SAMPLES12, Tick, Values, SCAN_COUNT);
+            }
         }
 
-        // Uncomment if you want to output digital signal based on analog input.
-        // DACCON1bits.DACR = DAC_Value;
-        __delay_ms(100); // wait a little bit
+        if (uart_read_line() != 0) {
+            process_command();
+        }
+        if (LogDumping) {
+            send_log();
+        }
+        NOP(); // Nothing else to do, sampling and sending run from the interrupt
     }
 
     return 0;
@@ -12,16 +12,29 @@
 // The result is when a user press the button an LED blinks.
 // Do not forget to connect a Pull Down resistor for the voltage in PIN.
 // In our example this is RA4
+//
+// The button is not polled. Between presses the PIC sleeps and an edge on RA4
+// wakes it through interrupt-on-change. Timer0 then samples the pin every
+// millisecond and only takes a new level after it stayed the same for 5 samples,
+// so the contact bounce is filtered out and a press shows up after about 5 ms.
+// The state machine in button_tick() reports these events to the main loop
+// through ../Events/events.h:
+//      press       the button went down, the LED on RA2 goes on
+//      release     the button came up, the LED on RA2 goes off
+//      long press  held for 800 ms, the LED on RA5 toggles
+//      repeat      every 200 ms after that while still held, RA5 toggles again
+// Once the button is released and stable the timer stops and the PIC goes back
+// to sleep.
 //**********************************************************************************
 //                                   PIC12F1822 Pinout for this example
 //                                   ----------
 //          3.3V Power source -> Vdd |1      8| GND
-//                               RA5 |2      7| RA0
+//       LED for long presses <- RA5 |2      7| RA0
 // Voltage in from the button -> RA4 |3      6| RA1
 //                               RA3 |4      5| RA2 -> voltage out for the LED
 //                                   ----------
 //**********************************************************************************
-#pragma config FOSC = ECH       // Oscillator Selection (ECH, External Clock, High Power Mode (4-32 MHz): device clock supplied to CLKIN pin)
+#pragma config FOSC = INTOSC    // Oscillator Selection (INTOSC oscillator: I/O function on CLKIN pin)
 #pragma config WDTE = OFF       // Watchdog Timer Enable (WDT disabled)
 #pragma config PWRTE = OFF      // Power-up Timer Enable (PWRT disabled)
 #pragma config MCLRE = OFF       // MCLR Pin Function Select (MCLR/VPP pin function is MCLR)
@@ -43,13 +56,119 @@
 #include <xc.h> // Include standard header file
 
 // Definitions
-#define _XTAL_FREQ  16000000        // This is used by the __delay_ms(xx) and __delay_us(xx) functions
+#define _XTAL_FREQ  1000000        // This is used by the __delay_ms(xx) and __delay_us(xx) functions
+
+#include "../Config/config.h"
+
+#define EVENTS_QUEUE_SIZE 4 // The main loop is rarely more than one event behind
+#include "../Events/events.h"
+
+// Timer0 runs from Fosc/4 = 250 kHz without prescaler, it overflows every 1.024 ms
+#define TICK_US             1024
+#define MS_TO_TICKS(ms)     ((uint16_t) ((ms) * 1000UL / TICK_US))
+
+#define DEBOUNCE_TICKS      5 // Samples in a row with the same level
+#define LONG_PRESS_TICKS    MS_TO_TICKS(800)
+#define REPEAT_TICKS        MS_TO_TICKS(200)
+
+enum {
+    BUTTON_IDLE, // Released, waiting for an edge with the timer off
+    BUTTON_PRESSING, // Went up, waiting for the level to settle
+    BUTTON_HELD,
+    BUTTON_RELEASING // Went down while held, waiting for the level to settle
+};
+
+enum {
+    EVENT_PRESS,
+    EVENT_RELEASE,
+    EVENT_LONG_PRESS,
+    EVENT_REPEAT
+};
+
+static volatile uint8_t ButtonState = BUTTON_IDLE;
+static uint8_t ButtonLevel; // Last sample of RA4
+static uint8_t ButtonStable; // Samples ButtonLevel has not changed, up to DEBOUNCE_TICKS
+static uint16_t HoldCountdown; // Ticks to the next long press or repeat event
+static uint8_t LongPressSent;
+
+// Stops the timer and lets the next edge wake us up. An edge that came in
+// meanwhile left IOCAF4 set and starts another round right away.
+void button_idle(void) {
+    ButtonState = BUTTON_IDLE;
+    INTCONbits.TMR0IE = 0;
+    INTCONbits.IOCIE = 1;
+}
+
+// Runs every Timer0 overflow while the button is not idle
+void button_tick(void) {
+    uint8_t level = PORTAbits.RA4;
+
+    if (level != ButtonLevel) {
+        ButtonLevel = level;
+        ButtonStable = 0; // Still bouncing
+    } else if (ButtonStable < DEBOUNCE_TICKS) {
+        ButtonStable++;
+    }
+
+    switch (ButtonState) {
+        case BUTTON_PRESSING:
+            if (ButtonStable == DEBOUNCE_TICKS) {
+                if (level) {
+                    ButtonState = BUTTON_HELD;
+                    HoldCountdown = LONG_PRESS_TICKS;
+                    LongPressSent = 0;
+                    events_push(EVENT_PRESS, 0);
+                } else {
+                    button_idle(); // Only a glitch
+                }
+            }
+            break;
+
+        case BUTTON_HELD:
+            if (!level) {
+                ButtonState = BUTTON_RELEASING;
+            } else if (--HoldCountdown == 0) {
+                events_push(LongPressSent ? EVENT_REPEAT : EVENT_LONG_PRESS, 0);
+                LongPressSent = 1;
+                HoldCountdown = REPEAT_TICKS;
+            }
+            break;
+
+        case BUTTON_RELEASING:
+            if (ButtonStable == DEBOUNCE_TICKS) {
+                if (level) {
+                    ButtonState = BUTTON_HELD; // Bounced, still held
+                } else {
+                    events_push(EVENT_RELEASE, 0);
+                    button_idle();
+                }
+            }
+            break;
+    }
+}
+
+void __interrupt(high_priority) high_priority_interrupt(void) {
+    if (INTCONbits.IOCIE && INTCONbits.IOCIF) {
+        IOCAFbits.IOCAF4 = 0;
+
+        // The timer takes over until the button is released again
+        INTCONbits.IOCIE = 0;
+        ButtonState = BUTTON_PRESSING;
+        ButtonLevel = PORTAbits.RA4;
+        ButtonStable = 0;
+        TMR0 = 0;
+        INTCONbits.TMR0IF = 0;
+        INTCONbits.TMR0IE = 1;
+    }
+
+    if (INTCONbits.TMR0IE && INTCONbits.TMR0IF) {
+        INTCONbits.TMR0IF = 0;
+        button_tick();
+    }
+}
 
 void main() {
-    // Set up oscillator control register
-    OSCCONbits.SPLLEN = 0; // PLL is disabled
-    OSCCONbits.IRCF = 0x0F; // Set OSCCON IRCF bits to select OSC frequency=16Mhz
-    OSCCONbits.SCS = 0x02; // Set the SCS bits to select internal oscillator block
+    config_oscillator(); // Internal oscillator at _XTAL_FREQ, 1 MHz is plenty for a button
 
     ANSELAbits.ANSA0 = 0; // Set to digital
     ANSELAbits.ANSA1 = 0; // Set to digital
@@ -75,16 +194,43 @@ void main() {
     // Set up ADC
     ADCON0 = 0; // ADC is off
 
+    // Timer0 from Fosc/4, no prescaler
+    OPTION_REGbits.TMR0CS = 0;
+    OPTION_REGbits.PSA = 1;
+
+    // Both edges of RA4 wake us up
+    IOCAPbits.IOCAP4 = 1;
+    IOCANbits.IOCAN4 = 1;
+    IOCAFbits.IOCAF4 = 0;
+    button_idle();
+    INTCONbits.GIE = 1;
+
     for (;;) {
-        __delay_ms(100); // Wait 100 ms
-        if (PORTAbits.RA4 == 0) {
+        event_t event;
 
-            // Set LAT A2 bit to low
-            LATAbits.LATA2 = 0;
-        } else {
+        while (events_pop(&event)) {
+            switch (event.source) {
+                case EVENT_PRESS:
+                    LATAbits.LATA2 = 1; // Set LAT A2 bit to high
+                    break;
+                case EVENT_RELEASE:
+                    LATAbits.LATA2 = 0; // Set LAT A2 bit to low
+                    break;
+                case EVENT_LONG_PRESS:
+                case EVENT_REPEAT:
+                    LATAbits.LATA5 = !LATAbits.LATA5;
+                    break;
+            }
+        }
 
-            // Set LAT A2 bit to high
-            LATAbits.LATA2 = 1;
+        // Check and sleep with interrupts off, or an edge that comes in between
+        // would be handled before SLEEP and leave us sleeping with the timer
+        // needed. The edge still wakes the core, the interrupt runs after GIE.
+        INTCONbits.GIE = 0;
+        if (ButtonState == BUTTON_IDLE && !events_pending()) {
+            SLEEP();
+            NOP(); // The instruction after SLEEP is already fetched
         }
+        INTCONbits.GIE = 1;
     }
 }
\ No newline at end of file
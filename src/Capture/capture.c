@@ -0,0 +1,202 @@
+//**********************************************************************************
+// Example program showing frequency and pulse width measurement on a PIC12F1822
+//
+// Device: PIC12F1822
+// Demo Board: PICkit 4
+// Compiler: Microchip XC8 v2.32
+// IDE: MPLAB X v5.45
+//
+// ../Interrupt/interrupt.c reacts to an edge on RA2, but only knows that it came.
+// This program times the edges with CCP1 and Timer1 through capture.h, to one
+// instruction cycle of 125 ns, for tachometers, flow meters and the like.
+// Connect the signal to RA2 and RA3, RA3 is the Timer1 gate input here.
+// Commands from PuTTY at 115200 baud, each followed by Enter:
+//      F<n>    frequency and period over n periods, 1-65535, "<frequency in
+//              mHz> <average period in cycles>". The default, with n = 1.
+//      W<n>    duty cycle and pulse width over n periods, "<frequency in mHz>
+//              <duty cycle in 0.01 %> <average high time in cycles>"
+//      H       one high pulse through the Timer1 gate, "<cycles>"
+//      P       one period through the Timer1 gate, "<cycles>"
+// F and W measure all the time and send the newest result about every 100 ms.
+// H and P wait for the pulse, send one line and go back to F or W. A frequency
+// of 0 means no rising edge came for 2 seconds, with F and n a multiple of 4 or
+// 16 no fourth or sixteenth one for 8 or 32 seconds.
+// A cycle is 1/8 us at 32 MHz, so 8000 cycles are a period of 1 ms.
+//**********************************************************************************
+//                                   PIC12F1822 Pinout for this example
+//                                   ----------
+//            5V Power source -> Vdd |1      8| GND
+//                               RA5 |2      7| RA0 -> TX
+//                               RA4 |3      6| RA1 <- RX
+//          Signal to measure -> RA3 |4      5| RA2 <- Signal to measure
+//                                   ----------
+//**********************************************************************************
+
+#include <xc.h>
+
+#pragma config FOSC = INTOSC    // Oscillator Selection (INTOSC oscillator: I/O function on CLKIN pin)
+#pragma config WDTE = OFF       // Watchdog Timer Enable (WDT disabled)
+#pragma config PWRTE = OFF      // Power-up Timer Enable (PWRT disabled)
+#pragma config MCLRE = OFF      // MCLR Pin Function Select (MCLR/VPP pin function is digital input)
+#pragma config CP = OFF         // Flash Program Memory Code Protection (Program memory code protection is disabled)
+#pragma config CPD = OFF        // Data Memory Code Protection (Data memory code protection is disabled)
+#pragma config BOREN = OFF      // Brown-out Reset Enable (Brown-out Reset disabled)
+#pragma config CLKOUTEN = OFF   // Clock Out Enable (CLKOUT function is disabled. I/O or oscillator function on the CLKOUT pin)
+#pragma config IESO = OFF       // Internal/External Switchover (Internal/External Switchover mode is disabled)
+#pragma config FCMEN = OFF      // Fail-Safe Clock Monitor Enable (Fail-Safe Clock Monitor is disabled)
+
+// CONFIG2
+#pragma config WRT = OFF        // Flash Memory Self-Write Protection (Write protection off)
+#pragma config PLLEN = OFF      // PLL Enable (4x PLL disabled)
+#pragma config STVREN = ON      // Stack Overflow/Underflow Reset Enable (Stack Overflow or Underflow will cause a Reset)
+#pragma config BORV = LO        // Brown-out Reset Voltage Selection (Brown-out Reset Voltage (Vbor), low trip point selected.)
+#pragma config LVP = ON         // Low-Voltage Programming Enable (Low-voltage programming enabled)
+
+#include <xc.h> // Include standard header file
+#include <stdint.h>
+
+// Definitions
+#define _XTAL_FREQ  32000000 // This is used by the __delay_ms(xx) and __delay_us(xx) functions
+
+#define CONFIG_BAUD 115200
+#include "../Config/config.h"
+#include "../UART/uart.h"
+#include "../Format/format.h"
+#include "capture.h"
+
+#define REPORT_OVERFLOWS 12 // Of Timer1, about 100 ms at 32 MHz
+
+static capture_result_t Result;
+static uint8_t Mode = CAPTURE_PERIOD; // F or W, what H and P go back to
+static uint16_t Edges = 1;
+static volatile uint8_t ReportOverflows;
+static volatile uint8_t ReportDue;
+
+static uint32_t Line[3]; // Numbers of the line send_line() is sending
+static uint8_t LineCount;
+static uint8_t LineSent;
+
+static const char ReplyOk[] = "OK\r\n";
+static const char ReplyError[] = "ERR\r\n";
+
+void __interrupt(high_priority) high_priority_interrupt(void) {
+    // The Timer1 overflows that extend the captures also pace the reports
+    if (PIE1bits.TMR1IE && PIR1bits.TMR1IF && ++ReportOverflows == REPORT_OVERFLOWS) {
+        ReportOverflows = 0;
+        ReportDue = 1;
+    }
+    capture_isr();
+    uart_isr(); // Move bytes between the EUSART and the ring buffers
+}
+
+// Sends the numbers in Line one at a time as the transmit buffer makes room, a
+// whole line does not fit in it
+void send_line(void) {
+    char Number[FORMAT_U32_SIZE];
+    uint8_t length;
+
+    if (LineCount == 0 || uart_tx_free() < FORMAT_U32_SIZE + 1) {
+        return;
+    }
+    length = format_u32(Number, Line[LineSent]);
+    uart_write(Number, length);
+    if (++LineSent < LineCount) {
+        uart_write(" ", 1);
+    } else {
+        uart_write("\r\n", 2);
+        LineCount = 0;
+    }
+}
+
+// Works out the numbers of the result in Result for send_line()
+void report_result(void) {
+    uint32_t average = 0;
+
+    switch (capture_mode) {
+        case CAPTURE_PERIOD:
+            if (Result.periods != 0) {
+                average = capture_muldiv(Result.period, 1, Result.periods);
+            }
+            Line[0] = capture_frequency(&Result);
+            Line[1] = average;
+            LineCount = 2;
+            break;
+        case CAPTURE_PULSE:
+            if (Result.periods != 0) {
+                average = capture_muldiv(Result.high, 1, Result.periods);
+            }
+            Line[0] = capture_frequency(&Result);
+            Line[1] = capture_duty(&Result);
+            Line[2] = average;
+            LineCount = 3;
+            break;
+        default:
+            // One pulse or period through the gate, then back to measuring
+            Line[0] = capture_mode == CAPTURE_GATE_PULSE ? Result.high : Result.period;
+            LineCount = 1;
+            capture_start_mode(Mode, Edges);
+            break;
+    }
+    LineSent = 0;
+}
+
+// Runs the command line that uart_read_line() just completed
+void process_command(void) {
+    uint16_t value = 0;
+    uint8_t ok = uart_parse_number(&uart_line[1], &value) && value != 0;
+
+    switch (uart_line[0]) {
+        case 'F':
+        case 'W':
+            if (ok) {
+                Mode = uart_line[0] == 'F' ? CAPTURE_PERIOD : CAPTURE_PULSE;
+                Edges = value;
+                capture_start_mode(Mode, Edges);
+            }
+            break;
+        case 'H':
+        case 'P':
+            ok = uart_line[1] == '\0';
+            if (ok) {
+                capture_start_mode(uart_line[0] == 'H' ? CAPTURE_GATE_PULSE : CAPTURE_GATE_PERIOD, 1);
+            }
+            break;
+        default:
+            ok = 0;
+            break;
+    }
+
+    if (ok) {
+        uart_write(ReplyOk, sizeof ReplyOk - 1);
+    } else {
+        uart_write(ReplyError, sizeof ReplyError - 1);
+    }
+}
+
+void main(void) {
+    config_oscillator(); // 8 MHz Internal Oscillator through the PLL gives 32 MHz
+
+    uart_init();
+
+    // Timer1 gate on RA3, a digital input only pin with MCLRE = OFF
+    APFCONbits.T1GSEL = 1;
+    TRISAbits.TRISA3 = 1;
+
+    capture_init(); // CCP1 on RA2
+    INTCONbits.PEIE = 1;
+    INTCONbits.GIE = 1;
+
+    for (;;) {
+        if (uart_read_line() != 0) {
+            process_command();
+        }
+        // The gate modes send their one result right away, the others the
+        // newest one every 100 ms
+        if (LineCount == 0 && (ReportDue || capture_mode >= CAPTURE_GATE_PULSE) && capture_read(&Result)) {
+            ReportDue = 0;
+            report_result();
+        }
+        send_line();
+        NOP(); // Nothing else to do, CCP1 and the interrupt take the times
+    }
+}
@@ -0,0 +1,322 @@
+//**********************************************************************************
+// Period, frequency, duty cycle and pulse width measurement on the PIC12F1822
+//
+// Device: PIC12F1822
+// Compiler: Microchip XC8 v2.32
+//
+// Timer1 counts instruction cycles, Fosc / 4, and CCP1 in capture mode copies
+// TMR1 into CCPR1 the moment an edge arrives on RA2. The time of the edge is
+// then known to one instruction cycle (125 ns at 32 MHz), however late the
+// interrupt routine gets to it. Counting edges in software over a gate time only
+// knows how many there were, to one edge. The Timer1 interrupt counts the
+// overflows, which turns the 16 bit captures into 32 bit times, so a period can
+// be up to 2^32 cycles long. Timer1 runs on and is never reset, so one
+// measurement starts on the edge the last one ended on and no edge is lost.
+//
+//      CAPTURE_PERIOD      from one rising edge to the one N periods later. The
+//                          result is good to one cycle in the sum of the N
+//                          periods: at 1 kHz and 32 MHz 1 in 8000 for N = 1 and
+//                          1 in 800000 for N = 100. With N a multiple of 4 or 16
+//                          the CCP1 prescaler only captures every 4th or 16th
+//                          rising edge, which leaves the core free on fast inputs.
+//                          The timeout below grows by the same factor, so a slow
+//                          input still gets to its next capture.
+//      CAPTURE_PULSE       every rising and falling edge, CCP1 switches from one
+//                          to the other, for the high time and the period added
+//                          up over N periods. Both times must be longer than the
+//                          interrupt routine takes, a period that misses an edge
+//                          is thrown away.
+//      CAPTURE_GATE_PULSE  one high pulse on the T1G pin through the Timer1 gate
+//                          in single pulse mode. Timer1 only counts while the pin
+//                          is high and stops on the falling edge by itself, so a
+//                          pulse of a few cycles is measured as well as a long
+//                          one. Timer1 stands still while it waits.
+//      CAPTURE_GATE_PERIOD the same with the gate in toggle mode, one whole
+//                          period from a rising edge to the next.
+//
+// The results are sums in cycles, nothing is lost to rounding until
+// capture_frequency() or capture_duty() divides them. An input that stops, a
+// flow meter without flow, gives a result of 0 periods after CAPTURE_TIMEOUT_MS
+// without a rising edge, 4 or 16 times that without a capture when the prescaler
+// skips edges.
+//
+// The sample must define _XTAL_FREQ, call capture_isr() from its interrupt
+// routine and set INTCONbits.PEIE and INTCONbits.GIE after capture_init(). Timer1
+// and CCP1 belong to the capture. The input goes to RA2 (CCP1SEL = 0) and, for the
+// gate modes, to the T1G pin, RA4 or RA3 with APFCONbits.T1GSEL.
+//**********************************************************************************
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <xc.h>
+#include <stdint.h>
+
+#define CAPTURE_FCY     (_XTAL_FREQ / 4) // Cycles per second, the unit of the results
+
+// Time without a rising edge after which the input counts as stopped
+#ifndef CAPTURE_TIMEOUT_MS
+#define CAPTURE_TIMEOUT_MS 2000
+#endif
+
+#define CAPTURE_TIMEOUT_OVERFLOWS (CAPTURE_TIMEOUT_MS * (CAPTURE_FCY / 1000UL) / 65536UL + 1)
+
+// The 32 bit times wrap after 2^32 cycles, the longest timeout, with the 1:16
+// prescaler, must be shorter than that
+#if CAPTURE_TIMEOUT_OVERFLOWS * 16 > 65535
+#error "16 x CAPTURE_TIMEOUT_MS is longer than the 32 bit times reach at this clock"
+#endif
+
+// CCP1M capture modes
+#define CAPTURE_FALLING     0b0100
+#define CAPTURE_RISING      0b0101
+#define CAPTURE_RISING_4    0b0110
+#define CAPTURE_RISING_16   0b0111
+
+enum {
+    CAPTURE_PERIOD,
+    CAPTURE_PULSE,
+    CAPTURE_GATE_PULSE,
+    CAPTURE_GATE_PERIOD
+};
+
+typedef struct {
+    uint32_t period; // Cycles of all the periods together, 0 for CAPTURE_GATE_PULSE
+    uint32_t high; // Cycles of those the input was high, CAPTURE_PULSE and CAPTURE_GATE_PULSE
+    uint16_t periods; // 0 when the input stopped
+} capture_result_t;
+
+static volatile uint16_t capture_overflows; // Upper 16 bits of the time
+static uint8_t capture_mode;
+static uint16_t capture_edges; // N
+static uint8_t capture_step; // Rising edges per capture, the CCP1 prescaler
+static uint8_t capture_started; // The first rising edge of a measurement came
+static uint16_t capture_count; // Periods of the measurement so far
+static uint32_t capture_start; // Time of the first rising edge
+static uint32_t capture_rise; // Time of the last rising edge
+static uint32_t capture_high;
+static uint16_t capture_idle; // Overflows since the last capture
+static uint16_t capture_timeout; // Overflows until the input counts as stopped
+static capture_result_t capture_result;
+static volatile uint8_t capture_ready;
+
+// Starts a new measurement and throws away the one in progress. edges is N for
+// CAPTURE_PERIOD and CAPTURE_PULSE, 1-65535, the gate modes measure one.
+static inline void capture_start_mode(uint8_t mode, uint16_t edges) {
+    uint8_t ccp = CAPTURE_RISING;
+
+    PIE1bits.CCP1IE = 0;
+    PIE1bits.TMR1IE = 0;
+    PIE1bits.TMR1GIE = 0;
+    CCP1CON = 0; // Also clears the prescaler, which a change of mode does not
+    T1CONbits.TMR1ON = 0;
+    T1GCON = 0;
+
+    capture_mode = mode;
+    capture_edges = edges;
+    capture_step = 1;
+    capture_started = 0;
+    capture_idle = 0;
+    capture_ready = 0;
+
+    if (mode == CAPTURE_GATE_PULSE || mode == CAPTURE_GATE_PERIOD) {
+        // Counts from 0 while the gate is open, active high, single pulse
+        TMR1 = 0;
+        capture_overflows = 0;
+        T1GCONbits.TMR1GE = 1;
+        T1GCONbits.T1GPOL = 1;
+        T1GCONbits.T1GTM = mode == CAPTURE_GATE_PERIOD;
+        T1GCONbits.T1GSPM = 1;
+        T1GCONbits.T1GGO = 1; // Waits for the next rising edge
+        PIR1bits.TMR1GIF = 0;
+        PIE1bits.TMR1GIE = 1;
+    } else {
+        if (mode == CAPTURE_PERIOD && (edges & 0x0F) == 0) {
+            ccp = CAPTURE_RISING_16;
+            capture_step = 16;
+        } else if (mode == CAPTURE_PERIOD && (edges & 0x03) == 0) {
+            ccp = CAPTURE_RISING_4;
+            capture_step = 4;
+        }
+        capture_timeout = CAPTURE_TIMEOUT_OVERFLOWS * capture_step;
+        CCP1CONbits.CCP1M = ccp;
+        PIR1bits.CCP1IF = 0;
+        PIE1bits.CCP1IE = 1;
+    }
+
+    PIR1bits.TMR1IF = 0;
+    PIE1bits.TMR1IE = 1;
+    T1CONbits.TMR1ON = 1;
+}
+
+// Timer1 on Fosc / 4 without prescaler, CAPTURE_PERIOD of 1 period
+static inline void capture_init(void) {
+    TRISAbits.TRISA2 = 1;
+    ANSELAbits.ANSA2 = 0;
+    APFCONbits.CCP1SEL = 0; // CCP1 on RA2
+    T1CONbits.TMR1CS = 0b00;
+    T1CONbits.T1CKPS = 0b00;
+    T1CONbits.T1OSCEN = 0;
+    capture_start_mode(CAPTURE_PERIOD, 1);
+}
+
+// Copies the newest result and returns 1 when there is one since the last call
+static inline uint8_t capture_read(capture_result_t *result) {
+    uint8_t gie = INTCONbits.GIE;
+    uint8_t ready;
+
+    INTCONbits.GIE = 0; // Not half of an old and half of a new result
+    ready = capture_ready;
+    if (ready) {
+        *result = capture_result;
+        capture_ready = 0;
+    }
+    INTCONbits.GIE = gie;
+    return ready;
+}
+
+// a x b / divisor rounded to the nearest, for a result that fits in 32 bits. The
+// product has up to 64 bits, so it is built and divided one bit at a time by
+// shifting, adding and subtracting, like dds_tuning_word(). A few thousand
+// cycles, call it from the main loop.
+static inline uint32_t capture_muldiv(uint32_t a, uint32_t b, uint32_t divisor) {
+    uint32_t high = 0;
+    uint32_t low = 0;
+    uint32_t quotient = 0;
+
+    for (uint8_t bit = 0; bit < 32; bit++) {
+        high = (high << 1) | (low >> 31);
+        low <<= 1;
+        if (b & 0x80000000UL) {
+            low += a;
+            if (low < a) {
+                high++; // Carry
+            }
+        }
+        b <<= 1;
+    }
+
+    if (divisor == 0 || high >= divisor) {
+        return 0xFFFFFFFFUL; // Does not fit
+    }
+    for (uint8_t bit = 0; bit < 32; bit++) {
+        uint8_t carry = (uint8_t) (high >> 31);
+
+        high = (high << 1) | (low >> 31);
+        low <<= 1;
+        quotient <<= 1;
+        if (carry || high >= divisor) {
+            high -= divisor;
+            quotient |= 1;
+        }
+    }
+    if (high >= divisor - high && quotient != 0xFFFFFFFFUL) {
+        quotient++;
+    }
+    return quotient;
+}
+
+// In thousandths of a hertz, 0 when the input stopped
+static inline uint32_t capture_frequency(const capture_result_t *result) {
+    if (result->periods == 0 || result->period == 0) {
+        return 0;
+    }
+    return capture_muldiv(CAPTURE_FCY, (uint32_t) result->periods * 1000, result->period);
+}
+
+// In hundredths of a percent of the time the input was high, 0-10000
+static inline uint16_t capture_duty(const capture_result_t *result) {
+    if (result->period == 0) {
+        return 0;
+    }
+    return (uint16_t) capture_muldiv(result->high, 10000, result->period);
+}
+
+// The rest of the interrupt routine, one edge at a given time
+static inline void capture_edge(uint32_t time) {
+    if (capture_mode == CAPTURE_PULSE) {
+        uint8_t falling = CCP1CONbits.CCP1M == CAPTURE_FALLING;
+
+        // A change of mode can capture by mistake, so CCP1 is off in between
+        // and the flag is cleared after
+        CCP1CON = 0;
+        CCP1CONbits.CCP1M = falling ? CAPTURE_RISING : CAPTURE_FALLING;
+        PIR1bits.CCP1IF = 0;
+
+        // The next edge came before CCP1 was ready for it, the period is lost
+        if (PORTAbits.RA2 == falling) {
+            CCP1CONbits.CCP1M = CAPTURE_RISING;
+            PIR1bits.CCP1IF = 0;
+            capture_started = 0;
+            return;
+        }
+        if (falling) {
+            if (capture_started) {
+                capture_high += time - capture_rise;
+            }
+            return;
+        }
+    }
+
+    capture_idle = 0;
+    if (!capture_started) {
+        capture_started = 1;
+        capture_count = 0;
+        capture_high = 0;
+        capture_start = time;
+    } else {
+        capture_count += capture_step;
+        if (capture_count >= capture_edges) {
+            capture_result.period = time - capture_start;
+            capture_result.high = capture_high;
+            capture_result.periods = capture_count;
+            capture_ready = 1;
+            capture_count = 0;
+            capture_high = 0;
+            capture_start = time; // The next measurement starts on this edge
+        }
+    }
+    capture_rise = time;
+}
+
+// Call this from the interrupt routine
+static inline void capture_isr(void) {
+    if (PIE1bits.CCP1IE && PIR1bits.CCP1IF) {
+        uint16_t low = CCPR1;
+        uint16_t high = capture_overflows;
+
+        // An overflow that is pending and not counted yet came before the edge
+        // when the capture is small, after it when the capture is close to 65535
+        if (PIR1bits.TMR1IF && !(low & 0x8000)) {
+            high++;
+        }
+        PIR1bits.CCP1IF = 0;
+        capture_edge(((uint32_t) high << 16) | low);
+    }
+
+    if (PIE1bits.TMR1IE && PIR1bits.TMR1IF) {
+        PIR1bits.TMR1IF = 0;
+        capture_overflows++;
+        if (capture_mode <= CAPTURE_PULSE && ++capture_idle == capture_timeout) {
+            capture_result.period = 0;
+            capture_result.high = 0;
+            capture_result.periods = 0;
+            capture_ready = 1;
+            capture_started = 0;
+        }
+    }
+
+    // The gate closed, after the overflows it counted
+    if (PIE1bits.TMR1GIE && PIR1bits.TMR1GIF) {
+        uint32_t count = ((uint32_t) capture_overflows << 16) | TMR1;
+
+        PIR1bits.TMR1GIF = 0;
+        PIE1bits.TMR1GIE = 0;
+        capture_result.period = capture_mode == CAPTURE_GATE_PERIOD ? count : 0;
+        capture_result.high = capture_mode == CAPTURE_GATE_PULSE ? count : 0;
+        capture_result.periods = 1;
+        capture_ready = 1;
+    }
+}
+
+#endif
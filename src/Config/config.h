@@ -0,0 +1,173 @@
+//**********************************************************************************
+// Compile-time clock configuration for the PIC12F1822
+//
+// Device: PIC12F1822
+// Compiler: Microchip XC8 v2.32
+//
+// Every register that depends on the clock is worked out here from _XTAL_FREQ,
+// so a sample changes its clock in one place and the build fails instead of the
+// serial port or the ADC quietly running out of spec:
+//
+//      CONFIG_OSCCON   internal oscillator, and the 4x PLL for 32 MHz
+//      UART_SPBRG      baud rate generator for CONFIG_BAUD, see ../UART/uart.h
+//      PWM_PR2         Timer2 period and prescaler for CONFIG_PWM_HZ, see
+//      PWM_T2CKPS      ../PWM/pwm.h
+//      CONFIG_ADCS     ADC conversion clock with a TAD of 1 to 9 us
+//
+// The sample defines _XTAL_FREQ and, when it uses them, CONFIG_BAUD,
+// CONFIG_PWM_HZ and CONFIG_ADC or CONFIG_ADC_FRC before it includes this file,
+// then this file before uart.h and pwm.h. It sets #pragma config FOSC = INTOSC
+// and calls config_oscillator() first thing in main().
+//
+// The baud rate comes out exactly only when Fosc / 4 is a multiple of it. The
+// build fails when the error is bigger than CONFIG_BAUD_TOLERANCE, 2% by default:
+// the receiver samples the middle of each bit, and both ends of the line together
+// may be off by about 4% over the 10 bits of a byte.
+//**********************************************************************************
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <xc.h>
+#include <stdint.h>
+
+#ifndef _XTAL_FREQ
+#error "Define _XTAL_FREQ before including config.h"
+#endif
+
+// IRCF bits of OSCCON for the frequencies of the internal oscillator. 500 kHz and
+// below run from the medium frequency oscillator, which draws less current.
+#if _XTAL_FREQ == 32000000
+#define CONFIG_IRCF     0b1110 // 8 MHz through the PLL
+#define CONFIG_SPLLEN   1
+#elif _XTAL_FREQ == 16000000
+#define CONFIG_IRCF     0b1111
+#elif _XTAL_FREQ == 8000000
+#define CONFIG_IRCF     0b1110
+#elif _XTAL_FREQ == 4000000
+#define CONFIG_IRCF     0b1101
+#elif _XTAL_FREQ == 2000000
+#define CONFIG_IRCF     0b1100
+#elif _XTAL_FREQ == 1000000
+#define CONFIG_IRCF     0b1011
+#elif _XTAL_FREQ == 500000
+#define CONFIG_IRCF     0b0111
+#elif _XTAL_FREQ == 250000
+#define CONFIG_IRCF     0b0110
+#elif _XTAL_FREQ == 125000
+#define CONFIG_IRCF     0b0101
+#elif _XTAL_FREQ == 31250
+#define CONFIG_IRCF     0b0010
+#else
+#error "_XTAL_FREQ must be 32, 16, 8, 4, 2 or 1 MHz, or 500, 250, 125 or 31.25 kHz"
+#endif
+
+#ifndef CONFIG_SPLLEN
+#define CONFIG_SPLLEN   0
+#endif
+
+// SCS = 00 takes the clock selected by FOSC = INTOSC, the only setting that goes
+// through the PLL
+#define CONFIG_OSCCON   ((CONFIG_SPLLEN << 7) | (CONFIG_IRCF << 3))
+
+static inline void config_oscillator(void) {
+    OSCCON = CONFIG_OSCCON;
+#if CONFIG_SPLLEN
+    while (!OSCSTATbits.PLLR) {
+        // The PLL takes about 2 ms to lock
+    }
+#endif
+}
+
+// EUSART with BRG16 = 1 and BRGH = 1, the finest of its dividers:
+// baud = Fosc / (4 x (SPBRG + 1))
+#ifdef CONFIG_BAUD
+
+// Baud rate error in tenths of a percent
+#ifndef CONFIG_BAUD_TOLERANCE
+#define CONFIG_BAUD_TOLERANCE 20
+#endif
+
+#define CONFIG_SPBRG        ((_XTAL_FREQ + 2UL * CONFIG_BAUD) / (4UL * CONFIG_BAUD) - 1)
+#define CONFIG_BAUD_ACTUAL  (_XTAL_FREQ / (4UL * (CONFIG_SPBRG + 1)))
+
+#if (_XTAL_FREQ + 2UL * CONFIG_BAUD) / (4UL * CONFIG_BAUD) < 1 || CONFIG_SPBRG > 65535
+#error "CONFIG_BAUD is out of reach of the baud rate generator at this clock"
+#endif
+
+#if CONFIG_BAUD_ACTUAL > CONFIG_BAUD
+#define CONFIG_BAUD_ERROR   ((CONFIG_BAUD_ACTUAL - CONFIG_BAUD) * 1000 / CONFIG_BAUD)
+#else
+#define CONFIG_BAUD_ERROR   ((CONFIG_BAUD - CONFIG_BAUD_ACTUAL) * 1000 / CONFIG_BAUD)
+#endif
+
+#if CONFIG_BAUD_ERROR > CONFIG_BAUD_TOLERANCE
+#error "The baud rate error is bigger than CONFIG_BAUD_TOLERANCE at this clock"
+#endif
+
+#ifdef UART_SPBRG
+#error "Define CONFIG_BAUD or UART_SPBRG, not both"
+#endif
+#define UART_SPBRG CONFIG_SPBRG
+
+#endif
+
+// Timer2 counts Fosc / 4 through a 1, 4, 16 or 64 prescaler from 0 to PR2. The
+// smallest prescaler that fits gives the most steps of duty cycle.
+#ifdef CONFIG_PWM_HZ
+
+#define CONFIG_PWM_COUNTS   ((_XTAL_FREQ / 4 + CONFIG_PWM_HZ / 2) / CONFIG_PWM_HZ)
+
+#if CONFIG_PWM_COUNTS < 2
+#error "CONFIG_PWM_HZ is too high for this clock"
+#elif CONFIG_PWM_COUNTS <= 256
+#define PWM_T2CKPS  0b00
+#define PWM_PR2     (CONFIG_PWM_COUNTS - 1)
+#elif CONFIG_PWM_COUNTS <= 1024
+#define PWM_T2CKPS  0b01
+#define PWM_PR2     ((CONFIG_PWM_COUNTS + 2) / 4 - 1)
+#elif CONFIG_PWM_COUNTS <= 4096
+#define PWM_T2CKPS  0b10
+#define PWM_PR2     ((CONFIG_PWM_COUNTS + 8) / 16 - 1)
+#elif CONFIG_PWM_COUNTS <= 16384
+#define PWM_T2CKPS  0b11
+#define PWM_PR2     ((CONFIG_PWM_COUNTS + 32) / 64 - 1)
+#else
+#error "CONFIG_PWM_HZ is too low for this clock"
+#endif
+
+#endif
+
+// The ADC needs a TAD between 1 and 9 us. With CONFIG_ADC it runs from the
+// smallest Fosc divider that makes it at least 1 us, the fastest conversion at
+// 11.5 TAD. CONFIG_ADC_FRC selects the dedicated RC oscillator instead, the only
+// clock that keeps running in SLEEP.
+#if defined CONFIG_ADC_FRC
+#define CONFIG_ADCS     0b111
+#define CONFIG_TAD_NS   1600 // Typical, 1 to 6 us
+#elif defined CONFIG_ADC
+#if _XTAL_FREQ <= 2000000
+#define CONFIG_ADCS     0b000 // Fosc / 2
+#define CONFIG_ADC_DIV  2
+#elif _XTAL_FREQ <= 4000000
+#define CONFIG_ADCS     0b100 // Fosc / 4
+#define CONFIG_ADC_DIV  4
+#elif _XTAL_FREQ <= 8000000
+#define CONFIG_ADCS     0b001 // Fosc / 8
+#define CONFIG_ADC_DIV  8
+#elif _XTAL_FREQ <= 16000000
+#define CONFIG_ADCS     0b101 // Fosc / 16
+#define CONFIG_ADC_DIV  16
+#else
+#define CONFIG_ADCS     0b010 // Fosc / 32
+#define CONFIG_ADC_DIV  32
+#endif
+
+#define CONFIG_TAD_NS   (CONFIG_ADC_DIV * 1000000UL / (_XTAL_FREQ / 1000))
+
+#if CONFIG_TAD_NS > 9000
+#error "The ADC clock is too slow at this clock, define CONFIG_ADC_FRC"
+#endif
+#endif
+
+#endif
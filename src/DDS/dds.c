@@ -0,0 +1,150 @@
+//**********************************************************************************
+// Example program showing a waveform generator on a PIC12F1822
+//
+// Device: PIC12F1822
+// Demo Board: PICkit 4
+// Compiler: Microchip XC8 v2.32
+// IDE: MPLAB X v5.45
+//
+// This program turns the PWM output into a tone generator with ../DDS/dds.h. The
+// PWM runs at 31.25 kHz and every period gets the next sample of the waveform, so
+// after an RC low pass (1 kOhm and 100 nF) on RA2 a small amplifier or speaker
+// plays the tone. It starts with a 440 Hz sine.
+// Commands from PuTTY at 115200 baud, each followed by Enter:
+//      F<hz>       frequency, with up to two decimals: F440 or F261.63
+//      W<n>        waveform: 0 sine, 1 triangle, 2 sawtooth, 3 organ
+//      S<s>        soft start, ramps the duty cycle from 0 to full in s seconds
+//                  (1-60) and stays there
+//**********************************************************************************
+//                                   PIC12F1822 Pinout for this example
+//                                   ----------
+//          3.3V Power source -> Vdd |1      8| GND
+//                               RA5 |2      7| RA0 -> TX
+//                               RA4 |3      6| RA1 -> RX
+//                               RA3 |4      5| RA2 -> PWM output to the RC filter
+//                                   ----------
+//**********************************************************************************
+
+#include <xc.h>
+
+#pragma config FOSC = INTOSC    // Oscillator Selection (INTOSC oscillator: I/O function on CLKIN pin)
+#pragma config WDTE = OFF       // Watchdog Timer Enable (WDT disabled)
+#pragma config PWRTE = OFF      // Power-up Timer Enable (PWRT disabled)
+#pragma config MCLRE = OFF      // MCLR Pin Function Select (MCLR/VPP pin function is digital input)
+#pragma config CP = OFF         // Flash Program Memory Code Protection (Program memory code protection is disabled)
+#pragma config CPD = OFF        // Data Memory Code Protection (Data memory code protection is disabled)
+#pragma config BOREN = OFF      // Brown-out Reset Enable (Brown-out Reset disabled)
+#pragma config CLKOUTEN = OFF   // Clock Out Enable (CLKOUT function is disabled. I/O or oscillator function on the CLKOUT pin)
+#pragma config IESO = OFF       // Internal/External Switchover (Internal/External Switchover mode is disabled)
+#pragma config FCMEN = OFF      // Fail-Safe Clock Monitor Enable (Fail-Safe Clock Monitor is disabled)
+
+// CONFIG2
+#pragma config WRT = OFF        // Flash Memory Self-Write Protection (Write protection off)
+#pragma config PLLEN = OFF      // PLL Enable (4x PLL disabled)
+#pragma config STVREN = ON      // Stack Overflow/Underflow Reset Enable (Stack Overflow or Underflow will cause a Reset)
+#pragma config BORV = LO        // Brown-out Reset Voltage Selection (Brown-out Reset Voltage (Vbor), low trip point selected.)
+#pragma config LVP = ON         // Low-Voltage Programming Enable (Low-voltage programming enabled)
+
+#include <xc.h> // Include standard header file
+#include <stdint.h>
+
+// Definitions
+#define _XTAL_FREQ  32000000 // This is used by the __delay_ms(xx) and __delay_us(xx) functions
+
+#define CONFIG_BAUD 115200
+#include "../Config/config.h"
+#include "../UART/uart.h"
+#include "dds.h"
+
+static const char ReplyOk[] = "OK\r\n";
+static const char ReplyError[] = "ERR\r\n";
+
+void __interrupt(high_priority) high_priority_interrupt(void) {
+    dds_isr(); // First, the next sample is due every 256 cycles
+    uart_isr(); // Move bytes between the EUSART and the ring buffers
+}
+
+// Parses "<hz>" or "<hz>.<d>" or "<hz>.<dd>" into hundredths of a hertz
+uint8_t parse_centihertz(char *text, uint32_t *centihertz) {
+    uint16_t hertz;
+    uint16_t fraction = 0;
+    char *point = text;
+
+    while (*point != '\0' && *point != '.') {
+        point++;
+    }
+    if (*point == '.') {
+        *point = '\0';
+        uint8_t digits = 0;
+        while (point[1 + digits] != '\0') {
+            digits++;
+        }
+        if (digits == 0 || digits > 2 || !uart_parse_number(point + 1, &fraction)) {
+            return 0;
+        }
+        if (digits == 1) {
+            fraction *= 10;
+        }
+    }
+    if (!uart_parse_number(text, &hertz)) {
+        return 0;
+    }
+
+    *centihertz = (uint32_t) hertz * 100 + fraction;
+    return 1;
+}
+
+// Runs the command line that uart_read_line() just completed
+void process_command(void) {
+    uint32_t centihertz;
+    uint16_t value;
+    uint8_t ok = 0;
+
+    switch (uart_line[0]) {
+        case 'F':
+            ok = parse_centihertz(&uart_line[1], &centihertz) && dds_set_frequency(centihertz);
+            break;
+        case 'W':
+            if (uart_parse_number(&uart_line[1], &value) && value <= DDS_TABLE) {
+                dds_set_wave((uint8_t) value, dds_organ); // The table is only used for 3
+                ok = 1;
+            }
+            break;
+        case 'S':
+            // One period of a sawtooth lasting value seconds
+            if (uart_parse_number(&uart_line[1], &value) && value >= 1 && value <= 60) {
+                dds_set_wave(DDS_SAWTOOTH, 0);
+                ok = dds_play_once_seconds((uint8_t) value);
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (ok) {
+        uart_write(ReplyOk, sizeof ReplyOk - 1);
+    } else {
+        uart_write(ReplyError, sizeof ReplyError - 1);
+    }
+}
+
+void main(void) {
+    config_oscillator(); // 8 MHz Internal Oscillator through the PLL gives 32 MHz
+
+    uart_init();
+
+    TRISAbits.TRISA2 = 0; // RA2 = PWM output
+    APFCONbits.CCP1SEL = 0; // P1A on RA2
+
+    dds_init();
+    dds_set_frequency(44000);
+    INTCONbits.PEIE = 1;
+    INTCONbits.GIE = 1;
+
+    for (;;) {
+        if (uart_read_line() != 0) {
+            process_command();
+        }
+        NOP(); // Nothing else to do, the interrupt makes the waveform
+    }
+}
@@ -0,0 +1,210 @@
+//**********************************************************************************
+// Direct digital synthesis on the CCP1 PWM of the PIC12F1822
+//
+// Device: PIC12F1822
+// Compiler: Microchip XC8 v2.32
+//
+// Timer2 runs the PWM with PR2 = 255 and interrupts at the end of every period,
+// DDS_SAMPLE_CHZ / 100 times per second (31.25 kHz at 32 MHz). Each interrupt adds
+// the tuning word to a 24 bit phase accumulator, and the top bits of the phase
+// pick the next duty cycle from a waveform. One full turn of the accumulator is
+// one period of the output, so
+//
+//      frequency = tuning x sample rate / 2^24
+//
+// which is 0.0019 Hz per step of the tuning word at 31.25 kHz. PR2 never changes,
+// only CCPR1L does, so the output frequency moves without a glitch.
+//
+// The waveforms are a sine and an arbitrary table from ddsTables.h in flash, and
+// a triangle and a sawtooth worked out from the phase. In one-shot mode the
+// output stops at the end of the first period and holds its last value, so a
+// slow sawtooth makes a soft start ramp from 0 to full duty.
+//
+// The duty cycle for the next sample is worked out ahead and written first thing
+// in the interrupt, so it lands the same number of cycles after the start of
+// every period whatever path the lookup took. An RC low pass on the output turns
+// the PWM into the waveform.
+//
+// The sample must define _XTAL_FREQ (4 MHz or more), call dds_isr() from its
+// interrupt routine and set INTCONbits.PEIE and INTCONbits.GIE after dds_init().
+// Timer2 and CCP1 belong to the DDS.
+//**********************************************************************************
+
+#ifndef DDS_H
+#define DDS_H
+
+#include <xc.h>
+#include <stdint.h>
+
+// 256 or 64 entries per table, 8 or 6 bits of the phase
+#ifndef DDS_TABLE_BITS
+#define DDS_TABLE_BITS 8
+#endif
+
+#if DDS_TABLE_BITS != 8 && DDS_TABLE_BITS != 6
+#error "DDS_TABLE_BITS must be 8 or 6"
+#endif
+
+#include "ddsTables.h"
+
+// A sample every DDS_POSTSCALE periods of the PWM (1-16), a lower sample rate
+// leaves more time for the main loop
+#ifndef DDS_POSTSCALE
+#define DDS_POSTSCALE 1
+#endif
+
+#if DDS_POSTSCALE < 1 || DDS_POSTSCALE > 16
+#error "DDS_POSTSCALE must be between 1 and 16"
+#endif
+
+// Sample rate in hundredths of a hertz: Fosc / 4 / 256 / DDS_POSTSCALE x 100
+#define DDS_SAMPLE_CHZ  (_XTAL_FREQ * 25UL / (256UL * DDS_POSTSCALE))
+
+#if (_XTAL_FREQ * 25UL) % (256UL * DDS_POSTSCALE) != 0
+#error "The DDS sample rate must be a whole number of hundredths of a hertz, use 4 MHz or more"
+#endif
+
+#define DDS_PHASE_WRAP  0x01000000UL
+
+enum {
+    DDS_SINE,
+    DDS_TRIANGLE,
+    DDS_SAWTOOTH,
+    DDS_TABLE // dds_table, 2^DDS_TABLE_BITS entries
+};
+
+static volatile uint32_t dds_phase;
+static volatile uint32_t dds_tuning;
+static volatile uint8_t dds_wave;
+static const uint8_t *dds_table = dds_sine;
+static volatile uint8_t dds_one_shot;
+static volatile uint8_t dds_next = 128; // Duty cycle of the next sample
+
+// Silent: 50% duty and a tuning word of 0
+static inline void dds_init(void) {
+    CCP1CON = 0b00001100; // PWM mode, single output on P1A, active high
+    CCPR1L = dds_next;
+    PR2 = 0xFF;
+    T2CONbits.T2CKPS = 0b00; // 1:1
+    T2CONbits.T2OUTPS = DDS_POSTSCALE - 1;
+    PIR1bits.TMR2IF = 0;
+    PIE1bits.TMR2IE = 1;
+    T2CONbits.TMR2ON = 1;
+}
+
+// numerator x 2^24 / denominator for a numerator below the denominator, worked
+// out one bit at a time by shifting and subtracting. The product does not fit in
+// 32 bits and this needs no division routine. The denominator must stay below
+// 2^31 so the shifted remainder does not overflow.
+static inline uint32_t dds_fraction_word(uint32_t numerator, uint32_t denominator) {
+    uint32_t remainder = numerator;
+    uint32_t word = 0;
+
+    for (uint8_t bit = 0; bit < 24; bit++) {
+        remainder <<= 1;
+        word <<= 1;
+        if (remainder >= denominator) {
+            remainder -= denominator;
+            word |= 1;
+        }
+    }
+    if (remainder << 1 >= denominator) {
+        word++; // Round to the nearest
+    }
+    return word;
+}
+
+// Tuning word for a frequency in hundredths of a hertz: centihertz x 2^24 /
+// DDS_SAMPLE_CHZ
+static inline uint32_t dds_tuning_word(uint32_t centihertz) {
+    return dds_fraction_word(centihertz, DDS_SAMPLE_CHZ);
+}
+
+// The interrupt routine must not see half of a 32 bit value, so the Timer2
+// interrupt is off while one changes. A sample that falls in between comes out
+// a few cycles late.
+static inline uint8_t dds_set_frequency(uint32_t centihertz) {
+    if (centihertz >= DDS_SAMPLE_CHZ / 2) {
+        return 0; // Above half the sample rate only aliases come out
+    }
+    uint32_t word = dds_tuning_word(centihertz);
+
+    PIE1bits.TMR2IE = 0;
+    dds_tuning = word;
+    dds_one_shot = 0;
+    PIE1bits.TMR2IE = 1;
+    return 1;
+}
+
+// table is only used with DDS_TABLE
+static inline void dds_set_wave(uint8_t wave, const uint8_t *table) {
+    PIE1bits.TMR2IE = 0;
+    dds_wave = wave;
+    dds_table = wave == DDS_SINE ? dds_sine : table;
+    PIE1bits.TMR2IE = 1;
+}
+
+static inline void dds_start_once(uint32_t word) {
+    PIE1bits.TMR2IE = 0;
+    dds_phase = 0;
+    dds_tuning = word;
+    dds_one_shot = 1;
+    PIE1bits.TMR2IE = 1;
+}
+
+// Plays one period of the waveform from the start and then holds its last value
+// until dds_set_frequency() or dds_play_once() is called again
+static inline uint8_t dds_play_once(uint32_t centihertz) {
+    if (centihertz >= DDS_SAMPLE_CHZ / 2) {
+        return 0;
+    }
+    dds_start_once(dds_tuning_word(centihertz));
+    return 1;
+}
+
+// The same for one period lasting seconds (1-60), a slow ramp. The tuning word
+// is 2^24 / (seconds x sample rate), worked out from the seconds directly; a
+// frequency in whole centihertz is far too coarse for periods this long. The
+// word of a minute is only about 9 at 31.25 kHz, so the ramps come out within 5%
+// of the time asked for.
+static inline uint8_t dds_play_once_seconds(uint8_t seconds) {
+    if (seconds == 0 || seconds > 60) {
+        return 0;
+    }
+    dds_start_once(dds_fraction_word(100, seconds * DDS_SAMPLE_CHZ));
+    return 1;
+}
+
+static inline void dds_isr(void) {
+    if (PIE1bits.TMR2IE && PIR1bits.TMR2IF) {
+        CCPR1L = dds_next; // Latched at the end of this period
+        PIR1bits.TMR2IF = 0;
+
+        uint32_t phase = dds_phase + dds_tuning;
+        if (phase & DDS_PHASE_WRAP) {
+            if (dds_one_shot) {
+                phase = DDS_PHASE_WRAP - 1; // Stays on the last sample
+                dds_tuning = 0;
+            } else {
+                phase -= DDS_PHASE_WRAP;
+            }
+        }
+        dds_phase = phase;
+
+        uint8_t index = (uint8_t) (phase >> 16); // The top 8 of the 24 bits
+        switch (dds_wave) {
+            case DDS_TRIANGLE:
+                // Up on the first half of the period, down on the second
+                dds_next = (uint8_t) (index & 0x80 ? ~(index << 1) : index << 1);
+                break;
+            case DDS_SAWTOOTH:
+                dds_next = index;
+                break;
+            default:
+                dds_next = dds_table[index >> (8 - DDS_TABLE_BITS)];
+                break;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,70 @@
+//**********************************************************************************
+// Waveform tables for the DDS, generated by host/DdsTables/ddsTables.c
+//
+// Do not edit, run the generator again instead.
+//**********************************************************************************
+
+#ifndef DDS_TABLES_H
+#define DDS_TABLES_H
+
+#include <stdint.h>
+
+#if DDS_TABLE_BITS == 8
+
+static const uint8_t dds_sine[256] = {
+    128,131,134,137,140,143,146,149,152,155,158,162,165,167,170,173,
+    176,179,182,185,188,190,193,196,198,201,203,206,208,211,213,215,
+    218,220,222,224,226,228,230,232,234,235,237,238,240,241,243,244,
+    245,246,248,249,250,250,251,252,253,253,254,254,254,255,255,255,
+    255,255,255,255,254,254,254,253,253,252,251,250,250,249,248,246,
+    245,244,243,241,240,238,237,235,234,232,230,228,226,224,222,220,
+    218,215,213,211,208,206,203,201,198,196,193,190,188,185,182,179,
+    176,173,170,167,165,162,158,155,152,149,146,143,140,137,134,131,
+    128,124,121,118,115,112,109,106,103,100, 97, 93, 90, 88, 85, 82,
+     79, 76, 73, 70, 67, 65, 62, 59, 57, 54, 52, 49, 47, 44, 42, 40,
+     37, 35, 33, 31, 29, 27, 25, 23, 21, 20, 18, 17, 15, 14, 12, 11,
+     10,  9,  7,  6,  5,  5,  4,  3,  2,  2,  1,  1,  1,  0,  0,  0,
+      0,  0,  0,  0,  1,  1,  1,  2,  2,  3,  4,  5,  5,  6,  7,  9,
+     10, 11, 12, 14, 15, 17, 18, 20, 21, 23, 25, 27, 29, 31, 33, 35,
+     37, 40, 42, 44, 47, 49, 52, 54, 57, 59, 62, 65, 67, 70, 73, 76,
+     79, 82, 85, 88, 90, 93, 97,100,103,106,109,112,115,118,121,124
+};
+
+static const uint8_t dds_organ[256] = {
+    128,134,140,146,152,158,164,170,176,181,187,192,197,202,207,212,
+    216,221,225,228,232,235,238,241,244,246,248,250,251,252,253,254,
+    255,255,255,255,254,254,253,252,251,249,248,246,244,243,240,238,
+    236,234,231,229,226,224,221,219,216,214,211,208,206,203,201,199,
+    196,194,192,190,188,186,184,183,181,179,178,177,175,174,173,172,
+    171,170,169,169,168,167,167,166,166,165,165,165,164,164,164,163,
+    163,162,162,161,161,160,160,159,159,158,157,156,155,155,154,153,
+    151,150,149,148,146,145,144,142,141,139,137,136,134,133,131,129,
+    128,126,124,122,121,119,118,116,114,113,111,110,109,107,106,105,
+    104,102,101,100,100, 99, 98, 97, 96, 96, 95, 95, 94, 94, 93, 93,
+     92, 92, 91, 91, 91, 90, 90, 90, 89, 89, 88, 88, 87, 86, 86, 85,
+     84, 83, 82, 81, 80, 78, 77, 76, 74, 72, 71, 69, 67, 65, 63, 61,
+     59, 56, 54, 52, 49, 47, 44, 41, 39, 36, 34, 31, 29, 26, 24, 21,
+     19, 17, 15, 12, 11,  9,  7,  6,  4,  3,  2,  1,  1,  0,  0,  0,
+      0,  1,  2,  3,  4,  5,  7,  9, 11, 14, 17, 20, 23, 27, 30, 34,
+     39, 43, 48, 53, 58, 63, 68, 74, 79, 85, 91, 97,103,109,115,121
+};
+
+#else
+
+static const uint8_t dds_sine[64] = {
+    128,140,152,165,176,188,198,208,218,226,234,240,245,250,253,254,
+    255,254,253,250,245,240,234,226,218,208,198,188,176,165,152,140,
+    128,115,103, 90, 79, 67, 57, 47, 37, 29, 21, 15, 10,  5,  2,  1,
+      0,  1,  2,  5, 10, 15, 21, 29, 37, 47, 57, 67, 79, 90,103,115
+};
+
+static const uint8_t dds_organ[64] = {
+    128,152,176,197,216,232,244,251,255,254,251,244,236,226,216,206,
+    196,188,181,175,171,168,166,164,163,161,159,155,151,146,141,134,
+    128,121,114,109,104,100, 96, 94, 92, 91, 89, 87, 84, 80, 74, 67,
+     59, 49, 39, 29, 19, 11,  4,  1,  0,  4, 11, 23, 39, 58, 79,103
+};
+
+#endif
+
+#endif
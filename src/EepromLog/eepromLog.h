@@ -0,0 +1,258 @@
+//**********************************************************************************
+// Sample log in the data EEPROM of the PIC12F1822
+//
+// Device: PIC12F1822
+// Compiler: Microchip XC8 v2.32
+//
+// The 256 bytes of data EEPROM keep the readings through a reset or a power cut
+// until the PC asks for them. They are used as a ring of 16 pages of 16 bytes:
+//
+//      byte 0      sequence number of the page, 0-254, +1 for every new page
+//      byte 1-2    first reading of the page, little endian
+//      byte 3-15   the next readings as differences to the one before, zigzag
+//                  varint coded, and 0xFF after the last one
+//
+// Zigzag turns a difference into a positive number, 0, -1, 1, -2 ... become 0, 1,
+// 2, 3 ..., so a reading that moves by less than 64 takes one byte. Bigger ones
+// take two, 0x80 plus the high bits first and then the low 7 bits. Readings have
+// up to 12 bits, so no byte of a difference is ever 0xFF. Depending on how
+// quickly the readings change the log holds about 110 to 220 of them.
+//
+// The pages are written one after the other all around the ring, so no byte gets
+// more than two writes per round: the sequence number gets 0xFF and then the new
+// number, the first reading one write, and every other byte at most one as the
+// end marker and one with a reading. With a reading every 10 s a round takes
+// about 19 minutes when every difference needs two bytes, 7 readings a page, and
+// the 100k writes the datasheet guarantees last about 1.8 years. Readings that
+// only move by less than 64 fit 14 to a page, 37 minutes a round and about 3.6
+// years. The page after the newest one is always the oldest.
+//
+// A write takes 4 to 5 ms. eeprom_log_add() never waits for it, it puts the bytes
+// in a small queue and the EEIF interrupt starts the next write when one is done.
+// The bytes of a reading are written so that the log is complete after every
+// single write: the new 0xFF end marker first, the first byte of the reading,
+// which replaces the old marker, last. A new page gets 0xFF as its sequence
+// number before anything else of it changes, so it drops out of the log, and its
+// new sequence number after its header and end marker are in place. A reset in
+// the middle loses at most the reading that was being written, and with a new
+// page the oldest page of the log.
+//
+// The sample calls eeprom_log_init() once at startup, eeprom_log_isr() from its
+// interrupt routine and sets INTCONbits.PEIE and INTCONbits.GIE.
+// host/TelemetryDecoder turns a dump of the 256 bytes back into the readings.
+//**********************************************************************************
+
+#ifndef EEPROM_LOG_H
+#define EEPROM_LOG_H
+
+#include <xc.h>
+#include <stdint.h>
+
+#define EEPROM_LOG_SIZE         256
+#define EEPROM_LOG_PAGE_SIZE    16
+#define EEPROM_LOG_PAGES        (EEPROM_LOG_SIZE / EEPROM_LOG_PAGE_SIZE)
+#define EEPROM_LOG_HEADER_SIZE  3
+#define EEPROM_LOG_END          0xFF // Also what an erased byte reads
+#define EEPROM_LOG_SEQUENCES    255 // 0xFF is no sequence number, the page is empty
+
+// Writes waiting for the EEPROM, a new page needs 5. A power of two.
+#ifndef EEPROM_LOG_QUEUE_SIZE
+#define EEPROM_LOG_QUEUE_SIZE   8
+#endif
+
+#if (EEPROM_LOG_QUEUE_SIZE & (EEPROM_LOG_QUEUE_SIZE - 1)) != 0 || EEPROM_LOG_QUEUE_SIZE < 8
+#error "EEPROM_LOG_QUEUE_SIZE must be a power of two of at least 8"
+#endif
+
+#define EEPROM_LOG_QUEUE_MASK   (EEPROM_LOG_QUEUE_SIZE - 1)
+
+static uint8_t eeprom_log_page; // The newest page
+static uint8_t eeprom_log_position; // Where the next reading goes in it
+static uint8_t eeprom_log_sequence;
+static uint16_t eeprom_log_last; // Reading the next difference starts from
+static uint8_t eeprom_log_dropped; // Readings the full queue had no room for, stops at 255
+
+static uint8_t eeprom_log_queue_address[EEPROM_LOG_QUEUE_SIZE];
+static uint8_t eeprom_log_queue_data[EEPROM_LOG_QUEUE_SIZE];
+static volatile uint8_t eeprom_log_head;
+static volatile uint8_t eeprom_log_tail;
+static volatile uint8_t eeprom_log_writing; // A write is in progress
+
+// Waits for a write that is in progress, a read in between returns garbage
+static inline uint8_t eeprom_log_read(uint8_t address) {
+    while (EECON1bits.WR) {
+        // Up to 5 ms
+    }
+    EEADRL = address;
+    EECON1bits.EEPGD = 0; // Data EEPROM, not flash
+    EECON1bits.CFGS = 0;
+    EECON1bits.RD = 1;
+    return EEDATL;
+}
+
+// Starts the write at the tail of the queue. The unlock sequence must not be
+// interrupted, call this with GIE off.
+static inline void eeprom_log_start(void) {
+    uint8_t index = eeprom_log_tail & EEPROM_LOG_QUEUE_MASK;
+
+    EEADRL = eeprom_log_queue_address[index];
+    EEDATL = eeprom_log_queue_data[index];
+    EECON1bits.EEPGD = 0;
+    EECON1bits.CFGS = 0;
+    EECON1bits.WREN = 1;
+    EECON2 = 0x55;
+    EECON2 = 0xAA;
+    EECON1bits.WR = 1;
+    EECON1bits.WREN = 0; // The write goes on, no other write can start by mistake
+    eeprom_log_writing = 1;
+}
+
+static inline uint8_t eeprom_log_free(void) {
+    return (uint8_t) (EEPROM_LOG_QUEUE_SIZE - (uint8_t) (eeprom_log_head - eeprom_log_tail));
+}
+
+static inline void eeprom_log_queue(uint8_t address, uint8_t data) {
+    uint8_t index = eeprom_log_head & EEPROM_LOG_QUEUE_MASK;
+
+    eeprom_log_queue_address[index] = address;
+    eeprom_log_queue_data[index] = data;
+    eeprom_log_head++; // Publish the write only after it is stored
+}
+
+// Starts the first of the queued writes when the EEPROM is idle, the interrupt
+// routine takes care of the rest
+static inline void eeprom_log_kick(void) {
+    uint8_t gie = INTCONbits.GIE;
+
+    INTCONbits.GIE = 0;
+    if (!eeprom_log_writing) {
+        eeprom_log_start();
+    }
+    INTCONbits.GIE = gie;
+}
+
+// 1 when nothing is queued or being written, a dump then reads a log that does
+// not change under it
+static inline uint8_t eeprom_log_idle(void) {
+    return !eeprom_log_writing;
+}
+
+// Finds the newest page and the end of the log in it, and the last reading, so
+// the log goes on where it stopped before the reset. Blocks for a few hundred
+// cycles, call it once at startup.
+static inline void eeprom_log_init(void) {
+    uint8_t page;
+    uint8_t sequence;
+    uint8_t newest = EEPROM_LOG_PAGES;
+
+    // The newest page is the one the next page does not follow on from
+    for (page = 0; page < EEPROM_LOG_PAGES && newest == EEPROM_LOG_PAGES; page++) {
+        sequence = eeprom_log_read((uint8_t) (page * EEPROM_LOG_PAGE_SIZE));
+        if (sequence != EEPROM_LOG_END) {
+            uint8_t next = eeprom_log_read((uint8_t) (((page + 1) % EEPROM_LOG_PAGES) * EEPROM_LOG_PAGE_SIZE));
+            if (next != (sequence == EEPROM_LOG_SEQUENCES - 1 ? 0 : sequence + 1)) {
+                newest = page;
+            }
+        }
+    }
+
+    PIR2bits.EEIF = 0;
+    PIE2bits.EEIE = 1; // The end of a write starts the next one
+
+    if (newest == EEPROM_LOG_PAGES) {
+        // Erased, the first reading starts page 0 with sequence number 0
+        eeprom_log_page = EEPROM_LOG_PAGES - 1;
+        eeprom_log_position = EEPROM_LOG_PAGE_SIZE;
+        eeprom_log_sequence = EEPROM_LOG_SEQUENCES - 1;
+        return;
+    }
+
+    uint8_t address = (uint8_t) (newest * EEPROM_LOG_PAGE_SIZE);
+    uint8_t position = EEPROM_LOG_HEADER_SIZE;
+
+    eeprom_log_page = newest;
+    eeprom_log_sequence = eeprom_log_read(address);
+    eeprom_log_last = eeprom_log_read(address + 1) | (uint16_t) (eeprom_log_read(address + 2) << 8);
+    while (position < EEPROM_LOG_PAGE_SIZE) {
+        uint16_t zigzag = eeprom_log_read(address + position);
+
+        if (zigzag == EEPROM_LOG_END) {
+            break;
+        }
+        if (zigzag & 0x80) {
+            if (position + 1 == EEPROM_LOG_PAGE_SIZE) {
+                break; // Cut off, can not be written that way
+            }
+            zigzag = (uint16_t) ((zigzag & 0x7F) << 7) | eeprom_log_read(address + position + 1);
+            position++;
+        }
+        position++;
+        eeprom_log_last += (zigzag & 1) ? ~(zigzag >> 1) : zigzag >> 1;
+    }
+    eeprom_log_position = position;
+}
+
+// Adds a reading of up to 12 bits. Returns 0 and counts it in eeprom_log_dropped
+// when the queue has no room for it, which only happens when readings come faster
+// than one every 20 ms.
+static inline uint8_t eeprom_log_add(uint16_t value) {
+    int16_t delta = (int16_t) (value - eeprom_log_last);
+    uint16_t zigzag = (uint16_t) (delta << 1) ^ (uint16_t) (delta >> 15);
+    uint8_t length = zigzag < 0x80 ? 1 : 2;
+    uint8_t new_page = eeprom_log_position + length > EEPROM_LOG_PAGE_SIZE;
+    uint8_t marker = !new_page && eeprom_log_position + length < EEPROM_LOG_PAGE_SIZE;
+    uint8_t address;
+
+    if (eeprom_log_free() < (new_page ? 5 : length + marker)) {
+        if (eeprom_log_dropped != 255) {
+            eeprom_log_dropped++;
+        }
+        return 0;
+    }
+
+    if (new_page) {
+        // A new page with the reading in its header, over the oldest one. It
+        // leaves the log before its first reading or its readings change, and
+        // comes back with the new sequence number once the rest is written.
+        eeprom_log_page = (eeprom_log_page + 1) & (EEPROM_LOG_PAGES - 1);
+        eeprom_log_sequence = eeprom_log_sequence == EEPROM_LOG_SEQUENCES - 1 ? 0 : eeprom_log_sequence + 1;
+        address = (uint8_t) (eeprom_log_page * EEPROM_LOG_PAGE_SIZE);
+        eeprom_log_queue(address, EEPROM_LOG_END);
+        eeprom_log_queue(address + EEPROM_LOG_HEADER_SIZE, EEPROM_LOG_END);
+        eeprom_log_queue(address + 1, (uint8_t) value);
+        eeprom_log_queue(address + 2, (uint8_t) (value >> 8));
+        eeprom_log_queue(address, eeprom_log_sequence);
+        eeprom_log_position = EEPROM_LOG_HEADER_SIZE;
+    } else {
+        address = (uint8_t) (eeprom_log_page * EEPROM_LOG_PAGE_SIZE + eeprom_log_position);
+        if (marker) {
+            eeprom_log_queue(address + length, EEPROM_LOG_END);
+        }
+        if (length == 2) {
+            eeprom_log_queue(address + 1, zigzag & 0x7F);
+            eeprom_log_queue(address, (uint8_t) (0x80 | (zigzag >> 7)));
+        } else {
+            eeprom_log_queue(address, (uint8_t) zigzag);
+        }
+        eeprom_log_position += length;
+    }
+
+    eeprom_log_last = value;
+    eeprom_log_kick();
+    return 1;
+}
+
+// Call this from the interrupt routine
+static inline void eeprom_log_isr(void) {
+    if (PIR2bits.EEIF) {
+        PIR2bits.EEIF = 0;
+        eeprom_log_tail++;
+        if (eeprom_log_tail != eeprom_log_head) {
+            eeprom_log_start();
+        } else {
+            eeprom_log_writing = 0;
+        }
+    }
+}
+
+#endif
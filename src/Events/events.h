@@ -0,0 +1,75 @@
+//**********************************************************************************
+// Queue of events from the interrupt routine to the main loop
+//
+// Device: PIC12F1822
+// Compiler: Microchip XC8 v2.32
+//
+// The interrupt routine should only acknowledge a source and grab what would be
+// lost otherwise (the received byte, the ADC result, the pins), then push an event
+// and return. The main loop pops the events and does the real work with the
+// interrupts enabled, so a slow reaction to one source never delays another.
+//
+// There is exactly one producer, the interrupt routine, and one consumer, the
+// main loop. events_push() only writes events_head and events_pop() only writes
+// events_tail, and each of them is a single byte the core reads and writes in one
+// instruction, so no interrupts have to be disabled around either side.
+//**********************************************************************************
+
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <stdint.h>
+
+// Number of events the queue holds, a power of two
+#ifndef EVENTS_QUEUE_SIZE
+#define EVENTS_QUEUE_SIZE 8
+#endif
+
+#if (EVENTS_QUEUE_SIZE & (EVENTS_QUEUE_SIZE - 1)) != 0 || EVENTS_QUEUE_SIZE > 128
+#error "EVENTS_QUEUE_SIZE must be a power of two not bigger than 128"
+#endif
+
+#define EVENTS_MASK (EVENTS_QUEUE_SIZE - 1)
+
+typedef struct {
+    uint8_t source; // What happened, the sample defines the values
+    uint16_t data; // What the interrupt captured with it
+} event_t;
+
+static event_t events_queue[EVENTS_QUEUE_SIZE];
+static volatile uint8_t events_head; // Written by the interrupt routine only
+static volatile uint8_t events_tail; // Written by the main loop only
+static volatile uint8_t events_dropped; // Events lost because the queue was full
+
+// Interrupt side. The event is complete before the head moves, so the main loop
+// never sees half of it.
+static inline void events_push(uint8_t source, uint16_t data) {
+    uint8_t head = events_head;
+
+    if ((uint8_t) (head - events_tail) == EVENTS_QUEUE_SIZE) {
+        events_dropped++;
+        return;
+    }
+    events_queue[head & EVENTS_MASK].source = source;
+    events_queue[head & EVENTS_MASK].data = data;
+    events_head = head + 1;
+}
+
+// Main loop side. Returns 0 when the queue is empty.
+static inline uint8_t events_pop(event_t *event) {
+    uint8_t tail = events_tail;
+
+    if (tail == events_head) {
+        return 0;
+    }
+    *event = events_queue[tail & EVENTS_MASK];
+    events_tail = tail + 1;
+    return 1;
+}
+
+// Main loop side, for the check before SLEEP with the interrupts off
+static inline uint8_t events_pending(void) {
+    return events_tail != events_head;
+}
+
+#endif
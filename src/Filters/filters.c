@@ -0,0 +1,139 @@
+//**********************************************************************************
+// Example program measuring the filters of ../Filters/filters.h on a PIC12F1822
+//
+// Device: PIC12F1822
+// Demo Board: PICkit 4
+// Compiler: Microchip XC8 v2.32
+// IDE: MPLAB X v5.45
+//
+// This program feeds the same stream of 12 bit readings through every filter of
+// filters.h and times each call with ../Profiler/profiler.h, so the cost of a
+// filter is known in instruction cycles before it goes into a sampling loop.
+// Nothing else runs, there is no interrupt routine. The profiler is always on in
+// this sample, it does not need -DPROFILER.
+// Once a second a profile frame per filter goes out on RA0 at 115200 baud, and
+// host/TelemetryDecoder prints the runs and the shortest, longest and mean time
+// of each in Timer1 counts, which are instruction cycles of 125 ns at 32 MHz:
+//      region 1    filter_ema
+//      region 2    filter_boxcar
+//      region 3    filter_median3
+//      region 4    filter_median5
+//      region 5    filter_hysteresis
+// The longest time is the one to budget for: a filter running on every sample at
+// a sample rate of f uses f x cycles of the 8 million per second. Storing the
+// result to a volatile for the compiler to keep the call adds a few cycles.
+// The host simulator charges no time for arithmetic, so these numbers only come
+// from the chip.
+//**********************************************************************************
+//                                   PIC12F1822 Pinout for this example
+//                                   ----------
+//          3.3V Power source -> Vdd |1      8| GND
+//                               RA5 |2      7| RA0 -> TX
+//                               RA4 |3      6| RA1
+//                               RA3 |4      5| RA2
+//                                   ----------
+//**********************************************************************************
+
+#include <xc.h>
+
+#pragma config FOSC = INTOSC    // Oscillator Selection (INTOSC oscillator: I/O function on CLKIN pin)
+#pragma config WDTE = OFF       // Watchdog Timer Enable (WDT disabled)
+#pragma config PWRTE = OFF      // Power-up Timer Enable (PWRT disabled)
+#pragma config MCLRE = OFF       // MCLR Pin Function Select (MCLR/VPP pin function is MCLR)
+#pragma config CP = OFF         // Flash Program Memory Code Protection (Program memory code protection is disabled)
+#pragma config CPD = OFF        // Data Memory Code Protection (Data memory code protection is disabled)
+#pragma config BOREN = OFF       // Brown-out Reset Enable (Brown-out Reset enabled)
+#pragma config CLKOUTEN = OFF   // Clock Out Enable (CLKOUT function is disabled. I/O or oscillator function on the CLKOUT pin)
+#pragma config IESO = OFF        // Internal/External Switchover (Internal/External Switchover mode is enabled)
+#pragma config FCMEN = OFF       // Fail-Safe Clock Monitor Enable (Fail-Safe Clock Monitor is enabled)
+
+// CONFIG2
+#pragma config WRT = OFF        // Flash Memory Self-Write Protection (Write protection off)
+#pragma config PLLEN = OFF       // PLL Enable (4x PLL enabled)
+#pragma config STVREN = ON      // Stack Overflow/Underflow Reset Enable (Stack Overflow or Underflow will cause a Reset)
+#pragma config BORV = LO        // Brown-out Reset Voltage Selection (Brown-out Reset Voltage (Vbor), low trip point selected.)
+#pragma config LVP = ON         // Low-Voltage Programming Enable (Low-voltage programming enabled)
+
+#include <xc.h> // Include standard header file
+#include <stdint.h>
+
+// Definitions
+#define _XTAL_FREQ  32000000 // This is used by the __delay_ms(xx) and __delay_us(xx) functions
+
+#define CONFIG_BAUD 115200
+#include "../Config/config.h"
+#include "filters.h"
+
+#ifndef PROFILER
+#define PROFILER // The measurement is all this sample does
+#endif
+#define PROFILER_REGIONS 6 // The latency, unused here, and one per filter
+#include "../Profiler/profiler.h"
+
+enum {
+    PROFILE_EMA = PROFILER_FIRST_REGION,
+    PROFILE_BOXCAR,
+    PROFILE_MEDIAN3,
+    PROFILE_MEDIAN5,
+    PROFILE_HYSTERESIS
+};
+
+#define OFF_BELOW   1800
+#define ON_ABOVE    2200
+
+static filter_ema_t Ema;
+static filter_boxcar_t Boxcar;
+static filter_median3_t Median3;
+static filter_median5_t Median5;
+static filter_hysteresis_t Hysteresis;
+static volatile uint16_t Result; // Keeps the compiler from dropping the calls
+
+static uint16_t Noise = 1;
+
+// 16 bit xorshift, so the medians see every order of readings and take all their
+// branches
+uint16_t next_reading(void) {
+    Noise ^= Noise << 7;
+    Noise ^= Noise >> 9;
+    Noise ^= Noise << 8;
+    return Noise & 0x0FFF;
+}
+
+void main(void) {
+    config_oscillator(); // 8 MHz Internal Oscillator through the PLL gives 32 MHz
+
+    ANSELA = 0; // Port A all pins are digital I/O Pin
+    PROFILER_INIT(); // Timer1, CCP1 on RA2 and TX on RA0
+
+    filter_ema_init(&Ema, 2048);
+    filter_boxcar_init(&Boxcar, 2048);
+    filter_median3_init(&Median3, 2048);
+    filter_median5_init(&Median5, 2048);
+    filter_hysteresis_init(&Hysteresis, 0);
+
+    for (;;) {
+        uint16_t reading = next_reading();
+
+        PROFILE_BEGIN(PROFILE_EMA);
+        Result = filter_ema(&Ema, reading);
+        PROFILE_END(PROFILE_EMA);
+
+        PROFILE_BEGIN(PROFILE_BOXCAR);
+        Result = filter_boxcar(&Boxcar, reading);
+        PROFILE_END(PROFILE_BOXCAR);
+
+        PROFILE_BEGIN(PROFILE_MEDIAN3);
+        Result = filter_median3(&Median3, reading);
+        PROFILE_END(PROFILE_MEDIAN3);
+
+        PROFILE_BEGIN(PROFILE_MEDIAN5);
+        Result = filter_median5(&Median5, reading);
+        PROFILE_END(PROFILE_MEDIAN5);
+
+        PROFILE_BEGIN(PROFILE_HYSTERESIS);
+        Result = filter_hysteresis(&Hysteresis, reading, OFF_BELOW, ON_ABOVE);
+        PROFILE_END(PROFILE_HYSTERESIS);
+
+        PROFILE_DUMP();
+    }
+}
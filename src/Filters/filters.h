@@ -0,0 +1,206 @@
+//**********************************************************************************
+// Integer filters for ADC readings on the PIC12F1822
+//
+// Device: PIC12F1822
+// Compiler: Microchip XC8 v2.32
+//
+// A single noisy reading of a sensor says little, these filters smooth a stream
+// of readings one value at a time. They only add, subtract, compare and shift;
+// the core has no divide instruction and a software division costs hundreds of
+// cycles. The sizes are set at compile time, so every filter is a small struct
+// the sample keeps one of per signal:
+//
+//      filter_ema_t        exponential moving average, y += (x - y) / 2^shift
+//      filter_boxcar_t     mean of the last FILTER_BOXCAR_LENGTH readings
+//      filter_median3_t    median of the last 3 readings, removes single spikes
+//      filter_median5_t    median of the last 5 readings, removes two spikes
+//      filter_hysteresis_t on/off decision with separate on and off thresholds
+//
+// The readings are up to 12 bits, the oversampled results of ../AnalogRead.
+// Call the matching init function before the first reading.
+//
+// The work per reading is fixed, it does not grow with FILTER_BOXCAR_LENGTH:
+//
+//      filter_ema          a subtract, an add and two shifts of FILTER_EMA_SHIFT
+//      filter_boxcar       a subtract, an add, two table accesses and a shift
+//      filter_median3      three compares, up to one swap
+//      filter_median5      seven compares, up to seven swaps
+//      filter_hysteresis   one or two compares
+//
+// filters.c runs each of them on the chip between two reads of Timer1 and sends
+// the shortest, longest and mean instruction cycles per call through
+// ../Profiler/profiler.h. host/Simulator/tests/filtersTest.c checks the results
+// against plain reference versions on the host.
+//**********************************************************************************
+
+#ifndef FILTERS_H
+#define FILTERS_H
+
+#include <stdint.h>
+
+// Weight of a new reading in the exponential moving average is 1 / 2^shift.
+// 4 bits of shift on top of a 12 bit reading still fit the 16 bit sum.
+#ifndef FILTER_EMA_SHIFT
+#define FILTER_EMA_SHIFT 3
+#endif
+
+#if FILTER_EMA_SHIFT < 1 || FILTER_EMA_SHIFT > 4
+#error "FILTER_EMA_SHIFT must be between 1 and 4"
+#endif
+
+// Readings in the boxcar average. A power of two so the mean is a shift.
+#ifndef FILTER_BOXCAR_LENGTH
+#define FILTER_BOXCAR_LENGTH 4
+#endif
+
+#if (FILTER_BOXCAR_LENGTH & (FILTER_BOXCAR_LENGTH - 1)) != 0 || FILTER_BOXCAR_LENGTH > 16
+#error "FILTER_BOXCAR_LENGTH must be a power of two not bigger than 16"
+#endif
+
+#if FILTER_BOXCAR_LENGTH == 1
+#define FILTER_BOXCAR_SHIFT 0
+#elif FILTER_BOXCAR_LENGTH == 2
+#define FILTER_BOXCAR_SHIFT 1
+#elif FILTER_BOXCAR_LENGTH == 4
+#define FILTER_BOXCAR_SHIFT 2
+#elif FILTER_BOXCAR_LENGTH == 8
+#define FILTER_BOXCAR_SHIFT 3
+#else
+#define FILTER_BOXCAR_SHIFT 4
+#endif
+
+typedef struct {
+    uint16_t sum; // The average times 2^FILTER_EMA_SHIFT
+} filter_ema_t;
+
+typedef struct {
+    uint16_t readings[FILTER_BOXCAR_LENGTH];
+    uint16_t sum; // Of everything in readings, 16 x 4095 still fits
+    uint8_t next;
+} filter_boxcar_t;
+
+typedef struct {
+    uint16_t readings[3];
+    uint8_t next;
+} filter_median3_t;
+
+typedef struct {
+    uint16_t readings[5];
+    uint8_t next;
+} filter_median5_t;
+
+typedef struct {
+    uint8_t on;
+} filter_hysteresis_t;
+
+// Starts the average at the first reading instead of ramping up from 0
+static inline void filter_ema_init(filter_ema_t *filter, uint16_t first) {
+    filter->sum = first << FILTER_EMA_SHIFT;
+}
+
+// sum - sum / 2^shift + x settles at x x 2^shift, so the rounding of the shift
+// never builds up the way it does when y itself is kept
+static inline uint16_t filter_ema(filter_ema_t *filter, uint16_t reading) {
+    filter->sum = filter->sum - (filter->sum >> FILTER_EMA_SHIFT) + reading;
+    return filter->sum >> FILTER_EMA_SHIFT;
+}
+
+static inline void filter_boxcar_init(filter_boxcar_t *filter, uint16_t first) {
+    for (uint8_t i = 0; i < FILTER_BOXCAR_LENGTH; i++) {
+        filter->readings[i] = first;
+    }
+    filter->sum = first << FILTER_BOXCAR_SHIFT;
+    filter->next = 0;
+}
+
+// The running sum drops the oldest reading and adds the new one, so the cost does
+// not grow with the length
+static inline uint16_t filter_boxcar(filter_boxcar_t *filter, uint16_t reading) {
+    filter->sum = filter->sum - filter->readings[filter->next] + reading;
+    filter->readings[filter->next] = reading;
+    filter->next = (filter->next + 1) & (FILTER_BOXCAR_LENGTH - 1);
+    return filter->sum >> FILTER_BOXCAR_SHIFT;
+}
+
+static inline void filter_median3_init(filter_median3_t *filter, uint16_t first) {
+    filter->readings[0] = first;
+    filter->readings[1] = first;
+    filter->readings[2] = first;
+    filter->next = 0;
+}
+
+static inline uint16_t filter_median3(filter_median3_t *filter, uint16_t reading) {
+    filter->readings[filter->next] = reading;
+    if (++filter->next == 3) {
+        filter->next = 0;
+    }
+
+    uint16_t a = filter->readings[0];
+    uint16_t b = filter->readings[1];
+    uint16_t c = filter->readings[2];
+
+    // With a <= b the median is the bigger of a and the smaller of b and c
+    if (a > b) {
+        uint16_t t = a;
+        a = b;
+        b = t;
+    }
+    if (b > c) {
+        b = c;
+    }
+    return a > b ? a : b;
+}
+
+static inline void filter_median5_init(filter_median5_t *filter, uint16_t first) {
+    for (uint8_t i = 0; i < 5; i++) {
+        filter->readings[i] = first;
+    }
+    filter->next = 0;
+}
+
+#define FILTER_SORT2(a, b) if ((a) > (b)) { uint16_t t = (a); (a) = (b); (b) = t; }
+
+static inline uint16_t filter_median5(filter_median5_t *filter, uint16_t reading) {
+    filter->readings[filter->next] = reading;
+    if (++filter->next == 5) {
+        filter->next = 0;
+    }
+
+    uint16_t a = filter->readings[0];
+    uint16_t b = filter->readings[1];
+    uint16_t c = filter->readings[2];
+    uint16_t d = filter->readings[3];
+    uint16_t e = filter->readings[4];
+
+    // Seven compare and swaps instead of a full sort. After the first four a is
+    // smaller and e bigger than three others, so neither can be the median; the
+    // last three pick the middle one of b, c and d.
+    FILTER_SORT2(a, b);
+    FILTER_SORT2(d, e);
+    FILTER_SORT2(a, d);
+    FILTER_SORT2(b, e);
+    FILTER_SORT2(b, c);
+    FILTER_SORT2(c, d);
+    FILTER_SORT2(b, c);
+    return c;
+}
+
+#undef FILTER_SORT2
+
+static inline void filter_hysteresis_init(filter_hysteresis_t *filter, uint8_t on) {
+    filter->on = on;
+}
+
+// Switches on above on_above and off below off_below, in between it keeps its
+// state, so a reading that wobbles around one threshold does not flip it
+static inline uint8_t filter_hysteresis(filter_hysteresis_t *filter, uint16_t reading,
+                                        uint16_t off_below, uint16_t on_above) {
+    if (reading > on_above) {
+        filter->on = 1;
+    } else if (reading < off_below) {
+        filter->on = 0;
+    }
+    return filter->on;
+}
+
+#endif
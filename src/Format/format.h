@@ -0,0 +1,101 @@
+//**********************************************************************************
+// Decimal formatting without division for the PIC12F1822
+//
+// Device: PIC12F1822
+// Compiler: Microchip XC8 v2.32
+//
+// itoa() and printf() divide by 10 for every digit. The core has no divide
+// instruction, so each of those is a library routine of well over a hundred
+// cycles, and printf() pulls in its whole format parser on top. Here a digit is
+// found by subtracting its power of ten until the value gets smaller, at most 9
+// subtractions per digit and no library code at all.
+//
+// The functions write into a buffer of the caller, add a terminating zero and
+// return the number of characters without it, ready for uart_write().
+//**********************************************************************************
+
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <stdint.h>
+
+// Buffer sizes including the terminating zero
+#define FORMAT_U8_SIZE      4 // "255"
+#define FORMAT_U16_SIZE     6 // "65535"
+#define FORMAT_FIXED_SIZE   7 // "65.535"
+#define FORMAT_U32_SIZE     11 // "4294967295"
+
+static const uint16_t format_powers[] = { 10000, 1000, 100, 10, 1 };
+
+// Writes the digits of value from the power of ten at format_powers[first] down.
+// Leading zeros are skipped, except that at least min_digits digits are written.
+static inline uint8_t format_digits(char *buffer, uint16_t value, uint8_t first, uint8_t min_digits) {
+    uint8_t length = 0;
+
+    for (uint8_t i = first; i < sizeof format_powers / sizeof format_powers[0]; i++) {
+        uint16_t power = format_powers[i];
+        char digit = '0';
+
+        while (value >= power) {
+            value -= power;
+            digit++;
+        }
+        if (digit != '0' || length != 0 || (uint8_t) (5 - i) <= min_digits) {
+            buffer[length++] = digit;
+        }
+    }
+
+    buffer[length] = '\0';
+    return length;
+}
+
+static inline uint8_t format_u8(char *buffer, uint8_t value) {
+    return format_digits(buffer, value, 2, 1);
+}
+
+static inline uint8_t format_u16(char *buffer, uint16_t value) {
+    return format_digits(buffer, value, 0, 1);
+}
+
+// Values that fit in 16 bits take the shorter path of format_u16(), 32 bit
+// subtractions are about twice the work
+static inline uint8_t format_u32(char *buffer, uint32_t value) {
+    static const uint32_t powers[] = { 1000000000, 100000000, 10000000, 1000000, 100000, 10000 };
+    uint8_t length = 0;
+
+    if (value <= 0xFFFF) {
+        return format_u16(buffer, (uint16_t) value);
+    }
+
+    for (uint8_t i = 0; i < sizeof powers / sizeof powers[0]; i++) {
+        char digit = '0';
+
+        while (value >= powers[i]) {
+            value -= powers[i];
+            digit++;
+        }
+        if (digit != '0' || length != 0) {
+            buffer[length++] = digit;
+        }
+    }
+
+    // What is left is below 10000, the last 4 digits with their leading zeros
+    return (uint8_t) (length + format_digits(&buffer[length], (uint16_t) value, 1, 4));
+}
+
+// Writes a fixed point value with decimals digits after the point (1-3), for
+// example millivolts with 3 decimals as volts: 4388 -> "4.388"
+static inline uint8_t format_fixed(char *buffer, uint16_t value, uint8_t decimals) {
+    uint8_t length = format_digits(buffer, value, 0, (uint8_t) (decimals + 1));
+
+    // Move the decimals one place up to make room for the point
+    for (uint8_t i = length; i > length - decimals; i--) {
+        buffer[i] = buffer[i - 1];
+    }
+    buffer[length - decimals] = '.';
+    length++;
+    buffer[length] = '\0';
+    return length;
+}
+
+#endif
@@ -25,19 +25,46 @@
 //          when a valid edge appears on the INT pin. If the GIE and
 //          INTE bits are also set, the processor will redirect
 //          program execution to the interrupt vector.
+//
+// The core has a single interrupt vector, so high_priority_interrupt() checks
+// the sources one after the other: INT, IOC, Timer0, Timer1, Timer2, RCIF, TXIF
+// and ADIF, in that order. Only the first enabled source with its flag set is
+// handled per entry. Its handler clears the flag, takes what the hardware would
+// overwrite and pushes an event to ../Events/events.h; if another flag is set,
+// the core comes right back after RETFIE, so a source early in the list is never
+// kept waiting behind more than one short handler. The core clears GIE when it
+// enters the routine and RETFIE sets it again, the routine does not touch it.
+// The main loop takes the events and does the work: the button toggles the LED
+// on RA1 and Timer0 blinks the LED on RA5 about twice a second to show the loop
+// is alive. The other sources are in the dispatcher for samples that enable them.
+//
+// Built with -DPROFILER the routine and the event handling are timed with
+// ../Profiler/profiler.h, together with the latency from the button edge to the
+// routine, and the times go out on RA0 at 115200 baud once a second. That is the
+// real length of the routine. host/Simulator only counts its register accesses,
+// which is why its report calls the figure isr_longest_cycles_at_least.
+//
+// Built with -DINTERRUPT_ALL_SOURCES every source of the dispatcher is enabled,
+// for host/Simulator/tests/interruptTest.c: IOC on the rising edge of RA3, Timer1,
+// Timer2 every millisecond with an ADC conversion of the FVR after each, and the
+// EUSART at 115200 baud. RX takes RA1, so the button LED moves to RA4. A '?' from
+// the PC is answered with the events of each source so far and the dropped ones,
+// one byte per TXIF. The profiler owns Timer1 and the EUSART, so the two do not
+// go together.
 //**********************************************************************************
 //                                   PIC12F1822 Pinout for this example
 //                                   ----------
 //          3.3V Power source -> Vdd |1      8| GND
-//                               RA5 |2      7| RA0
-//                               RA4 |3      6| RA1 -> voltage out for the LED
-//                               RA3 |4      5| RA2 <- Voltage in from the button
+//              Heartbeat LED <- RA5 |2      7| RA0 -> TX with -DPROFILER or (*)
+//                    LED (*) <- RA4 |3      6| RA1 -> voltage out for the LED, RX (*)
+//        Rising edge IOC (*) -> RA3 |4      5| RA2 <- Voltage in from the button
 //                                   ----------
+//                                   (*) with -DINTERRUPT_ALL_SOURCES
 //**********************************************************************************
 
 #include <xc.h>
 
-#pragma config FOSC = ECH       // Oscillator Selection (ECH, External Clock, High Power Mode (4-32 MHz): device clock supplied to CLKIN pin)
+#pragma config FOSC = INTOSC    // Oscillator Selection (INTOSC oscillator: I/O function on CLKIN pin)
 #pragma config WDTE = OFF       // Watchdog Timer Enable (WDT disabled)
 #pragma config PWRTE = OFF      // Power-up Timer Enable (PWRT disabled)
 #pragma config MCLRE = OFF       // MCLR Pin Function Select (MCLR/VPP pin function is MCLR)
@@ -60,22 +87,166 @@
 // Definitions
 #define _XTAL_FREQ  16000000 // This is used by the __delay_ms(xx) and __delay_us(xx) functions
 
+#if defined(PROFILER) && defined(INTERRUPT_ALL_SOURCES)
+#error "The profiler owns Timer1 and the EUSART, build with one of PROFILER and INTERRUPT_ALL_SOURCES"
+#endif
+
+#if defined(PROFILER) || defined(INTERRUPT_ALL_SOURCES)
+#define CONFIG_BAUD 115200 // SPBRG 34, 114286 baud, -0.8%
+#endif
+
+#ifdef INTERRUPT_ALL_SOURCES
+#define CONFIG_ADC
+#endif
+
+#include "../Config/config.h"
+#include "../Events/events.h"
+#ifdef INTERRUPT_ALL_SOURCES
+#include "../Format/format.h"
+#endif
+
+#define PROFILER_REGIONS 3 // The latency and the two below
+#include "../Profiler/profiler.h"
+
+enum {
+    PROFILE_ISR = PROFILER_FIRST_REGION, // The whole interrupt routine
+    PROFILE_EVENT // Handling one event in the main loop
+};
+
+// Event sources, also the priority order of the dispatcher
+enum {
+    EVENT_INT, // data = PORTA at the edge
+    EVENT_IOC, // data = the IOCAF bits that were set
+    EVENT_TMR0,
+    EVENT_TMR1,
+    EVENT_TMR2,
+    EVENT_RX, // data = the received byte, bit 8 set on a framing error
+    EVENT_TX_READY, // TXREG is empty, TXIE is off until the main loop sends again
+    EVENT_ADC // data = ADRES
+};
+
+#define HEARTBEAT_TICKS 30 // Timer0 overflows every 16.384 ms
+
+#ifdef INTERRUPT_ALL_SOURCES
+#define BUTTON_LED LATAbits.LATA4 // RX is on RA1
+#define EVENT_SOURCES (EVENT_ADC + 1)
+
+static uint16_t EventCounts[EVENT_SOURCES];
+static char Reply[(EVENT_SOURCES + 1) * FORMAT_U16_SIZE + 1]; // Numbers and spaces, CR LF
+static uint8_t ReplyLength;
+static uint8_t ReplySent;
+#else
+#define BUTTON_LED LATAbits.LATA1
+#endif
+
 void __interrupt(high_priority) high_priority_interrupt(void) {
-    INTCONbits.GIE = 0; // Disable global interrupts until processing
+    PROFILE_ISR_BEGIN(PROFILE_ISR);
 
-    if (INTCONbits.INTF) { // Check if the interrupt is triggered on INTE PIN which is RA0
-        LATAbits.LATA1 = ~LATAbits.LATA1;
+    if (INTCONbits.INTE && INTCONbits.INTF) { // Check if the interrupt is triggered on INTE PIN which is RA2
         INTCONbits.INTF = 0; // Set the interrupt to handled so it can process further interrupts
+        events_push(EVENT_INT, PORTA);
+    } else if (INTCONbits.IOCIE && INTCONbits.IOCIF) {
+        uint8_t changed = IOCAF;
+        IOCAF ^= changed; // Clears only the flags seen, an edge that comes now stays set
+        events_push(EVENT_IOC, changed);
+    } else if (INTCONbits.TMR0IE && INTCONbits.TMR0IF) {
+        INTCONbits.TMR0IF = 0;
+        events_push(EVENT_TMR0, 0);
+    } else if (INTCONbits.PEIE) {
+        if (PIE1bits.TMR1IE && PIR1bits.TMR1IF) {
+            PIR1bits.TMR1IF = 0;
+            events_push(EVENT_TMR1, 0);
+        } else if (PIE1bits.TMR2IE && PIR1bits.TMR2IF) {
+            PIR1bits.TMR2IF = 0;
+            events_push(EVENT_TMR2, 0);
+        } else if (PIE1bits.RCIE && PIR1bits.RCIF) {
+            uint16_t data = RCSTAbits.FERR ? 0x100 : 0; // FERR belongs to the byte in RCREG
+            data |= RCREG; // Reading RCREG clears RCIF
+            if (RCSTAbits.OERR) {
+                RCSTAbits.CREN = 0; // Clear the overrun, or nothing more comes in
+                RCSTAbits.CREN = 1;
+            }
+            events_push(EVENT_RX, data);
+        } else if (PIE1bits.TXIE && PIR1bits.TXIF) {
+            PIE1bits.TXIE = 0; // TXIF stays set while TXREG is empty
+            events_push(EVENT_TX_READY, 0);
+        } else if (PIE1bits.ADIE && PIR1bits.ADIF) {
+            PIR1bits.ADIF = 0;
+            events_push(EVENT_ADC, ADRES);
+        }
+    }
+
+    PROFILE_END(PROFILE_ISR);
+}
+
+#ifdef INTERRUPT_ALL_SOURCES
+// IOC on RA3, Timer1, Timer2 with the ADC and the EUSART, on top of INT and Timer0
+static void init_all_sources(void) {
+    IOCAPbits.IOCAP3 = 1; // RA3 is always an input
+    INTCONbits.IOCIE = 1;
+
+    T1CON = 0; // Fosc/4, overflows every 32.768 ms with 1:2
+    T1GCON = 0;
+    T1CONbits.T1CKPS = 0b01;
+    PIE1bits.TMR1IE = 1;
+    T1CONbits.TMR1ON = 1;
+
+    PR2 = 249; // 1 ms with 1:16
+    T2CONbits.T2CKPS = 0b10;
+    PIE1bits.TMR2IE = 1;
+    T2CONbits.TMR2ON = 1;
+
+    FVRCONbits.ADFVR = 0b01; // 1.024 V, a channel without a pin
+    FVRCONbits.FVREN = 1;
+    ADCON0bits.CHS = 0b11111;
+    ADCON1bits.ADCS = CONFIG_ADCS;
+    ADCON1bits.ADFM = 1;
+    ADCON0bits.ADON = 1;
+    PIE1bits.ADIE = 1;
+
+    SPBRGH = UART_SPBRG >> 8;
+    SPBRGL = UART_SPBRG & 0xFF;
+    APFCONbits.RXDTSEL = 0; // RX on RA1
+    APFCONbits.TXCKSEL = 0; // TX on RA0
+    TRISAbits.TRISA1 = 1;
+    BAUDCONbits.BRG16 = 1;
+    TXSTAbits.BRGH = 1;
+    TXSTAbits.SYNC = 0;
+    TXSTAbits.TXEN = 1;
+    RCSTAbits.CREN = 1;
+    RCSTAbits.SPEN = 1;
+    PIE1bits.RCIE = 1; // TXIE only while there is something to send
+
+    INTCONbits.PEIE = 1;
+}
+
+// The events of every source so far and the dropped ones on one line
+static void start_reply(void) {
+    uint8_t length = 0;
+
+    for (uint8_t source = 0; source < EVENT_SOURCES; source++) {
+        length += format_u16(&Reply[length], EventCounts[source]);
+        Reply[length++] = ' ';
     }
+    length += format_u8(&Reply[length], events_dropped);
+    Reply[length++] = '\r';
+    Reply[length++] = '\n';
+    ReplyLength = length;
+    ReplySent = 0;
+    PIE1bits.TXIE = 1;
+}
 
-    INTCONbits.GIE = 1; // Enable global interrupts after processing
+// One byte per TXIF, TXIE goes on again while there is more
+static void send_reply(void) {
+    if (ReplySent != ReplyLength) {
+        TXREG = Reply[ReplySent++];
+        PIE1bits.TXIE = 1;
+    }
 }
+#endif
 
 void main() {
-    // Set up oscillator control register
-    OSCCONbits.SPLLEN = 0; // PLL is disabled
-    OSCCONbits.IRCF = 0x0F; // Set OSCCON IRCF bits to select OSC frequency=16Mhz
-    OSCCONbits.SCS = 0x02; // Set the SCS bits to select internal oscillator block
+    config_oscillator(); // Internal oscillator at _XTAL_FREQ
 
     ANSELA = 0x00; // Set all pins to digital
 
@@ -85,10 +256,60 @@ void main() {
     PORTA = 0x00; // Zero ALL the PORTA pins
     ADCON0 = 0; // ADC is off
 
-    INTCONbits.GIE = 1; // Enable global interrupts
+    PROFILER_INIT(); // Timer1, CCP1 on RA2 and TX on RA0, only with -DPROFILER
+#ifdef INTERRUPT_ALL_SOURCES
+    init_all_sources();
+#endif
+
+    // Timer0 from Fosc/4 with a 1:256 prescaler overflows every 16.384 ms
+    OPTION_REGbits.TMR0CS = 0;
+    OPTION_REGbits.PSA = 0;
+    OPTION_REGbits.PS = 0b111;
+
     INTCONbits.INTE = 1; // Enable external interrupts
     OPTION_REGbits.INTEDG = 1; // Interrupt on rising edge on RA2
+    INTCONbits.TMR0IE = 1;
+    INTCONbits.GIE = 1; // Enable global interrupts
 
+    event_t event;
+    uint8_t HeartbeatCount = 0;
     for (;;) {
+        PROFILE_DUMP();
+        if (!events_pop(&event)) {
+            NOP(); // Nothing to do until the next interrupt
+            continue;
+        }
+
+        PROFILE_BEGIN(PROFILE_EVENT);
+#ifdef INTERRUPT_ALL_SOURCES
+        EventCounts[event.source]++;
+#endif
+        switch (event.source) {
+            case EVENT_INT:
+                BUTTON_LED = ~BUTTON_LED;
+                break;
+            case EVENT_TMR0:
+                if (++HeartbeatCount == HEARTBEAT_TICKS) {
+                    HeartbeatCount = 0;
+                    LATAbits.LATA5 = ~LATAbits.LATA5;
+                }
+                break;
+#ifdef INTERRUPT_ALL_SOURCES
+            case EVENT_TMR2:
+                ADCON0bits.GO = 1;
+                break;
+            case EVENT_RX:
+                if (event.data == '?' && ReplySent == ReplyLength) {
+                    start_reply();
+                }
+                break;
+            case EVENT_TX_READY:
+                send_reply();
+                break;
+#endif
+            default:
+                break; // Not enabled in this sample
+        }
+        PROFILE_END(PROFILE_EVENT);
     }
 }
\ No newline at end of file
@@ -0,0 +1,182 @@
+//**********************************************************************************
+// Example program showing low power sampling on a PIC12F1822
+//
+// Device: PIC12F1822
+// Demo Board: PICkit 4
+// Compiler: Microchip XC8 v2.32
+// IDE: MPLAB X v5.45
+//
+// The other samples keep the core running all the time, in __delay_ms() or in a
+// loop that waits for the ADC. On a battery most of that current is wasted. This
+// one sleeps between two samples and only wakes up to take a reading:
+//      1. The watchdog wakes the core every 264 ms (1:8192 of the 31 kHz LFINTOSC).
+//      2. The ADC is switched on, and the conversion is started on its FRC clock,
+//         the only ADC clock that keeps running while the core sleeps.
+//      3. The core sleeps again during the conversion and ADIF wakes it up.
+//      4. The ADC is switched off again and the reading goes into a batch in RAM.
+// When 16 readings are together the EUSART is switched on, the batch is sent as one
+// line of numbers at 38400 baud and the EUSART is switched off again. So the serial
+// port draws current for about 17 ms every 4 seconds instead of all the time.
+// Global interrupts stay off while sampling. A wake-up continues right after
+// SLEEP(), and an ADIF that is set before SLEEP() turns it into a NOP, so the end
+// of a conversion can not be missed. They are only on while the batch is sent.
+// Build with -DLOWPOWER_TMR1 to wake on the Timer1 overflow instead. Timer1 then
+// runs from a 32.768 kHz watch crystal on RA4 and RA5, which is much more precise
+// than the watchdog, every 250 ms.
+// Run it in host/Simulator: sleep_percent_at_most,
+// adc_awake_us_per_sample_at_least, adc_on_percent and uart_on_percent in the
+// report show what a sample costs. benchmark.sh puts them next to the always on
+// loop of ../AnalogRead/analogRead.c.
+//**********************************************************************************
+//                                   PIC12F1822 Pinout for this example
+//                                   ----------
+//            5V Power source -> Vdd |1      8| GND
+//     Watch crystal for TMR1 -> RA5 |2      7| RA0 -> TX
+//     Watch crystal for TMR1 -> RA4 |3      6| RA1
+//                               RA3 |4      5| RA2 <- Sensor
+//                                   ----------
+//**********************************************************************************
+
+#include <xc.h>
+
+#pragma config FOSC = INTOSC    // Oscillator Selection (INTOSC oscillator: I/O function on CLKIN pin)
+#pragma config WDTE = SWDTEN    // Watchdog Timer Enable (WDT controlled by the SWDTEN bit in the WDTCON register)
+#pragma config PWRTE = OFF      // Power-up Timer Enable (PWRT disabled)
+#pragma config MCLRE = OFF      // MCLR Pin Function Select (MCLR/VPP pin function is digital input)
+#pragma config CP = OFF         // Flash Program Memory Code Protection (Program memory code protection is disabled)
+#pragma config CPD = OFF        // Data Memory Code Protection (Data memory code protection is disabled)
+#pragma config BOREN = OFF      // Brown-out Reset Enable (Brown-out Reset disabled)
+#pragma config CLKOUTEN = OFF   // Clock Out Enable (CLKOUT function is disabled. I/O or oscillator function on the CLKOUT pin)
+#pragma config IESO = OFF       // Internal/External Switchover (Internal/External Switchover mode is disabled)
+#pragma config FCMEN = OFF      // Fail-Safe Clock Monitor Enable (Fail-Safe Clock Monitor is disabled)
+
+// CONFIG2
+#pragma config WRT = OFF        // Flash Memory Self-Write Protection (Write protection off)
+#pragma config PLLEN = OFF      // PLL Enable (4x PLL disabled)
+#pragma config STVREN = ON      // Stack Overflow/Underflow Reset Enable (Stack Overflow or Underflow will cause a Reset)
+#pragma config BORV = LO        // Brown-out Reset Voltage Selection (Brown-out Reset Voltage (Vbor), low trip point selected.)
+#pragma config LVP = ON         // Low-Voltage Programming Enable (Low-voltage programming enabled)
+
+#include <xc.h> // Include standard header file
+
+// Definitions
+#define _XTAL_FREQ  4000000 // This is used by the __delay_ms(xx) and __delay_us(xx) functions
+
+#define CONFIG_BAUD 38400 // Short batches, less time awake
+#define CONFIG_ADC_FRC // Converts in SLEEP
+#include "../Config/config.h"
+#include "../UART/uart.h"
+#include "../Format/format.h"
+
+#define BATCH_SIZE 16 // Readings per line sent
+
+#define SAMPLE_WDTPS 0b01000 // Watchdog period 1:8192, 264 ms
+#define TIMER1_COUNTS 8192 // With LOWPOWER_TMR1, 250 ms of the crystal
+
+static uint16_t Batch[BATCH_SIZE];
+static uint8_t BatchCount;
+
+// Only runs while send_batch() has the interrupts on
+void __interrupt(high_priority) high_priority_interrupt(void) {
+    uart_isr(); // Move bytes from the ring buffer to the EUSART
+}
+
+// One conversion of AN2 with the core asleep. The ADC is off between two readings,
+// it draws more current than the sleeping core.
+uint16_t read_sensor(void) {
+    ADCON0bits.ADON = 1;
+    __delay_us(5); // The hold capacitor charges again after the ADC was off
+
+    PIR1bits.ADIF = 0;
+    PIE1bits.ADIE = 1;
+    ADCON0bits.GO = 1;
+    SLEEP(); // ADIF wakes the core, or SLEEP() is a NOP when it is already set
+    NOP(); // The instruction after SLEEP() is fetched before the core sleeps
+
+    PIE1bits.ADIE = 0;
+    PIR1bits.ADIF = 0;
+    ADCON0bits.ADON = 0;
+    return ADRES;
+}
+
+// Switches the EUSART on, sends the batch as one line of numbers and waits until
+// the last stop bit is out before it switches the EUSART off again. The core has
+// to stay awake, the EUSART runs from its clock.
+void send_batch(void) {
+    char Number[FORMAT_U16_SIZE];
+    uint8_t length;
+
+    RCSTAbits.SPEN = 1;
+    INTCONbits.GIE = 1;
+    for (uint8_t i = 0; i < BATCH_SIZE; i++) {
+        while (uart_tx_free() < FORMAT_U16_SIZE + 1) {
+            NOP(); // The interrupt routine drains the buffer
+        }
+        length = format_u16(Number, Batch[i]);
+        Number[length++] = i + 1 < BATCH_SIZE ? ' ' : '\r';
+        uart_write(Number, length);
+    }
+    while (uart_tx_free() < 1) {
+        NOP();
+    }
+    uart_write("\n", 1);
+
+    while (uart_tx_free() != UART_TX_BUFFER_SIZE || !TXSTAbits.TRMT) {
+        NOP();
+    }
+    INTCONbits.GIE = 0;
+    RCSTAbits.SPEN = 0; // TX goes back to LATA0, which holds the line idle high
+}
+
+void main(void) {
+    config_oscillator(); // 4 MHz Internal Oscillator
+
+    // Nothing to receive, so only the transmitter is set up and the port is off
+    // until there is a batch
+    uart_init();
+    RCSTAbits.CREN = 0;
+    PIE1bits.RCIE = 0;
+    RCSTAbits.SPEN = 0;
+    LATAbits.LATA0 = 1;
+
+    // The sensor on AN2 (RA2), right justified, on the FRC clock
+    TRISAbits.TRISA2 = 1;
+    ANSELAbits.ANSA2 = 1;
+    ADCON0bits.CHS = 0b00010;
+    ADCON1bits.ADCS = CONFIG_ADCS;
+    ADCON1bits.ADFM = 1;
+
+#ifdef LOWPOWER_TMR1
+    // Timer1 on the crystal, asynchronous so it keeps counting in SLEEP
+    T1CON = 0b10001100; // TMR1CS = 10, 1:1, T1OSCEN, nT1SYNC
+    TMR1H = (uint8_t) ((65536UL - TIMER1_COUNTS) >> 8);
+    TMR1L = 0;
+    PIR1bits.TMR1IF = 0;
+    PIE1bits.TMR1IE = 1;
+    T1CONbits.TMR1ON = 1;
+#else
+    // Floating inputs draw current, the unused pins are driven low
+    LATAbits.LATA4 = 0;
+    LATAbits.LATA5 = 0;
+    TRISAbits.TRISA4 = 0;
+    TRISAbits.TRISA5 = 0;
+
+    WDTCON = (SAMPLE_WDTPS << 1) | 1; // Watchdog on, SWDTEN
+#endif
+    INTCONbits.PEIE = 1; // The peripherals that wake the core are peripheral interrupts
+
+    for (;;) {
+        SLEEP(); // Until the watchdog or the Timer1 overflow
+        NOP();
+#ifdef LOWPOWER_TMR1
+        TMR1H = (uint8_t) ((65536UL - TIMER1_COUNTS) >> 8); // TMR1L is only a few counts past 0
+        PIR1bits.TMR1IF = 0;
+#endif
+
+        Batch[BatchCount++] = read_sensor();
+        if (BatchCount == BATCH_SIZE) {
+            send_batch();
+            BatchCount = 0;
+        }
+    }
+}
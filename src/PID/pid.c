@@ -0,0 +1,276 @@
+//**********************************************************************************
+// Example program showing a closed control loop on a PIC12F1822
+//
+// Device: PIC12F1822
+// Demo Board: PICkit 4
+// Compiler: Microchip XC8 v2.32
+// IDE: MPLAB X v5.45
+//
+// This program holds the voltage on RA4 at a setpoint by driving the PWM output
+// on RA2 through ../PID/pid.h. Connect RA2 to RA4 through an RC low pass (10 kOhm
+// and 10 uF) for a first try, or use the PWM to drive a heater or an LED and put
+// the sensor on RA4.
+// Every period of the PWM, 1953 times per second, the Timer2 interrupt takes the
+// ADC result of the last period, starts the next conversion, runs the PID and
+// writes the new duty cycle, which the PWM latches at the end of the period. So
+// the loop runs at a fixed rate and has to be done within one period of 4096
+// instruction cycles. The interrupt reads TMR2 when it is done, which is how far
+// into the period it got. On host/Simulator that is only a lower bound, it
+// charges the register accesses but not the arithmetic of pid_update(), so the
+// budget has to be checked with the S command on the chip.
+// Build with -DPID_DAC to drive the 5 bit DAC on RA0 instead, TX then moves to RA5.
+// Commands from PuTTY at 115200 baud, each followed by Enter:
+//      T<n>        setpoint in ADC counts, 0-1023
+//      P<n>        Kp, I<n> Ki and D<n> Kd, in 1/256, 0-32767
+//      S           longest loop time in TMR2 counts of 2 us, loop overruns and
+//                  updates that hit the upper and the lower output limit
+// Every 100 ms it sends "<setpoint> <measurement> <output>".
+//**********************************************************************************
+//                                   PIC12F1822 Pinout for this example
+//                                   ----------
+//            5V Power source -> Vdd |1      8| GND
+//                               RA5 |2      7| RA0 -> TX
+//    Measurement from the RC -> RA4 |3      6| RA1 -> RX
+//                               RA3 |4      5| RA2 -> PWM output to the RC
+//                                   ----------
+//**********************************************************************************
+
+#include <xc.h>
+
+#pragma config FOSC = INTOSC    // Oscillator Selection (INTOSC oscillator: I/O function on CLKIN pin)
+#pragma config WDTE = OFF       // Watchdog Timer Enable (WDT disabled)
+#pragma config PWRTE = OFF      // Power-up Timer Enable (PWRT disabled)
+#pragma config MCLRE = OFF      // MCLR Pin Function Select (MCLR/VPP pin function is digital input)
+#pragma config CP = OFF         // Flash Program Memory Code Protection (Program memory code protection is disabled)
+#pragma config CPD = OFF        // Data Memory Code Protection (Data memory code protection is disabled)
+#pragma config BOREN = OFF      // Brown-out Reset Enable (Brown-out Reset disabled)
+#pragma config CLKOUTEN = OFF   // Clock Out Enable (CLKOUT function is disabled. I/O or oscillator function on the CLKOUT pin)
+#pragma config IESO = OFF       // Internal/External Switchover (Internal/External Switchover mode is disabled)
+#pragma config FCMEN = OFF      // Fail-Safe Clock Monitor Enable (Fail-Safe Clock Monitor is disabled)
+
+// CONFIG2
+#pragma config WRT = OFF        // Flash Memory Self-Write Protection (Write protection off)
+#pragma config PLLEN = OFF      // PLL Enable (4x PLL disabled)
+#pragma config STVREN = ON      // Stack Overflow/Underflow Reset Enable (Stack Overflow or Underflow will cause a Reset)
+#pragma config BORV = LO        // Brown-out Reset Voltage Selection (Brown-out Reset Voltage (Vbor), low trip point selected.)
+#pragma config LVP = ON         // Low-Voltage Programming Enable (Low-voltage programming enabled)
+
+#include <xc.h> // Include standard header file
+#include <stdint.h>
+
+// Definitions
+#define _XTAL_FREQ  32000000 // This is used by the __delay_ms(xx) and __delay_us(xx) functions
+
+#define CONFIG_BAUD 115200
+#define CONFIG_PWM_HZ 1953 // PR2 = 255 with a 1:16 prescaler, 10 bits of duty cycle
+#define CONFIG_ADC
+#include "../Config/config.h"
+#include "../UART/uart.h"
+#include "../Format/format.h"
+#include "pid.h"
+
+#ifdef PID_DAC
+#define OUTPUT_MAX  31
+#else
+#define OUTPUT_MAX  1023
+#endif
+
+#define REPORT_PERIODS 195 // About 100 ms
+
+static pid_controller_t Pid;
+static volatile int16_t Setpoint = 512;
+static volatile int16_t Measurement;
+static volatile int16_t Output;
+
+static volatile uint8_t LoopCountsMax; // Of TMR2 when the loop was done
+static volatile uint8_t LoopOverruns; // Periods the loop did not finish in, stops at 255
+static volatile uint8_t ReportDue;
+static uint8_t ReportPeriods;
+
+static uint16_t Line[4]; // Numbers of the line send_line() is sending
+static uint8_t LineCount;
+static uint8_t LineSent;
+static uint8_t StatsDue;
+
+static const char ReplyOk[] = "OK\r\n";
+static const char ReplyError[] = "ERR\r\n";
+
+// The whole loop runs in here, at the start of a PWM period
+void control_loop(void) {
+    Measurement = (int16_t) ADRES; // Started at the end of the last period
+    ADCON0bits.GO = 1;
+
+    Output = pid_update(&Pid, Setpoint, Measurement);
+#ifdef PID_DAC
+    DACCON1bits.DACR = (uint8_t) Output;
+#else
+    CCPR1L = (uint8_t) (Output >> 2);
+    CCP1CONbits.DC1B = (uint8_t) Output & 0x03;
+#endif
+
+    if (++ReportPeriods == REPORT_PERIODS) {
+        ReportPeriods = 0;
+        ReportDue = 1;
+    }
+
+    // TMR2 started at 0 with the period, a new TMR2IF means the next one began
+    uint8_t counts = TMR2;
+    if (PIR1bits.TMR2IF) {
+        if (LoopOverruns != 255) {
+            LoopOverruns++;
+        }
+    } else if (counts > LoopCountsMax) {
+        LoopCountsMax = counts;
+    }
+}
+
+void __interrupt(high_priority) high_priority_interrupt(void) {
+    if (PIE1bits.TMR2IE && PIR1bits.TMR2IF) {
+        PIR1bits.TMR2IF = 0;
+        control_loop();
+    }
+    uart_isr(); // Move bytes between the EUSART and the ring buffers
+}
+
+// Sends the numbers in Line one at a time as the transmit buffer makes room, a
+// whole line does not fit in it
+void send_line(void) {
+    char Number[FORMAT_U16_SIZE];
+    uint8_t length;
+
+    if (LineCount == 0 || uart_tx_free() < FORMAT_U16_SIZE + 1) {
+        return;
+    }
+    length = format_u16(Number, Line[LineSent]);
+    uart_write(Number, length);
+    if (++LineSent < LineCount) {
+        uart_write(" ", 1);
+    } else {
+        uart_write("\r\n", 2);
+        LineCount = 0;
+    }
+}
+
+// The interrupt routine uses Pid, so it is off while a gain changes
+void set_gain(int16_t *gain, uint16_t value) {
+    PIE1bits.TMR2IE = 0;
+    *gain = (int16_t) value;
+    PIE1bits.TMR2IE = 1;
+}
+
+// Runs the command line that uart_read_line() just completed
+void process_command(void) {
+    uint16_t value;
+    uint8_t ok = uart_parse_number(&uart_line[1], &value) && value <= 32767;
+
+    switch (uart_line[0]) {
+        case 'T':
+            ok = ok && value <= 1023;
+            if (ok) {
+                Setpoint = (int16_t) value; // A single write the interrupt sees whole or not at all
+            }
+            break;
+        case 'P':
+            if (ok) {
+                set_gain(&Pid.kp, value);
+            }
+            break;
+        case 'I':
+            if (ok) {
+                set_gain(&Pid.ki, value);
+            }
+            break;
+        case 'D':
+            if (ok) {
+                set_gain(&Pid.kd, value);
+            }
+            break;
+        case 'S':
+            if (uart_line[1] == '\0') {
+                StatsDue = 1;
+                return;
+            }
+            ok = 0;
+            break;
+        default:
+            ok = 0;
+            break;
+    }
+
+    if (ok) {
+        uart_write(ReplyOk, sizeof ReplyOk - 1);
+    } else {
+        uart_write(ReplyError, sizeof ReplyError - 1);
+    }
+}
+
+void main(void) {
+    config_oscillator(); // 8 MHz Internal Oscillator through the PLL gives 32 MHz
+
+    uart_init();
+#ifdef PID_DAC
+    APFCONbits.TXCKSEL = 1; // TX on RA5, RA0 is the DAC output
+    TRISAbits.TRISA5 = 0;
+    TRISAbits.TRISA0 = 1;
+    DACCON0bits.DACPSS = 0b00; // From 0 to Vdd
+    DACCON0bits.DACOE = 1;
+    DACCON0bits.DACEN = 1;
+#endif
+
+    // Measurement on AN3 (RA4), right justified
+    TRISAbits.TRISA4 = 1;
+    ANSELAbits.ANSA4 = 1;
+    ADCON0bits.CHS = 0b00011;
+    ADCON1bits.ADCS = CONFIG_ADCS;
+    ADCON1bits.ADFM = 1;
+    ADCON0bits.ADON = 1;
+    ADCON0bits.GO = 1; // The first result for the first loop
+
+    // Kp 2, Ki 1/32 per period and no Kd are a start for an RC of 100 ms
+    pid_init(&Pid, PID_GAIN(2), PID_GAIN(1.0 / 32), 0, 0, OUTPUT_MAX);
+
+    // Timer2 sets the rate of the loop, and drives the PWM on RA2 unless the DAC
+    // is the output
+#ifndef PID_DAC
+    TRISAbits.TRISA2 = 0;
+    APFCONbits.CCP1SEL = 0; // P1A on RA2
+    CCP1CON = 0b00001100; // PWM mode, single output on P1A, active high
+#endif
+    CCPR1L = 0;
+    PR2 = (uint8_t) PWM_PR2;
+    T2CONbits.T2CKPS = PWM_T2CKPS;
+    PIR1bits.TMR2IF = 0;
+    PIE1bits.TMR2IE = 1;
+    T2CONbits.TMR2ON = 1;
+
+    INTCONbits.PEIE = 1;
+    INTCONbits.GIE = 1;
+
+    for (;;) {
+        if (uart_read_line() != 0) {
+            process_command();
+        }
+        if (StatsDue && LineCount == 0) {
+            StatsDue = 0;
+            PIE1bits.TMR2IE = 0;
+            Line[0] = LoopCountsMax;
+            Line[1] = LoopOverruns;
+            Line[2] = Pid.saturated_high;
+            Line[3] = Pid.saturated_low;
+            PIE1bits.TMR2IE = 1;
+            LineCount = 4;
+            LineSent = 0;
+        } else if (ReportDue && LineCount == 0) {
+            ReportDue = 0;
+            PIE1bits.TMR2IE = 0; // The three from the same update
+            Line[0] = (uint16_t) Setpoint;
+            Line[1] = (uint16_t) Measurement;
+            Line[2] = (uint16_t) Output;
+            PIE1bits.TMR2IE = 1;
+            LineCount = 3;
+            LineSent = 0;
+        }
+        send_line();
+        NOP(); // Nothing else to do, the interrupt runs the loop
+    }
+}
@@ -0,0 +1,106 @@
+//**********************************************************************************
+// Fixed point PID controller for the PIC12F1822
+//
+// Device: PIC12F1822
+// Compiler: Microchip XC8 v2.32
+//
+// The gains are Q8.8: 256 is a gain of 1, so the controller can use gains from
+// 1/256 to 127 without floating point. The setpoint and the measurement are in
+// ADC counts, the output in whatever unit the sample drives, for example the 10
+// bit duty cycle of CCP1 or the 5 bit DAC. Internally the terms are kept in Q8.8
+// of the output so the integral does not lose the small errors.
+//
+//      output = Kp x error + sum of Ki x error - Kd x change of the measurement
+//
+// The derivative works on the measurement instead of the error, so a step of
+// the setpoint does not kick the output.
+//
+// Anti-windup: the integral is clamped to the output range, and while the output
+// is saturated it only integrates errors that pull the output back into range.
+// Without that a long saturation fills the integral up and the output overshoots
+// for a long time once the error changes sign.
+//
+// saturated_high and saturated_low count the updates that hit the limits. They
+// stop at 65535, a sample can clear them after reading.
+//**********************************************************************************
+
+#ifndef PID_H
+#define PID_H
+
+#include <stdint.h>
+
+#define PID_GAIN(x)     ((int16_t) ((x) * 256)) // For constants, PID_GAIN(0.5) is 128
+
+typedef struct {
+    int16_t kp; // Q8.8
+    int16_t ki; // Q8.8 per update
+    int16_t kd; // Q8.8 x updates
+    int16_t out_min;
+    int16_t out_max;
+    int32_t integral; // Q8.8 of the output
+    int16_t last_measurement;
+    uint8_t started;
+    uint16_t saturated_high;
+    uint16_t saturated_low;
+} pid_controller_t;
+
+static inline void pid_init(pid_controller_t *pid, int16_t kp, int16_t ki, int16_t kd, int16_t out_min, int16_t out_max) {
+    pid->kp = kp;
+    pid->ki = ki;
+    pid->kd = kd;
+    pid->out_min = out_min;
+    pid->out_max = out_max;
+    pid->integral = 0;
+    pid->started = 0;
+    pid->saturated_high = 0;
+    pid->saturated_low = 0;
+}
+
+// One step of the controller, call it at a fixed rate
+static inline int16_t pid_update(pid_controller_t *pid, int16_t setpoint, int16_t measurement) {
+    int16_t error = setpoint - measurement;
+    int32_t high = (int32_t) pid->out_max << 8;
+    int32_t low = (int32_t) pid->out_min << 8;
+    int32_t integral = pid->integral + (int32_t) pid->ki * error;
+    int32_t sum = (int32_t) pid->kp * error;
+
+    if (integral > high) {
+        integral = high;
+    } else if (integral < low) {
+        integral = low;
+    }
+
+    // No derivative on the first update, there is no previous measurement yet
+    if (pid->started) {
+        sum -= (int32_t) pid->kd * (int16_t) (measurement - pid->last_measurement);
+    }
+    pid->last_measurement = measurement;
+    pid->started = 1;
+
+    sum += integral;
+    if (sum > high) {
+        if (error > 0) {
+            integral = pid->integral; // Would only push further out of range
+        }
+        pid->integral = integral;
+        if (pid->saturated_high != 0xFFFF) {
+            pid->saturated_high++;
+        }
+        return pid->out_max;
+    }
+    if (sum < low) {
+        if (error < 0) {
+            integral = pid->integral;
+        }
+        pid->integral = integral;
+        if (pid->saturated_low != 0xFFFF) {
+            pid->saturated_low++;
+        }
+        return pid->out_min;
+    }
+
+    pid->integral = integral;
+    return (int16_t) (sum >> 8);
+}
+
+#endif
@@ -1,5 +1,5 @@
 //**********************************************************************************
-// Example program showing how to handle interrupts on a PIC12F1822
+// Example program showing how to generate a PWM signal on a PIC12F1822
 //
 // Device: PIC12F1822
 // Demo Board: PICkit 4
@@ -7,13 +7,17 @@
 // IDE: MPLAB X v5.45
 // Created: 19 June 2021
 //
-// This program shows how to generate simple PWM signal.
+// This program fades an LED or a motor up and down with the full 10 bits of duty
+// cycle that ../PWM/pwm.h gives at 31.25 kHz, one step every 2 ms. After every
+// fade the output moves to the other pin with the steering of the CCP module.
+// Define HALF_BRIDGE to drive a half bridge instead: P1A and its complement on
+// P1B, with 500 ns of dead band between them, at 20 kHz.
 //**********************************************************************************
 //                                   PIC12F1822 Pinout for this example
 //                                   ----------
 //          3.3V Power source -> Vdd |1      8| GND
-//                 PWM output <- RA5 |2      7| RA0
-//                               RA4 |3      6| RA1
+//             PWM output P1A <- RA5 |2      7| RA0
+//             PWM output P1B <- RA4 |3      6| RA1
 //                               RA3 |4      5| RA2
 //                                   ----------
 //**********************************************************************************
@@ -39,38 +43,74 @@
 #pragma config LVP = ON    // Low-Voltage Programming Enable (Low-voltage programming enabled)
 
 #include <xc.h> // Include standard header file
+#include <stdint.h>
 
-int main()
+// Definitions
+#define _XTAL_FREQ  32000000 // This is used by the __delay_ms(xx) and __delay_us(xx) functions
+
+#ifdef HALF_BRIDGE
+#define CONFIG_PWM_HZ       20000
+#define DEAD_BAND_CYCLES    4 // 4 x 125 ns
+#else
+#define CONFIG_PWM_HZ       31250 // PR2 = 255, all 1024 steps of duty cycle
+#endif
+
+#include "../Config/config.h"
+#include "pwm.h"
+
+void __interrupt(high_priority) high_priority_interrupt(void)
 {
-    //
-    // 8 MHz Internal Oscillator so that PLL will give 32 MHz
-    //
-    OSCCONbits.IRCF = 0b1110;
-    OSCCONbits.SPLLEN = 1;
+    pwm_isr(); // Writes new duty cycles and periods at the start of a period
+}
 
-    // With 32 MHz system clock, PWM frame frequency will be 32 MHz/4/256 = 31.25 kHz
-    PR2 = 0xFF;
+// Goes through every step from off to fully on and back
+void fade(void)
+{
+    uint16_t duty = 0;
 
-    // PWM mode: P1A, P1B active-high
-    CCP1CONbits.CCP1M = 0b1100;
+    while (duty < pwm_period_steps)
+    {
+        pwm_set_duty(duty++);
+        __delay_ms(2);
+    }
+    while (duty != 0)
+    {
+        pwm_set_duty(--duty);
+        __delay_ms(2);
+    }
+}
 
-    // Duty Cycle = 0.25
-    CCPR1L = 0x40;
+int main()
+{
+    config_oscillator(); // 8 MHz Internal Oscillator through the PLL gives 32 MHz
 
-    // PWM P1A Output is on RA5 (Pin 2 of the DIP-8)
-    TRISAbits.TRISA5 = 0;
+    // P1A is on RA5 and P1B on RA4 (Pins 2 and 3 of the DIP-8)
     APFCONbits.CCP1SEL = 1;
+    APFCONbits.P1BSEL = 1;
+    ANSELAbits.ANSA4 = 0;
+    TRISAbits.TRISA5 = 0;
+    TRISAbits.TRISA4 = 0;
+    LATAbits.LATA4 = 0; // Whichever pin is not steered stays low
+    LATAbits.LATA5 = 0;
+
+    pwm_init(); // At CONFIG_PWM_HZ
+#ifdef HALF_BRIDGE
+    pwm_half_bridge(DEAD_BAND_CYCLES);
+#endif
 
-    PIR1bits.TMR2IF = 0;
-    // Leave prescale, postscale = 1:1, turn on the timer
-    T2CONbits.TMR2ON = 1;
+    INTCONbits.PEIE = 1;
+    INTCONbits.GIE = 1;
 
-    // The initialize function did not set the steering bit.
-    // This can be set or cleared to enable or disable
-    // the PWM P1A output
-    PSTR1CONbits.STR1A = 1;
+#ifndef HALF_BRIDGE
+    uint8_t output = PWM_P1A;
+#endif
 
     while (1)
     {
+        fade();
+#ifndef HALF_BRIDGE
+        output ^= PWM_P1A | PWM_P1B;
+        pwm_steer(output);
+#endif
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,163 @@
+//**********************************************************************************
+// PWM driver for the CCP1 module of the PIC12F1822
+//
+// Device: PIC12F1822
+// Compiler: Microchip XC8 v2.32
+//
+// The duty cycle has 10 bits: the upper 8 in CCPR1L and the lower 2 in
+// CCP1CONbits.DC1B. The module latches both at the end of a Timer2 period, but
+// they are written one after the other, so when the period ends between the two
+// writes one pulse comes out with the new upper and the old lower bits. PR2 is not
+// latched at all, a value below the running count of TMR2 stretches the period to
+// a full 256 counts. Both make a runt or a long pulse, which a motor hears.
+//
+// pwm_set_duty() and pwm_set_frequency() therefore only store the new values and
+// enable the Timer2 interrupt. pwm_isr() writes them right after the next period
+// has started, when TMR2 is close to 0 and the whole period is left before the
+// next latch, and switches the interrupt off again until the next update.
+//
+// The duty cycle is counted in steps of Fosc, 4 per count of Timer2, so a period
+// is pwm_period_steps steps long and a duty cycle of pwm_period_steps or more
+// keeps the output on. With PR2 = 255 and a 1:1 prescaler that is the full 1024
+// steps at _XTAL_FREQ / 1024, 31.25 kHz at 32 MHz; there 1023 is the most, 10
+// bits cannot hold 1024. A higher frequency gives fewer steps.
+//
+// The sample must define _XTAL_FREQ, call pwm_isr() from its interrupt routine
+// and set INTCONbits.PEIE and INTCONbits.GIE after pwm_init(). It also selects
+// the pins with APFCON and makes them outputs. Timer2 belongs to the PWM.
+//**********************************************************************************
+
+#ifndef PWM_H
+#define PWM_H
+
+#include <xc.h>
+#include <stdint.h>
+
+// Period after pwm_init(), _XTAL_FREQ / 1024 by default. ../Config/config.h
+// works them out from CONFIG_PWM_HZ.
+#ifndef PWM_PR2
+#define PWM_PR2     0xFF
+#endif
+
+#ifndef PWM_T2CKPS
+#define PWM_T2CKPS  0b00 // 1:1
+#endif
+
+// Outputs for pwm_steer(), the pins depend on APFCONbits.CCP1SEL and P1BSEL
+#define PWM_P1A     0x01
+#define PWM_P1B     0x02
+
+// What pwm_isr() still has to write
+#define PWM_UPDATE_DUTY     0x01
+#define PWM_UPDATE_PERIOD   0x02
+
+static uint16_t pwm_period_steps = 4 * (PWM_PR2 + 1);
+
+static volatile uint8_t pwm_update;
+static uint16_t pwm_next_duty;
+static uint8_t pwm_next_pr2;
+static uint8_t pwm_next_prescale;
+
+// Single output on P1A, active high, 0% duty
+static inline void pwm_init(void) {
+    CCP1CON = 0b00001100; // PWM mode, P1M = 00 single output, P1A and P1B active high
+    CCPR1L = 0;
+    PR2 = (uint8_t) PWM_PR2;
+    PSTR1CON = PWM_P1A;
+
+    T2CONbits.T2CKPS = PWM_T2CKPS;
+    T2CONbits.T2OUTPS = 0; // 1:1, TMR2IF at the end of every period
+    PIR1bits.TMR2IF = 0;
+    T2CONbits.TMR2ON = 1;
+}
+
+// Takes the pending values, only the interrupt routine writes the registers
+static inline void pwm_queue(void) {
+    PIR1bits.TMR2IF = 0; // Wait for the next period, not one that already ended
+    PIE1bits.TMR2IE = 1;
+}
+
+// Duty cycle in steps of Fosc, see pwm_period_steps
+static inline void pwm_set_duty(uint16_t duty) {
+    if (duty > 1023) {
+        duty = 1023;
+    }
+    PIE1bits.TMR2IE = 0; // pwm_isr() must not see half of the new value
+    pwm_next_duty = duty;
+    pwm_update |= PWM_UPDATE_DUTY;
+    pwm_queue();
+}
+
+// Picks the smallest prescaler that fits the period into 256 counts, for the
+// finest duty cycle. This divides once, so call it when the frequency changes,
+// not on every update. Returns 0 and changes nothing when hz is out of range:
+// from _XTAL_FREQ / 65536 up to _XTAL_FREQ / 8, where only 8 steps are left.
+static inline uint8_t pwm_set_frequency(uint32_t hz) {
+    uint32_t counts; // Of Timer2 per period at 1:1
+    uint8_t prescale = 0;
+
+    if (hz == 0) {
+        return 0;
+    }
+    counts = (_XTAL_FREQ / 4 + hz / 2) / hz;
+
+    // The prescaler goes 1, 4, 16, 64
+    while (counts > 256) {
+        if (prescale == 0b11) {
+            return 0;
+        }
+        counts = (counts + 2) >> 2;
+        prescale++;
+    }
+    if (counts < 2) {
+        return 0;
+    }
+
+    PIE1bits.TMR2IE = 0;
+    pwm_next_pr2 = (uint8_t) (counts - 1);
+    pwm_next_prescale = prescale;
+    pwm_period_steps = (uint16_t) (counts << 2);
+    pwm_update |= PWM_UPDATE_PERIOD;
+    pwm_queue();
+    return 1;
+}
+
+// Selects which of P1A and P1B carry the single output, any mix of PWM_P1A and
+// PWM_P1B or 0 for none. The pins that are not steered go back to their port
+// value. STR1SYNC makes the change at the start of the next period.
+static inline void pwm_steer(uint8_t outputs) {
+    PSTR1CON = 0x10 | (outputs & (PWM_P1A | PWM_P1B));
+}
+
+// Half bridge: P1A carries the duty cycle and P1B its complement. The dead band
+// delays the rising edge of each output by dead_band cycles of Fosc / 4 (0-127),
+// so the two transistors of the bridge are never on at the same time.
+static inline void pwm_half_bridge(uint8_t dead_band) {
+    PWM1CON = dead_band & 0x7F; // P1RSEN = 0, no auto-restart after a shutdown
+    CCP1CONbits.P1M = 0b10;
+}
+
+// Back to a single output, steered by pwm_steer()
+static inline void pwm_single(void) {
+    CCP1CONbits.P1M = 0b00;
+    PWM1CON = 0;
+}
+
+static inline void pwm_isr(void) {
+    if (PIE1bits.TMR2IE && PIR1bits.TMR2IF) {
+        PIR1bits.TMR2IF = 0;
+        PIE1bits.TMR2IE = 0; // Until the next update
+
+        if (pwm_update & PWM_UPDATE_PERIOD) {
+            PR2 = pwm_next_pr2;
+            T2CONbits.T2CKPS = pwm_next_prescale;
+        }
+        if (pwm_update & PWM_UPDATE_DUTY) {
+            CCPR1L = (uint8_t) (pwm_next_duty >> 2);
+            CCP1CONbits.DC1B = pwm_next_duty & 0x03;
+        }
+        pwm_update = 0;
+    }
+}
+
+#endif
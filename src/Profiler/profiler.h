@@ -0,0 +1,251 @@
+//**********************************************************************************
+// Cycle profiler for the PIC12F1822 samples
+//
+// Device: PIC12F1822
+// Compiler: Microchip XC8 v2.32
+//
+// Shows where the instruction cycles go on the chip itself. PROFILE_BEGIN() and
+// PROFILE_END() around a piece of code read Timer1, which runs free from Fosc/4,
+// and keep the number of runs and the shortest, longest and total time of every
+// region in a small table. What the two reads of Timer1 cost is measured once at
+// startup and taken off every run. A region includes the interrupts that hit it.
+//
+// Region 0 is the interrupt latency. CCP1 captures Timer1 on the rising edge of
+// RA2, which is also the INT pin, and PROFILE_ISR_BEGIN() at the top of the
+// interrupt routine compares that with the time the routine got there: the
+// context save, the instruction that was running and any handler the edge had to
+// wait for. Set OPTION_REGbits.INTEDG to match PROFILER_LATENCY_EDGE.
+//
+// Every PROFILER_DUMP_MS profiler_dump() sends one TELEMETRY_TYPE_PROFILE frame
+// of ../Telemetry/telemetry.h per region and clears the region, so each frame
+// covers the time since the one before. The bytes go out on TX (RA0) one at a
+// time whenever the main loop finds TXREG empty; the profiler adds no interrupt
+// of its own to the program it measures. host/TelemetryDecoder prints the frames.
+//
+// Nothing of this is compiled unless PROFILER is defined (-DPROFILER, or in the
+// project properties). Without it the macros are empty and the image is the same
+// as the one of the sample without them.
+//
+// The sample defines PROFILER_REGIONS, region 0 included, before it includes
+// this file, numbers its regions from PROFILER_FIRST_REGION and defines
+// CONFIG_BAUD before ../Config/config.h. PROFILE_BEGIN() declares the start
+// time, so it goes where a declaration may go, with PROFILE_END() in the same
+// block. The sample calls PROFILER_INIT() after setting up its pins and
+// PROFILE_DUMP() from its main loop. Timer1, CCP1 and the EUSART transmitter
+// belong to the profiler, the receiver stays off.
+//**********************************************************************************
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#define PROFILER_LATENCY        0 // Region of the interrupt latency
+#define PROFILER_FIRST_REGION   1
+
+#ifdef PROFILER
+
+#include <xc.h>
+#include <stdint.h>
+
+#ifndef PROFILER_REGIONS
+#define PROFILER_REGIONS 1
+#endif
+
+#if PROFILER_REGIONS < 1 || PROFILER_REGIONS > 8
+#error "PROFILER_REGIONS must be between 1 and 8"
+#endif
+
+// Timer1 prescaler, 1:1 to 1:8 as 0-3. Times are in Timer1 counts of
+// 2^PROFILER_T1CKPS cycles and a region must be shorter than 65536 of them.
+#ifndef PROFILER_T1CKPS
+#define PROFILER_T1CKPS 0
+#endif
+
+#if PROFILER_T1CKPS < 0 || PROFILER_T1CKPS > 3
+#error "PROFILER_T1CKPS must be between 0 and 3"
+#endif
+
+// CCP1 capture mode for the latency probe, 0b0101 rising and 0b0100 falling edge
+#ifndef PROFILER_LATENCY_EDGE
+#define PROFILER_LATENCY_EDGE 0b0101
+#endif
+
+#ifndef PROFILER_DUMP_MS
+#define PROFILER_DUMP_MS 1000
+#endif
+
+// The dump is paced by the Timer1 overflows, polled from the main loop
+#define PROFILER_DUMP_OVERFLOWS (PROFILER_DUMP_MS * (_XTAL_FREQ / 4000UL) / (65536UL << PROFILER_T1CKPS))
+
+#if PROFILER_DUMP_OVERFLOWS < 1 || PROFILER_DUMP_OVERFLOWS > 255
+#error "PROFILER_DUMP_MS is out of reach of the Timer1 overflows at this clock"
+#endif
+
+#ifndef UART_SPBRG
+#error "Define CONFIG_BAUD before including ../Config/config.h, the profiler sends at that rate"
+#endif
+
+// A frame has 5 values, a smaller buffer is enough
+#ifndef TELEMETRY_MAX_VALUES
+#define TELEMETRY_MAX_VALUES 5
+#endif
+
+#include "../Telemetry/telemetry.h"
+
+#if TELEMETRY_MAX_VALUES < 5
+#error "The profiler needs TELEMETRY_MAX_VALUES of at least 5"
+#endif
+
+typedef struct {
+    uint16_t count; // Stops at 65535 so the total stays the sum of counted runs
+    uint16_t min;
+    uint16_t max;
+    uint32_t total;
+} profiler_region_t;
+
+static profiler_region_t profiler_regions[PROFILER_REGIONS];
+static uint16_t profiler_overhead; // Timer1 counts of an empty region
+static uint8_t profiler_overflows;
+static uint8_t profiler_next = PROFILER_REGIONS; // Region to send next, PROFILER_REGIONS when done
+static uint8_t profiler_length; // Of the frame in telemetry_buffer
+static uint8_t profiler_sent;
+
+// TMR1H may tick over between the two reads, then read both again
+static inline uint16_t profiler_now(void) {
+    uint8_t high;
+    uint8_t low;
+
+    do {
+        high = TMR1H;
+        low = TMR1L;
+    } while (high != TMR1H);
+    return ((uint16_t) high << 8) | low;
+}
+
+static inline uint16_t profiler_elapsed(uint16_t start) {
+    return profiler_now() - start;
+}
+
+static inline void profiler_record(uint8_t region, uint16_t time) {
+    profiler_region_t *stats = &profiler_regions[region];
+
+    if (stats->count == 0xFFFF) {
+        return;
+    }
+    if (stats->count == 0 || time < stats->min) {
+        stats->min = time;
+    }
+    if (time > stats->max) {
+        stats->max = time;
+    }
+    stats->total += time;
+    stats->count++;
+}
+
+static inline void profiler_end(uint8_t region, uint16_t start) {
+    uint16_t time = profiler_elapsed(start);
+
+    profiler_record(region, time > profiler_overhead ? time - profiler_overhead : 0);
+}
+
+// First thing in the interrupt routine. Records the latency when an edge was
+// captured since the last entry and returns the entry time.
+static inline uint16_t profiler_isr_entry(void) {
+    uint16_t now = profiler_now();
+
+    if (PIR1bits.CCP1IF) {
+        PIR1bits.CCP1IF = 0;
+        profiler_record(PROFILER_LATENCY, now - CCPR1);
+    }
+    return now;
+}
+
+static inline void profiler_init(void) {
+    T1CON = 0; // Fosc/4, no gate
+    T1GCON = 0;
+    T1CONbits.T1CKPS = PROFILER_T1CKPS;
+    T1CONbits.TMR1ON = 1;
+    PIR1bits.TMR1IF = 0; // Polled, TMR1IE stays off
+
+    APFCONbits.CCP1SEL = 0; // CCP1 on RA2
+    TRISAbits.TRISA2 = 1;
+    CCP1CON = PROFILER_LATENCY_EDGE;
+    PIR1bits.CCP1IF = 0; // Polled by profiler_isr_entry(), CCP1IE stays off
+
+    SPBRGH = UART_SPBRG >> 8;
+    SPBRGL = UART_SPBRG & 0xFF;
+    APFCONbits.TXCKSEL = 0; // TX on RA0
+    ANSELAbits.ANSA0 = 0;
+    TRISAbits.TRISA0 = 0;
+    BAUDCONbits.BRG16 = 1;
+    TXSTAbits.BRGH = 1;
+    TXSTAbits.SYNC = 0;
+    TXSTAbits.TXEN = 1;
+    RCSTAbits.CREN = 0;
+    RCSTAbits.SPEN = 1;
+
+    profiler_overhead = profiler_elapsed(profiler_now());
+}
+
+// Call this from the main loop as often as possible
+static inline void profiler_dump(void) {
+    if (PIR1bits.TMR1IF) {
+        PIR1bits.TMR1IF = 0;
+        if (++profiler_overflows == PROFILER_DUMP_OVERFLOWS) {
+            profiler_overflows = 0;
+            if (profiler_next == PROFILER_REGIONS) {
+                profiler_next = 0; // Skipped while the last dump is still going
+            }
+        }
+    }
+
+    if (profiler_sent != profiler_length) {
+        if (PIR1bits.TXIF) {
+            TXREG = telemetry_buffer[profiler_sent++];
+        }
+        return;
+    }
+    if (profiler_next == PROFILER_REGIONS) {
+        return;
+    }
+
+    // Take the region and clear it in one go, the interrupt routine may record
+    // to it. The few cycles with GIE off show up in the latency.
+    profiler_region_t stats;
+    uint8_t gie = INTCONbits.GIE;
+
+    INTCONbits.GIE = 0;
+    stats = profiler_regions[profiler_next];
+    profiler_regions[profiler_next].count = 0;
+    profiler_regions[profiler_next].max = 0;
+    profiler_regions[profiler_next].total = 0;
+    INTCONbits.GIE = gie;
+
+    uint16_t values[5];
+
+    values[0] = stats.count;
+    values[1] = stats.count != 0 ? stats.min : 0;
+    values[2] = stats.max;
+    values[3] = (uint16_t) stats.total;
+    values[4] = (uint16_t) (stats.total >> 16);
+    profiler_length = telemetry_build(TELEMETRY_TYPE_PROFILE, profiler_next, values, 5);
+    profiler_sent = 0;
+    profiler_next++;
+}
+
+#define PROFILER_INIT()             profiler_init()
+#define PROFILE_BEGIN(region)       uint16_t profiler_start_##region = profiler_now()
+#define PROFILE_END(region)         profiler_end(region, profiler_start_##region)
+#define PROFILE_ISR_BEGIN(region)   uint16_t profiler_start_##region = profiler_isr_entry()
+#define PROFILE_DUMP()              profiler_dump()
+
+#else
+
+#define PROFILER_INIT()
+#define PROFILE_BEGIN(region)
+#define PROFILE_END(region)
+#define PROFILE_ISR_BEGIN(region)
+#define PROFILE_DUMP()
+
+#endif
+
+#endif
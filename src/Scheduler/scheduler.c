@@ -0,0 +1,201 @@
+//**********************************************************************************
+// Example program showing several jobs sharing a PIC12F1822 with a scheduler
+//
+// Device: PIC12F1822
+// Demo Board: PICkit 4
+// Compiler: Microchip XC8 v2.32
+// IDE: MPLAB X v5.45
+//
+// The other samples each do one thing in a loop around __delay_ms(). This one
+// runs five jobs side by side from the task table of scheduler.h, in the order
+// of Tasks[], which is their priority:
+//      adc_task        every 10 ms, reads the potentiometer on RA4
+//      button_task     every 10 ms, debounces the button on RA5
+//      pwm_task        every 20 ms, sets the LED brightness on RA2 from the reading
+//      command_task    every 10 ms, reads commands from the PC
+//      report_task     every second, sends the reading and the duty cycle to the PC
+// The button switches the LED on and off. None of the tasks waits for anything,
+// each one checks its hardware and returns.
+// Send S and Enter from PuTTY to get the longest run time in microseconds and the
+// number of overruns of every task, one line per task.
+//**********************************************************************************
+//                                   PIC12F1822 Pinout for this example
+//                                   ----------
+//            5V Power source -> Vdd |1      8| GND
+//                     Button -> RA5 |2      7| RA0 -> TX
+//        Potentiometer wiper -> RA4 |3      6| RA1 -> RX
+//                               RA3 |4      5| RA2 -> LED, PWM output
+//                                   ----------
+//**********************************************************************************
+
+#include <xc.h>
+
+#pragma config FOSC = INTOSC    // Oscillator Selection (INTOSC oscillator: I/O function on CLKIN pin)
+#pragma config WDTE = OFF       // Watchdog Timer Enable (WDT disabled)
+#pragma config PWRTE = OFF      // Power-up Timer Enable (PWRT disabled)
+#pragma config MCLRE = OFF      // MCLR Pin Function Select (MCLR/VPP pin function is digital input)
+#pragma config CP = OFF         // Flash Program Memory Code Protection (Program memory code protection is disabled)
+#pragma config CPD = OFF        // Data Memory Code Protection (Data memory code protection is disabled)
+#pragma config BOREN = OFF      // Brown-out Reset Enable (Brown-out Reset disabled)
+#pragma config CLKOUTEN = OFF   // Clock Out Enable (CLKOUT function is disabled. I/O or oscillator function on the CLKOUT pin)
+#pragma config IESO = OFF       // Internal/External Switchover (Internal/External Switchover mode is disabled)
+#pragma config FCMEN = OFF      // Fail-Safe Clock Monitor Enable (Fail-Safe Clock Monitor is disabled)
+
+// CONFIG2
+#pragma config WRT = OFF        // Flash Memory Self-Write Protection (Write protection off)
+#pragma config PLLEN = OFF      // PLL Enable (4x PLL disabled)
+#pragma config STVREN = ON      // Stack Overflow/Underflow Reset Enable (Stack Overflow or Underflow will cause a Reset)
+#pragma config BORV = LO        // Brown-out Reset Voltage Selection (Brown-out Reset Voltage (Vbor), low trip point selected.)
+#pragma config LVP = ON         // Low-Voltage Programming Enable (Low-voltage programming enabled)
+
+#include <xc.h> // Include standard header file
+#include <stdint.h>
+
+// Definitions
+#define _XTAL_FREQ  16000000 // This is used by the __delay_ms(xx) and __delay_us(xx) functions
+
+#define CONFIG_BAUD 9600
+#define CONFIG_ADC
+#include "../Config/config.h"
+#include "../UART/uart.h"
+#include "../Format/format.h"
+#include "../Filters/filters.h"
+#include "../PWM/pwm.h"
+#include "scheduler.h"
+
+static filter_ema_t Reading; // Smoothed potentiometer, 10 bits
+static uint8_t ButtonHistory; // Last samples of RA5, newest in bit 0
+static uint8_t LedOn = 1;
+static uint16_t Duty; // 10 bit PWM duty cycle
+static uint8_t StatsToSend; // Lines of the S answer still to send
+
+static const char ReplyError[] = "ERR\r\n";
+
+void adc_task(void);
+void button_task(void);
+void pwm_task(void);
+void report_task(void);
+void command_task(void);
+
+// In priority order, the first one that is due runs
+static const scheduler_task_t Tasks[] = {
+    { adc_task, SCHEDULER_MS(10), SCHEDULER_MS(2) },
+    { button_task, SCHEDULER_MS(10), SCHEDULER_MS(5) },
+    { pwm_task, SCHEDULER_MS(20), SCHEDULER_MS(10) },
+    { command_task, SCHEDULER_MS(10), SCHEDULER_MS(10) },
+    { report_task, SCHEDULER_MS(1000), SCHEDULER_MS(50) },
+};
+
+#define TASK_COUNT (sizeof Tasks / sizeof Tasks[0])
+
+static scheduler_state_t TaskStates[TASK_COUNT];
+
+void __interrupt(high_priority) high_priority_interrupt(void) {
+    scheduler_isr(); // The tick
+    pwm_isr(); // A new duty cycle, right after the period it waited for began
+    uart_isr(); // Move bytes between the EUSART and the ring buffers
+}
+
+// Takes the result of the conversion the last run started and starts the next
+// one, so the task never waits for the ADC
+void adc_task(void) {
+    if (!ADCON0bits.GO) {
+        filter_ema(&Reading, ADRES);
+        ADCON0bits.GO = 1;
+    }
+}
+
+// The button counts as pressed after a low sample followed by 4 high ones, so
+// bounce shorter than 40 ms does not toggle the LED twice
+void button_task(void) {
+    ButtonHistory = (uint8_t) ((ButtonHistory << 1) | PORTAbits.RA5);
+    if ((ButtonHistory & 0x1F) == 0x0F) {
+        LedOn = !LedOn; // Went from released to pressed
+    }
+}
+
+// The task runs at any point of a PWM period, so the new duty cycle waits for
+// the start of the next one, see ../PWM/pwm.h
+void pwm_task(void) {
+    Duty = LedOn ? Reading.sum >> FILTER_EMA_SHIFT : 0;
+    pwm_set_duty(Duty);
+}
+
+// Sends "<reading> <duty>", both 0-1023, when the line fits in the buffer
+void report_task(void) {
+    char Number[FORMAT_U16_SIZE];
+    uint8_t length;
+
+    if (uart_tx_free() < 2 * FORMAT_U16_SIZE + 2) {
+        return;
+    }
+    length = format_u16(Number, Reading.sum >> FILTER_EMA_SHIFT);
+    Number[length++] = ' ';
+    uart_write(Number, length);
+    length = format_u16(Number, Duty);
+    uart_write(Number, length);
+    uart_write("\r\n", 2);
+}
+
+// Runs the S command one task at a time, so it never has to wait for room in
+// the transmit buffer: "T<task> <longest run in us> <overruns>"
+void command_task(void) {
+    if (uart_read_line() != 0) {
+        if (uart_line[0] == 'S' && uart_line[1] == '\0') {
+            StatsToSend = TASK_COUNT;
+        } else {
+            uart_write(ReplyError, sizeof ReplyError - 1);
+        }
+    }
+
+    if (StatsToSend == 0 || uart_tx_free() < 2 + FORMAT_U16_SIZE + FORMAT_U8_SIZE + 2) {
+        return;
+    }
+
+    const scheduler_state_t *state = &TaskStates[TASK_COUNT - StatsToSend];
+    char Line[FORMAT_U16_SIZE + 1];
+    uint8_t length;
+
+    Line[0] = 'T';
+    length = format_u8(&Line[1], (uint8_t) (TASK_COUNT - StatsToSend)) + 1;
+    Line[length++] = ' ';
+    uart_write(Line, length);
+    length = format_u16(Line, state->worst_us);
+    Line[length++] = ' ';
+    uart_write(Line, length);
+    length = format_u8(Line, state->overruns);
+    uart_write(Line, length);
+    uart_write("\r\n", 2);
+    StatsToSend--;
+}
+
+void main(void) {
+    config_oscillator(); // Internal oscillator at _XTAL_FREQ
+
+    uart_init();
+
+    TRISAbits.TRISA2 = 0; // RA2 = PWM output
+    TRISAbits.TRISA4 = 1; // RA4 = Potentiometer
+    TRISAbits.TRISA5 = 1; // RA5 = Button, with a pull down resistor
+    ANSELAbits.ANSA4 = 1;
+
+    // ADC on AN3 (RA4), 1 us per bit, right justified
+    ADCON0bits.CHS = 0b00011;
+    ADCON1bits.ADCS = CONFIG_ADCS;
+    ADCON1bits.ADFM = 1;
+    ADCON0bits.ADON = 1;
+    filter_ema_init(&Reading, 0);
+
+    // PWM on RA2 at 16 MHz / 4 / 256 = 15.6 kHz with 10 bits of duty cycle
+    APFCONbits.CCP1SEL = 0; // P1A on RA2
+    pwm_init();
+
+    scheduler_init();
+    INTCONbits.PEIE = 1;
+    INTCONbits.GIE = 1;
+
+    scheduler_start(TaskStates, TASK_COUNT);
+    for (;;) {
+        scheduler_run(Tasks, TaskStates, TASK_COUNT);
+    }
+}
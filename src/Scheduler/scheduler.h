@@ -0,0 +1,174 @@
+//**********************************************************************************
+// Cooperative tick scheduler for the PIC12F1822
+//
+// Device: PIC12F1822
+// Compiler: Microchip XC8 v2.32
+//
+// A main loop built around __delay_ms() can only do one thing: while it waits
+// nothing else runs. Here every job is a short function in a task table that the
+// scheduler calls at its own period. Timer0 gives a tick of about a millisecond
+// and the main loop runs the first task in the table that is due, so the order
+// of the table is the priority. Tasks must return quickly; a task that waits for
+// something checks again on its next run instead.
+//
+// For every task the scheduler keeps the longest run time in microseconds, timed
+// with Timer1, and counts overruns: runs that finished after the deadline of the
+// task, and releases that were skipped because the task was still late a whole
+// period later.
+//
+// The core has no idle mode and SLEEP stops the instruction clock Timer0 counts,
+// so when no task is due the scheduler waits for the next tick in a NOP loop.
+//
+// The sample must define _XTAL_FREQ, call scheduler_isr() from its interrupt
+// routine and set INTCONbits.GIE after scheduler_init(). Timer0 and Timer1 belong
+// to the scheduler.
+//**********************************************************************************
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <xc.h>
+#include <stdint.h>
+
+// Timer0 overflows after 256 counts of Fosc/4 through the prescaler, 1.024 ms with
+// the prescaler below. Timer1 counts Fosc/4 through its prescaler in microseconds.
+#if _XTAL_FREQ == 32000000
+#define SCHEDULER_T0_PS     0b100 // 1:32
+#define SCHEDULER_T1_CKPS   0b11 // 1:8
+#elif _XTAL_FREQ == 16000000
+#define SCHEDULER_T0_PS     0b011 // 1:16
+#define SCHEDULER_T1_CKPS   0b10 // 1:4
+#elif _XTAL_FREQ == 8000000
+#define SCHEDULER_T0_PS     0b010 // 1:8
+#define SCHEDULER_T1_CKPS   0b01 // 1:2
+#elif _XTAL_FREQ == 4000000
+#define SCHEDULER_T0_PS     0b001 // 1:4
+#define SCHEDULER_T1_CKPS   0b00 // 1:1
+#else
+#error "The scheduler needs a 4, 8, 16 or 32 MHz clock"
+#endif
+
+#define SCHEDULER_TICK_US       1024
+#define SCHEDULER_MS(ms)        ((uint16_t) ((ms) * 1000UL / SCHEDULER_TICK_US))
+
+// One line of the task table, constant so it stays in flash
+typedef struct {
+    void (*run)(void);
+    uint16_t period; // Ticks from one release to the next
+    uint8_t deadline; // Ticks after the release by which the run has to be done
+} scheduler_task_t;
+
+// What changes while the tasks run, one per line of the table
+typedef struct {
+    uint16_t next; // Tick of the next release
+    uint16_t worst_us; // Longest run so far
+    uint8_t overruns; // Stops at 255
+} scheduler_state_t;
+
+static volatile uint16_t scheduler_ticks;
+
+static inline void scheduler_init(void) {
+    // Timer0 from Fosc/4 through the prescaler
+    OPTION_REGbits.TMR0CS = 0;
+    OPTION_REGbits.PSA = 0;
+    OPTION_REGbits.PS = SCHEDULER_T0_PS;
+    INTCONbits.TMR0IF = 0;
+    INTCONbits.TMR0IE = 1;
+
+    // Timer1 from Fosc/4, free running for the run times
+    T1CONbits.TMR1CS = 0b00;
+    T1CONbits.T1CKPS = SCHEDULER_T1_CKPS;
+    T1CONbits.TMR1ON = 1;
+}
+
+static inline void scheduler_isr(void) {
+    if (INTCONbits.TMR0IE && INTCONbits.TMR0IF) {
+        INTCONbits.TMR0IF = 0;
+        scheduler_ticks++;
+    }
+}
+
+// The interrupt can change the two bytes of the tick between the two reads, so
+// read until two reads agree
+static inline uint16_t scheduler_now(void) {
+    uint16_t ticks;
+
+    do {
+        ticks = scheduler_ticks;
+    } while (ticks != scheduler_ticks);
+    return ticks;
+}
+
+// Timer1 has no latch for the high byte, read it again if the low byte wrapped
+static inline uint16_t scheduler_us(void) {
+    uint8_t high;
+    uint8_t low;
+
+    do {
+        high = TMR1H;
+        low = TMR1L;
+    } while (high != TMR1H);
+    return ((uint16_t) high << 8) | low;
+}
+
+// Releases every task now, in the order of the table
+static inline void scheduler_start(scheduler_state_t *states, uint8_t count) {
+    uint16_t now = scheduler_now();
+
+    for (uint8_t i = 0; i < count; i++) {
+        states[i].next = now;
+        states[i].worst_us = 0;
+        states[i].overruns = 0;
+    }
+}
+
+static inline void scheduler_overrun(scheduler_state_t *state) {
+    if (state->overruns != 255) {
+        state->overruns++;
+    }
+}
+
+// Runs the first task that is due, or waits for the next tick when none is.
+// Call it from the main loop over and over.
+static inline void scheduler_run(const scheduler_task_t *tasks, scheduler_state_t *states, uint8_t count) {
+    uint16_t now = scheduler_now();
+    uint8_t i;
+
+    for (i = 0; i < count; i++) {
+        if ((int16_t) (now - states[i].next) >= 0) {
+            break;
+        }
+    }
+    if (i == count) {
+        while (scheduler_now() == now) {
+            NOP(); // Nothing is due before the next tick
+        }
+        return;
+    }
+
+    const scheduler_task_t *task = &tasks[i];
+    scheduler_state_t *state = &states[i];
+    uint16_t start = scheduler_us();
+
+    task->run();
+
+    uint16_t elapsed = scheduler_us() - start;
+    uint16_t finished = scheduler_now();
+
+    if (elapsed > state->worst_us) {
+        state->worst_us = elapsed;
+    }
+    if ((uint16_t) (finished - state->next) > task->deadline) {
+        scheduler_overrun(state);
+    }
+
+    // Keep the releases on the period grid, but do not try to catch up on the
+    // ones that are already over
+    state->next += task->period;
+    while ((int16_t) (finished - state->next) > 0) {
+        state->next += task->period;
+        scheduler_overrun(state);
+    }
+}
+
+#endif
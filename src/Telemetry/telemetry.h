@@ -0,0 +1,153 @@
+//**********************************************************************************
+// Compact binary telemetry frames for the PIC12F1822 samples
+//
+// Device: PIC12F1822
+// Compiler: Microchip XC8 v2.32
+//
+// Sending every reading as text costs several bytes per sample and the letter
+// buckets throw away most of the 10 bit resolution. A frame carries a batch of
+// readings instead:
+//
+//      byte 0      type in the high nibble, number of values in the low nibble
+//      byte 1      sequence number, +1 for every frame, gaps mean lost frames
+//      byte 2-3    tick of the first value, little endian
+//      ...         the values, see the types below
+//      last        CRC-8 (polynomial 0x07, initial value 0) of all bytes before it
+//
+// The frame is COBS encoded, so it contains no zero bytes, and ends with a zero.
+// A receiver can always find the start of the next frame after lost bytes.
+// host/TelemetryDecoder decodes the stream on a PC.
+//
+// telemetry_send() uses uart_write() and uart_tx_free() from ../UART/uart.h,
+// include that first. telemetry_build() only makes the frame, for a sample that
+// sends it some other way.
+//**********************************************************************************
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+// 10 bit ADC samples packed back to back, most significant bit first. Every two
+// samples take 20 bits, the last byte is padded with zeros.
+#define TELEMETRY_TYPE_SAMPLES  0x00
+// 16 bit values, little endian
+#define TELEMETRY_TYPE_VALUES   0x10
+// 12 bit oversampled ADC results packed like the 10 bit ones, two in 3 bytes
+#define TELEMETRY_TYPE_SAMPLES12 0x20
+// A piece of the EEPROM log of ../EepromLog/eepromLog.h, sent like the 16 bit
+// values with two bytes of the log in each, low byte first. The tick is the
+// address of the first byte.
+#define TELEMETRY_TYPE_LOG      0x30
+// Statistics of one region of ../Profiler/profiler.h, the tick is the region:
+// runs, shortest, longest, total low word, total high word, in Timer1 counts
+#define TELEMETRY_TYPE_PROFILE  0x40
+
+// Most values a frame can carry, the count has to fit in four bits
+#ifndef TELEMETRY_MAX_VALUES
+#define TELEMETRY_MAX_VALUES    8
+#endif
+
+#if TELEMETRY_MAX_VALUES > 15
+#error "TELEMETRY_MAX_VALUES must not be bigger than 15"
+#endif
+
+#define TELEMETRY_HEADER_SIZE   4
+
+// Raw frame plus the COBS overhead byte and the zero delimiter
+#define TELEMETRY_BUFFER_SIZE   (1 + TELEMETRY_HEADER_SIZE + 2 * TELEMETRY_MAX_VALUES + 1 + 1)
+
+static uint8_t telemetry_sequence;
+
+// The raw frame is built from index 1 on and COBS encoded in place, see below
+static uint8_t telemetry_buffer[TELEMETRY_BUFFER_SIZE];
+
+static inline uint8_t telemetry_crc8(const uint8_t *data, uint8_t length) {
+    uint8_t crc = 0;
+
+    while (length-- != 0) {
+        crc ^= *data++;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t) ((crc << 1) ^ 0x07) : (uint8_t) (crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+// Builds one frame in telemetry_buffer, COBS encoded and with its delimiter, and
+// returns its length
+static inline uint8_t telemetry_build(uint8_t type, uint16_t tick, const uint16_t *values, uint8_t count) {
+    uint8_t *frame = &telemetry_buffer[1];
+    uint8_t length = TELEMETRY_HEADER_SIZE;
+
+    if (count > TELEMETRY_MAX_VALUES) {
+        count = TELEMETRY_MAX_VALUES;
+    }
+
+    frame[0] = (uint8_t) (type | count);
+    frame[1] = telemetry_sequence++;
+    frame[2] = (uint8_t) tick;
+    frame[3] = (uint8_t) (tick >> 8);
+
+    if (type == TELEMETRY_TYPE_SAMPLES || type == TELEMETRY_TYPE_SAMPLES12) {
+        uint8_t width = (type == TELEMETRY_TYPE_SAMPLES12) ? 12 : 10;
+        uint16_t mask = (uint16_t) ((1u << width) - 1);
+        uint32_t bits = 0; // Up to 7 pending and 12 new bits
+        uint8_t bit_count = 0;
+
+        for (uint8_t i = 0; i < count; i++) {
+            bits = (bits << width) | (values[i] & mask);
+            bit_count += width;
+            while (bit_count >= 8) {
+                bit_count -= 8;
+                frame[length++] = (uint8_t) (bits >> bit_count);
+            }
+            bits &= (1ul << bit_count) - 1; // Only the bits not sent yet
+        }
+        if (bit_count != 0) {
+            frame[length++] = (uint8_t) (bits << (8 - bit_count));
+        }
+    } else {
+        for (uint8_t i = 0; i < count; i++) {
+            frame[length++] = (uint8_t) values[i];
+            frame[length++] = (uint8_t) (values[i] >> 8);
+        }
+    }
+
+    frame[length] = telemetry_crc8(frame, length);
+    length++;
+
+    // COBS in place: every zero byte is replaced by the distance to the next one
+    // and the byte in front of the frame holds the distance to the first one.
+    // Frames are far shorter than 254 bytes so no extra code bytes are needed.
+    uint8_t code_index = 0;
+    for (uint8_t i = 1; i <= length; i++) {
+        if (telemetry_buffer[i] == 0) {
+            telemetry_buffer[code_index] = (uint8_t) (i - code_index);
+            code_index = i;
+        }
+    }
+    telemetry_buffer[code_index] = (uint8_t) (length + 1 - code_index);
+    telemetry_buffer[length + 1] = 0; // Frame delimiter
+    return (uint8_t) (length + 2);
+}
+
+#ifdef UART_H
+// Builds one frame and queues it for sending. Returns 1 when the frame was queued
+// and 0 when there was no room for all of it in the transmit buffer. A frame is
+// never sent in part; a dropped frame still uses up a sequence number so the
+// receiver can count it.
+static inline uint8_t telemetry_send(uint8_t type, uint16_t tick, const uint16_t *values, uint8_t count) {
+    uint8_t length = telemetry_build(type, tick, values, count);
+
+    if (uart_tx_free() < length) {
+        return 0;
+    }
+
+    uart_write(telemetry_buffer, length);
+    return 1;
+}
+#endif
+
+#endif
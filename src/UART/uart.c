@@ -11,7 +11,8 @@
 // The main idea of UART is to send data via serial connection.
 // For this example I use PICKIT 4 programmer and CP2102 connector.
 // The idea is to send some data to my PC via serial port.
-// In order to receive the connection I use PuTTY.
+// In order to receive the connection I use PuTTY at 115200 baud.
+// Typing P<n> and Enter in PuTTY changes the message period to n x 10 ms (1-255).
 //**********************************************************************************
 //                                   PIC12F1822 Pinout for this example
 //                                   ----------
@@ -47,57 +48,49 @@
 #include <stdint.h>
 
 // Definitions
-#define _XTAL_FREQ  1000000 // This is used by the __delay_ms(xx) and __delay_us(xx) functions
-
-void uart_init() {
-    SPBRGH = 25 >> 8; // For 9600 Baud and with 11.0592 Mhz Crystal
-    SPBRGL = 25 & 0xFF;
-    APFCONbits.RXDTSEL = 0; // RA1 as RX Pin
-    APFCONbits.TXCKSEL = 0; // RA0 as TX Pin
-    TRISAbits.TRISA0 = 0; // RA0 as O/P Pin
-    TRISAbits.TRISA1 = 1; // RA0 as I/P Pin
-    ANSELA = 0; // Port A all pins are digital I/O Pin
-    WPUAbits.WPUA0 = 1; // Enable weak pull up on RA0
-    WPUAbits.WPUA1 = 1; // Enable weak pull up on RA1
-    TXSTAbits.TX9 = 0; // 8-BIT DATA MODE
-    TXSTAbits.TXEN = 1; // ENABLE TRANSMITTER
-    TXSTAbits.SYNC = 0; // ENABLE ASYNCHRONOUS MODE
-    TXSTAbits.SENDB = 0; // SYNC BREAK TRANSMISSION COMPLETED
-    TXSTAbits.BRGH = 1; // SELECT LOW BAUD RATE
-    BAUDCONbits.SCKP = 0; // DON'T INVERT POLARITY
-    BAUDCONbits.BRG16 = 1; // 8-BIT BAUDRATE GENERATOR
-    BAUDCONbits.ABDEN = 0; // AUTO BAUD RATE DETECT DISABLE
-
-    RCSTAbits.RX9 = 0; // ENABLE 8-BIT RECEPTION
-    RCSTAbits.CREN = 1; // ENABLE RECEIVER
-    RCSTAbits.FERR = 0;
-    RCSTAbits.OERR = 0;
-    RCSTAbits.SPEN = 1; // ENABLE SERIAL PORT 
+#define _XTAL_FREQ  32000000 // This is used by the __delay_ms(xx) and __delay_us(xx) functions
+
+#define CONFIG_BAUD 115200 // 0.6% fast from the 32 MHz PLL
+#include "../Config/config.h"
+#include "uart.h"
+
+static uint8_t MessagePeriod = 20; // In 10 ms steps, changed with the P command
+
+void __interrupt(high_priority) high_priority_interrupt(void) {
+    uart_isr(); // Move bytes between the EUSART and the ring buffers
 }
 
-void uart_send(char* message) {
-    for (size_t i = 0; i < 12; i++) {
-        TXREG = message[i];
-        
-        // The heart of the EUSART is the serial
-        // Transmit Shift Register (TSR). The TSR obtains its data from
-        // the transmit buffer, which is the TXREG register
-        while (TXSTAbits.TRMT == 0); // Wait the register to clear out
+// Runs the command line that uart_read_line() just completed
+void process_command(void) {
+    uint16_t value;
+
+    if (uart_line[0] == 'P' && uart_parse_number(&uart_line[1], &value) && value >= 1 && value <= 255) {
+        MessagePeriod = (uint8_t) value;
+        uart_send("OK\r\n");
+    } else {
+        uart_send("ERR\r\n");
     }
 }
 
 int main(void) {
-    // Set up oscillator control register
-    OSCCONbits.SPLLEN = 0; // PLL is disabled
-    OSCCONbits.IRCF = 0b1011; // Set OSCCON IRCF bits to select OSC frequency=1Mhz
-    OSCCONbits.SCS = 0x02; // Set the SCS bits to select internal oscillator block
+    config_oscillator(); // 8 MHz Internal Oscillator through the PLL gives 32 MHz
 
     uart_init();
+    INTCONbits.GIE = 1; // Enable global interrupts, the transmitter runs from the interrupt
 
     for (;;) {
-        __delay_ms(200);
-        char message[] = {'h', 'e', 'l', 'l', 'o', ' ', 'w', 'o', 'r', 'l', 'd', ' '};
-        uart_send(&message);
+        // Wait in 10 ms slices so commands from the PC are handled in time
+        for (uint8_t slice = 0; slice < MessagePeriod; slice++) {
+            __delay_ms(10);
+            if (uart_read_line() != 0) {
+                process_command();
+            }
+        }
+
+        const char message[] = {'h', 'e', 'l', 'l', 'o', ' ', 'w', 'o', 'r', 'l', 'd', ' '};
+
+        // Returns right away, the bytes are sent in the background
+        uart_write(message, sizeof message);
     }
 
     return 0;
@@ -0,0 +1,252 @@
+//**********************************************************************************
+// Interrupt driven UART driver for the PIC12F1822
+//
+// Device: PIC12F1822
+// Compiler: Microchip XC8 v2.32
+//
+// The old uart_send() wrote one byte to TXREG and then waited for TRMT, which at
+// 9600 baud stalls the CPU for about 1 ms per byte. Here the bytes are copied into
+// a small ring buffer and the interrupt routine moves them into TXREG every time
+// it becomes empty (TXIF). uart_write() never waits, it returns how many bytes
+// fitted in the buffer so the main loop can keep sampling while the data drains.
+//
+// Received bytes go the other way: the interrupt routine empties RCREG on RCIF into
+// a second ring buffer, so the two byte hardware FIFO never overruns while the
+// main loop is busy. uart_read_line() collects them into a command line.
+//
+// The sample that includes this file must call uart_isr() from its interrupt
+// routine and set INTCONbits.GIE after uart_init().
+//**********************************************************************************
+
+#ifndef UART_H
+#define UART_H
+
+#include <xc.h>
+#include <stdint.h>
+
+// Size of the transmit ring buffer. It must be a power of two so the indexes
+// can be wrapped with a mask instead of a division.
+#ifndef UART_TX_BUFFER_SIZE
+#define UART_TX_BUFFER_SIZE 16
+#endif
+
+#if (UART_TX_BUFFER_SIZE & (UART_TX_BUFFER_SIZE - 1)) != 0 || UART_TX_BUFFER_SIZE > 128
+#error "UART_TX_BUFFER_SIZE must be a power of two not bigger than 128"
+#endif
+
+#define UART_TX_MASK (UART_TX_BUFFER_SIZE - 1)
+
+// Size of the receive ring buffer, also a power of two
+#ifndef UART_RX_BUFFER_SIZE
+#define UART_RX_BUFFER_SIZE 8
+#endif
+
+#if (UART_RX_BUFFER_SIZE & (UART_RX_BUFFER_SIZE - 1)) != 0 || UART_RX_BUFFER_SIZE > 128
+#error "UART_RX_BUFFER_SIZE must be a power of two not bigger than 128"
+#endif
+
+#define UART_RX_MASK (UART_RX_BUFFER_SIZE - 1)
+
+// Baud rate generator value for BRG16 = 1 and BRGH = 1: Fosc / (4 x (UART_SPBRG + 1)).
+// The default gives 9600 baud with a 1 MHz clock. ../Config/config.h works it out
+// from CONFIG_BAUD and the clock, include it first when the sample runs at another
+// clock or baud rate.
+#ifndef UART_SPBRG
+#define UART_SPBRG 25
+#endif
+
+// Longest command line uart_read_line() accepts, without the line terminator
+#ifndef UART_LINE_LENGTH
+#define UART_LINE_LENGTH 8
+#endif
+
+// The indexes are free running 8 bit counters, head - tail is the number of
+// queued bytes. Head is only written by the main loop and tail only by the
+// interrupt routine, a single byte write is atomic so no locking is needed.
+static volatile uint8_t uart_tx_buffer[UART_TX_BUFFER_SIZE];
+static volatile uint8_t uart_tx_head;
+static volatile uint8_t uart_tx_tail;
+
+// Same scheme for receiving, but here head belongs to the interrupt routine
+static volatile uint8_t uart_rx_buffer[UART_RX_BUFFER_SIZE];
+static volatile uint8_t uart_rx_head;
+static volatile uint8_t uart_rx_tail;
+static volatile uint8_t uart_rx_errors; // Bytes lost to OERR or to a full buffer
+
+// Command line being assembled by uart_read_line()
+static char uart_line[UART_LINE_LENGTH + 1];
+static uint8_t uart_line_length;
+static uint8_t uart_line_overflow;
+
+static inline void uart_init(void) {
+    SPBRGH = UART_SPBRG >> 8; // Baud rate generator, see UART_SPBRG
+    SPBRGL = UART_SPBRG & 0xFF;
+    APFCONbits.RXDTSEL = 0; // RA1 as RX Pin
+    APFCONbits.TXCKSEL = 0; // RA0 as TX Pin
+    TRISAbits.TRISA0 = 0; // RA0 as O/P Pin
+    TRISAbits.TRISA1 = 1; // RA0 as I/P Pin
+    ANSELA = 0; // Port A all pins are digital I/O Pin
+    WPUAbits.WPUA0 = 1; // Enable weak pull up on RA0
+    WPUAbits.WPUA1 = 1; // Enable weak pull up on RA1
+    TXSTAbits.TX9 = 0; // 8-BIT DATA MODE
+    TXSTAbits.TXEN = 1; // ENABLE TRANSMITTER
+    TXSTAbits.SYNC = 0; // ENABLE ASYNCHRONOUS MODE
+    TXSTAbits.SENDB = 0; // SYNC BREAK TRANSMISSION COMPLETED
+    TXSTAbits.BRGH = 1; // SELECT HIGH BAUD RATE
+    BAUDCONbits.SCKP = 0; // DON'T INVERT POLARITY
+    BAUDCONbits.BRG16 = 1; // 16-BIT BAUDRATE GENERATOR
+    BAUDCONbits.ABDEN = 0; // AUTO BAUD RATE DETECT DISABLE
+
+    RCSTAbits.RX9 = 0; // ENABLE 8-BIT RECEPTION
+    RCSTAbits.CREN = 1; // ENABLE RECEIVER
+    RCSTAbits.FERR = 0;
+    RCSTAbits.OERR = 0;
+    RCSTAbits.SPEN = 1; // ENABLE SERIAL PORT
+
+    uart_tx_head = 0;
+    uart_tx_tail = 0;
+    uart_rx_head = 0;
+    uart_rx_tail = 0;
+    uart_line_length = 0;
+    PIE1bits.TXIE = 0; // Enabled by uart_write() when there is something to send
+    PIE1bits.RCIE = 1; // Every received byte is taken out of RCREG right away
+    INTCONbits.PEIE = 1; // The EUSART interrupts are peripheral interrupts
+}
+
+// Number of bytes that can be queued right now without dropping anything
+static inline uint8_t uart_tx_free(void) {
+    return (uint8_t) (UART_TX_BUFFER_SIZE - (uint8_t) (uart_tx_head - uart_tx_tail));
+}
+
+// Queues up to len bytes and returns immediately with the number of bytes that
+// fitted in the buffer. Whatever is left is up to the caller to retry or drop.
+static inline uint8_t uart_write(const void *buf, uint8_t len) {
+    const uint8_t *data = (const uint8_t *) buf;
+    uint8_t queued = 0;
+
+    while (queued < len && (uint8_t) (uart_tx_head - uart_tx_tail) < UART_TX_BUFFER_SIZE) {
+        uart_tx_buffer[uart_tx_head & UART_TX_MASK] = data[queued];
+        uart_tx_head++; // Publish the byte only after it is stored
+        queued++;
+    }
+
+    if (queued != 0) {
+        // TXIF is set as long as TXREG is empty so this starts the transfer
+        PIE1bits.TXIE = 1;
+    }
+
+    return queued;
+}
+
+// Queues a zero terminated string, same rules as uart_write()
+static inline uint8_t uart_send(const char *message) {
+    uint8_t length = 0;
+
+    while (message[length] != '\0') {
+        length++;
+    }
+
+    return uart_write(message, length);
+}
+
+// Takes one received byte out of the ring buffer. Returns 0 when it is empty.
+static inline uint8_t uart_read(uint8_t *data) {
+    if (uart_rx_tail == uart_rx_head) {
+        return 0;
+    }
+
+    *data = uart_rx_buffer[uart_rx_tail & UART_RX_MASK];
+    uart_rx_tail++;
+    return 1;
+}
+
+// Collects received bytes into uart_line until a CR or LF arrives. It looks at no
+// more than UART_RX_BUFFER_SIZE bytes per call, so it is safe to call from the main
+// loop without blowing the loop time. Returns the length of a complete line, which
+// is then zero terminated in uart_line, or 0 when there is no complete line yet.
+// Lines that do not fit in uart_line are thrown away.
+static inline uint8_t uart_read_line(void) {
+    uint8_t budget = UART_RX_BUFFER_SIZE;
+    uint8_t data;
+
+    while (budget-- != 0 && uart_read(&data)) {
+        if (data == '\r' || data == '\n') {
+            uint8_t length = uart_line_length;
+            uint8_t overflow = uart_line_overflow;
+
+            uart_line_length = 0;
+            uart_line_overflow = 0;
+            if (length != 0 && !overflow) {
+                uart_line[length] = '\0';
+                return length;
+            }
+        } else if (uart_line_length < UART_LINE_LENGTH) {
+            uart_line[uart_line_length++] = (char) data;
+        } else {
+            uart_line_overflow = 1;
+        }
+    }
+
+    return 0;
+}
+
+// Parses the decimal number at text. Returns 0 if there are no digits, anything
+// other than digits after them or the value does not fit in 16 bits.
+static inline uint8_t uart_parse_number(const char *text, uint16_t *value) {
+    uint16_t result = 0;
+
+    if (*text == '\0') {
+        return 0;
+    }
+
+    while (*text != '\0') {
+        uint8_t digit = (uint8_t) (*text - '0');
+
+        if (digit > 9 || result > 6553 || (result == 6553 && digit > 5)) {
+            return 0;
+        }
+        result = (uint16_t) (result * 10 + digit);
+        text++;
+    }
+
+    *value = result;
+    return 1;
+}
+
+// Call this from the interrupt routine
+static inline void uart_isr(void) {
+    if (PIR1bits.RCIF) {
+        if (RCSTAbits.OERR) {
+            // The receiver stops after an overrun, toggling CREN restarts it
+            RCSTAbits.CREN = 0;
+            RCSTAbits.CREN = 1;
+            uart_rx_errors++;
+        }
+
+        uint8_t data = RCREG; // Reading RCREG clears RCIF
+        if ((uint8_t) (uart_rx_head - uart_rx_tail) < UART_RX_BUFFER_SIZE) {
+            uart_rx_buffer[uart_rx_head & UART_RX_MASK] = data;
+            uart_rx_head++;
+        } else {
+            uart_rx_errors++;
+        }
+    }
+
+    if (PIE1bits.TXIE && PIR1bits.TXIF) {
+        // uart_write() may enable TXIE right after this routine already sent
+        // the byte it queued, so the buffer can be empty here
+        if (uart_tx_tail != uart_tx_head) {
+            // TXREG is empty, the previous byte is already in the shift register
+            TXREG = uart_tx_buffer[uart_tx_tail & UART_TX_MASK];
+            uart_tx_tail++;
+        }
+
+        if (uart_tx_tail == uart_tx_head) {
+            // Nothing more to send. TXIF stays set while TXREG is empty
+            // so the interrupt has to be masked or it fires forever.
+            PIE1bits.TXIE = 0;
+        }
+    }
+}
+
+#endif